@@ -0,0 +1,428 @@
+#include <Structures/TransportNetwork/ShardedPassengerIngestor.h>
+#include <Structures/TransportNetwork/TransportNetwork.h>
+#include <Structures/TransportNetwork/TransportNetworkBuilder.h>
+#include <Structures/TransportNetwork/TransportNetworkParser.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <span>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace Structures::TransportNetwork;
+
+namespace {
+
+using BenchClock = std::chrono::steady_clock;
+
+// Cheap operations are timed in batches, so that reading the clock does not
+// dominate what is measured.
+constexpr std::size_t kBatchSize{64};
+constexpr std::size_t kLoadRepetitions{10};
+constexpr std::size_t kPopularPairs{256};
+
+// Ingestion feeds the same events from a fixed number of producers into
+// each number of shards, so that throughput shows how it scales with them.
+constexpr std::size_t kIngestionProducers{4};
+constexpr std::array<std::size_t, 4> kIngestionShards{1, 2, 4, 8};
+
+struct BenchOptions {
+  std::string layoutPath{BENCH_NETWORK_LAYOUT_PATH};
+  std::vector<std::size_t> scales{1, 4, 16};
+  std::size_t operations{100000};
+  std::uint64_t seed{42};
+};
+
+struct BenchResult {
+  std::string name{};
+  std::size_t scale{};
+  std::size_t stations{};
+  std::size_t operations{};
+  double seconds{};
+
+  // Per operation, in nanoseconds; one sample per batch.
+  std::vector<double> latencies{};
+};
+
+// Keeps the compiler from dropping the results of measured operations.
+volatile std::size_t gSink{0};
+
+auto ParseOptions(const int argc, char **argv) -> BenchOptions
+{
+  BenchOptions options{};
+  for (int i{1}; i < argc; ++i) {
+    const std::string argument{argv[i]};
+    if (i + 1 == argc) {
+      throw std::invalid_argument("Missing value for " + argument);
+    }
+
+    const std::string value{argv[++i]};
+    if (argument == "--layout") {
+      options.layoutPath = value;
+    }
+    else if (argument == "--scales") {
+      options.scales.clear();
+      std::istringstream scales{value};
+      for (std::string scale; std::getline(scales, scale, ',');) {
+        options.scales.push_back(std::stoul(scale));
+      }
+    }
+    else if (argument == "--operations") {
+      options.operations = std::stoul(value);
+    }
+    else if (argument == "--seed") {
+      options.seed = std::stoull(value);
+    }
+    else {
+      throw std::invalid_argument("Unknown option " + argument);
+    }
+  }
+
+  return options;
+}
+
+// Copies of the layout side by side, ids suffixed with the copy's number.
+auto ScaleLayout(const NetworkLayout &layout, const std::size_t scale)
+  -> NetworkLayout
+{
+  NetworkLayout result{};
+  result.stations.reserve(layout.stations.size() * scale);
+  result.lines.reserve(layout.lines.size() * scale);
+  result.travelTimes.reserve(layout.travelTimes.size() * scale);
+
+  for (std::size_t copy{0}; copy < scale; ++copy) {
+    const auto suffix{"_" + std::to_string(copy)};
+    for (const auto &station : layout.stations) {
+      result.stations.emplace_back(station.m_id + suffix, station.m_name);
+    }
+
+    for (const auto &line : layout.lines) {
+      auto &scaledLine{result.lines.emplace_back(
+        Line{.id = line.id + suffix, .name = line.name})};
+      for (const auto &pRoute : line.routes) {
+        StopSequence::Stops stops;
+        stops.reserve(pRoute->stops.size());
+        for (const auto &stop : pRoute->stops) {
+          stops.push_back(stop + suffix);
+        }
+
+        scaledLine.routes.push_back(std::make_shared<Route>(Route{
+          .lineId = scaledLine.id,
+          .routeId = pRoute->routeId + suffix,
+          .direction = pRoute->direction,
+          .startStationId = pRoute->startStationId + suffix,
+          .endStationId = pRoute->endStationId + suffix,
+          .stops = std::move(stops)}));
+      }
+    }
+
+    for (const auto &travelTime : layout.travelTimes) {
+      result.travelTimes.push_back(LayoutTravelTime{
+        .startStationId = travelTime.startStationId + suffix,
+        .endStationId = travelTime.endStationId + suffix,
+        .lineId = travelTime.lineId.empty() ? "" : travelTime.lineId + suffix,
+        .routeId =
+          travelTime.routeId.empty() ? "" : travelTime.routeId + suffix,
+        .travelTime = travelTime.travelTime});
+    }
+  }
+
+  return result;
+}
+
+auto BuildNetwork(NetworkLayout layout) -> TransportNetwork
+{
+  TransportNetworkBuilder builder{};
+  builder.AddLayout(std::move(layout));
+  return builder.Build();
+}
+
+// Runs operation(i) for every i in [0, operations), timing batchSize of them
+// at a time.
+template <typename TOperation>
+auto Measure(
+  BenchResult result,
+  const std::size_t batchSize,
+  TOperation &&operation) -> BenchResult
+{
+  result.latencies.reserve(result.operations / batchSize + 1);
+  const auto start{BenchClock::now()};
+  for (std::size_t first{0}; first < result.operations; first += batchSize) {
+    const auto last{std::min(first + batchSize, result.operations)};
+    const auto batchStart{BenchClock::now()};
+    for (auto i{first}; i < last; ++i) {
+      operation(i);
+    }
+
+    const std::chrono::duration<double, std::nano> elapsed{
+      BenchClock::now() - batchStart};
+    result.latencies.push_back(
+      elapsed.count() / static_cast<double>(last - first));
+  }
+
+  result.seconds =
+    std::chrono::duration<double>(BenchClock::now() - start).count();
+  return result;
+}
+
+// Nearest rank of sorted, non-empty latencies.
+auto Percentile(const std::vector<double> &sorted, const double percentile)
+  -> double
+{
+  const auto rank{static_cast<std::size_t>(
+    std::ceil(percentile / 100.0 * static_cast<double>(sorted.size())))};
+  return sorted[std::clamp<std::size_t>(rank, 1, sorted.size()) - 1];
+}
+
+// One JSON object per line.
+void PrintResult(std::ostream &output, BenchResult result)
+{
+  auto &latencies{result.latencies};
+  std::ranges::sort(latencies);
+  const auto total{std::accumulate(latencies.begin(), latencies.end(), 0.0)};
+  const auto mean{
+    latencies.empty() ? 0.0 : total / static_cast<double>(latencies.size())};
+
+  output << R"({"benchmark":")" << result.name << R"(","scale":)"
+         << result.scale << R"(,"stations":)" << result.stations
+         << R"(,"operations":)" << result.operations << R"(,"seconds":)"
+         << result.seconds << R"(,"throughput":)"
+         << (result.seconds > 0.0
+               ? static_cast<double>(result.operations) / result.seconds
+               : 0.0)
+         << R"(,"latency_ns":{"mean":)" << mean;
+  if (!latencies.empty()) {
+    output << R"(,"p50":)" << Percentile(latencies, 50) << R"(,"p90":)"
+           << Percentile(latencies, 90) << R"(,"p99":)"
+           << Percentile(latencies, 99) << R"(,"max":)" << latencies.back();
+  }
+
+  output << "}}\n";
+}
+
+void RunScale(
+  const NetworkLayout &baseLayout,
+  const std::size_t scale,
+  const BenchOptions &options,
+  std::ostream &output)
+{
+  const auto layout{ScaleLayout(baseLayout, scale)};
+  const auto stationCount{layout.stations.size()};
+  const auto copyStations{baseLayout.stations.size()};
+  std::mt19937_64 random{options.seed};
+  const auto report{[&](std::string name, const std::size_t operations) {
+    return BenchResult{
+      .name = std::move(name),
+      .scale = scale,
+      .stations = stationCount,
+      .operations = operations};
+  }};
+
+  PrintResult(
+    output,
+    Measure(
+      report("Load", kLoadRepetitions),
+      1,
+      [&layout](std::size_t) {
+        gSink = gSink + BuildNetwork(layout).GetStationCount();
+      }));
+
+  // Every line of the layout, added to networks holding only the stations.
+  {
+    std::vector<TransportNetwork> networks(kLoadRepetitions);
+    for (auto &network : networks) {
+      for (const auto &station : layout.stations) {
+        network.AddStation(station);
+      }
+    }
+
+    const auto lineCount{layout.lines.size()};
+    PrintResult(
+      output,
+      Measure(
+        report("AddLine", lineCount * kLoadRepetitions),
+        1,
+        [&networks, &layout, lineCount](const std::size_t i) {
+          gSink = gSink + (networks[i / lineCount].AddLine(
+                             layout.lines[i % lineCount])
+                             ? 1
+                             : 0);
+        }));
+  }
+
+  auto network{BuildNetwork(layout)};
+  network.BuildGraph();
+
+  std::uniform_int_distribution<std::size_t> pickStation{0, stationCount - 1};
+  std::vector<StationId> stationIds(options.operations);
+  for (auto &stationId : stationIds) {
+    stationId = layout.stations[pickStation(random)].m_id;
+  }
+
+  PrintResult(
+    output,
+    Measure(
+      report("GetStation", options.operations),
+      kBatchSize,
+      [&network, &stationIds](const std::size_t i) {
+        gSink = gSink + (network.GetStation(stationIds[i]) ? 1 : 0);
+      }));
+
+  PrintResult(
+    output,
+    Measure(
+      report("RecordPassengerEvent", options.operations),
+      kBatchSize,
+      [&network, &stationIds](const std::size_t i) {
+        gSink = gSink + (network.RecordPassengerEvent(PassengerEvent{
+                           .m_stationId = stationIds[i],
+                           .m_type = PassengerEvent::Type::kIn})
+                           ? 1
+                           : 0);
+      }));
+
+  {
+    std::vector<PassengerEvent> events(options.operations);
+    for (std::size_t i{0}; i < events.size(); ++i) {
+      events[i] = PassengerEvent{
+        .m_stationId = stationIds[i],
+        .m_type = PassengerEvent::Type::kIn};
+    }
+
+    for (const auto shards : kIngestionShards) {
+      auto result{report(
+        "ShardedIngestion/" + std::to_string(shards),
+        events.size())};
+      const auto start{BenchClock::now()};
+      {
+        ShardedPassengerIngestor ingestor{network, shards};
+        std::vector<std::jthread> producers;
+        for (std::size_t producer{0}; producer < kIngestionProducers;
+             ++producer) {
+          producers.emplace_back([&events, &ingestor, producer]() {
+            const std::span all{events};
+            for (auto first{producer * kBatchSize}; first < all.size();
+                 first += kIngestionProducers * kBatchSize) {
+              ingestor.Record(
+                all.subspan(first, std::min(kBatchSize, all.size() - first)));
+            }
+          });
+        }
+
+        producers.clear();
+        ingestor.Drain();
+      }
+
+      result.seconds =
+        std::chrono::duration<double>(BenchClock::now() - start).count();
+      PrintResult(output, std::move(result));
+    }
+  }
+
+  if (!layout.travelTimes.empty()) {
+    std::uniform_int_distribution<std::size_t> pickTravelTime{
+      0,
+      layout.travelTimes.size() - 1};
+    std::vector<const LayoutTravelTime *> travelTimes(options.operations);
+    for (auto &pTravelTime : travelTimes) {
+      pTravelTime = &layout.travelTimes[pickTravelTime(random)];
+    }
+
+    PrintResult(
+      output,
+      Measure(
+        report("GetTravelTime", options.operations),
+        kBatchSize,
+        [&network, &travelTimes](const std::size_t i) {
+          gSink = gSink + network.GetTravelTime(
+                            travelTimes[i]->startStationId,
+                            travelTimes[i]->endStationId);
+        }));
+  }
+
+  // Route queries stay within one copy of the layout, where they can
+  // succeed; the first run bypasses the itinerary cache, the second
+  // repeats a small set of popular pairs.
+  std::uniform_int_distribution<std::size_t> pickCopy{0, scale - 1};
+  std::uniform_int_distribution<std::size_t> pickCopyStation{
+    0,
+    copyStations - 1};
+  const auto pickPair{[&]() {
+    const auto first{pickCopy(random) * copyStations};
+    return std::pair{
+      static_cast<StationIndex>(first + pickCopyStation(random)),
+      static_cast<StationIndex>(first + pickCopyStation(random))};
+  }};
+
+  const auto queryCount{std::max<std::size_t>(options.operations / 10, 1)};
+  std::vector<std::pair<StationIndex, StationIndex>> pairs(queryCount);
+  std::ranges::generate(pairs, pickPair);
+
+  Itinerary itinerary{};
+  network.SetItineraryCacheCapacity(0);
+  PrintResult(
+    output,
+    Measure(
+      report("GetFastestPath", queryCount),
+      1,
+      [&network, &pairs, &itinerary](const std::size_t i) {
+        network.GetFastestPath(pairs[i].first, pairs[i].second, itinerary);
+        gSink = gSink + itinerary.totalTime;
+      }));
+
+  std::vector<std::pair<StationIndex, StationIndex>> popular(kPopularPairs);
+  std::ranges::generate(popular, pickPair);
+  std::uniform_int_distribution<std::size_t> pickPopular{
+    0,
+    kPopularPairs - 1};
+  for (auto &pair : pairs) {
+    pair = popular[pickPopular(random)];
+  }
+
+  network.SetItineraryCacheCapacity(ItineraryCache::kDefaultCapacity);
+  PrintResult(
+    output,
+    Measure(
+      report("GetFastestPathCached", queryCount),
+      1,
+      [&network, &pairs, &itinerary](const std::size_t i) {
+        network.GetFastestPath(pairs[i].first, pairs[i].second, itinerary);
+        gSink = gSink + itinerary.totalTime;
+      }));
+}
+
+} // namespace
+
+// Prints one JSON object per benchmark and scale to stdout, see PrintResult.
+auto main(const int argc, char **argv) -> int
+{
+  try {
+    const auto options{ParseOptions(argc, argv)};
+    const auto layout{TransportNetworkParser::ParseFile(options.layoutPath)};
+    for (const auto scale : options.scales) {
+      if (scale > 0) {
+        RunScale(layout, scale, options, std::cout);
+      }
+    }
+  }
+  catch (const std::exception &error) {
+    std::cerr << error.what() << '\n';
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <memory>
+#include <utility>
+
+namespace Structures::TransportNetwork {
+
+// Value shared by copies until one of them changes it: copying only bumps a
+// reference count, and Mutable() clones the value first if another copy
+// still refers to it. Reads never clone. A moved-from instance reads as a
+// default-constructed value.
+template <typename T> class CopyOnWrite {
+public:
+  CopyOnWrite()
+      : m_pValue(std::make_shared<T>())
+  {
+  }
+
+  explicit CopyOnWrite(T value)
+      : m_pValue(std::make_shared<T>(std::move(value)))
+  {
+  }
+
+  CopyOnWrite(const CopyOnWrite &) = default;
+  auto operator=(const CopyOnWrite &) -> CopyOnWrite & = default;
+
+  CopyOnWrite(CopyOnWrite &&) noexcept = default;
+  auto operator=(CopyOnWrite &&) noexcept -> CopyOnWrite & = default;
+
+  ~CopyOnWrite() = default;
+
+  [[nodiscard]] auto Get() const -> const T &
+  {
+    static const T kEmpty{};
+    return m_pValue ? *m_pValue : kEmpty;
+  }
+
+  auto operator*() const -> const T & { return Get(); }
+  auto operator->() const -> const T * { return &Get(); }
+
+  // Not to be called while another thread reads this instance.
+  auto Mutable() -> T &
+  {
+    return Mutable([](const T &value) { return value; });
+  }
+
+  // Same, with the private copy made by clone(value), e.g. to allocate it
+  // from a different memory resource.
+  template <typename TClone> auto Mutable(TClone &&clone) -> T &
+  {
+    if (!m_pValue) {
+      m_pValue = std::make_shared<T>();
+    }
+    else if (m_pValue.use_count() > 1) {
+      m_pValue = std::make_shared<T>(clone(std::as_const(*m_pValue)));
+    }
+
+    return *m_pValue;
+  }
+
+  // Whether other copies still refer to the value.
+  [[nodiscard]] auto IsShared() const -> bool
+  {
+    return m_pValue.use_count() > 1;
+  }
+
+private:
+  std::shared_ptr<T> m_pValue;
+};
+
+} // namespace Structures::TransportNetwork
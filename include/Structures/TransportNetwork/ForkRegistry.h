@@ -0,0 +1,57 @@
+#pragma once
+
+#include "TransportNetworkTypes.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Structures::TransportNetwork {
+
+class ForkedPassengerCounts;
+class PassengerCounter;
+
+// Forks made from a network or its plain copies, which share the network's
+// stations and so its passenger counts. A fork reads those counts in place
+// until they are about to change: the first change of a count after each
+// fork hands its previous value to the forks through Capture().
+class ForkRegistry {
+public:
+  ForkRegistry() = default;
+
+  ForkRegistry(const ForkRegistry &) = delete;
+  auto operator=(const ForkRegistry &) -> ForkRegistry & = delete;
+
+  ForkRegistry(ForkRegistry &&) = delete;
+  auto operator=(ForkRegistry &&) -> ForkRegistry & = delete;
+
+  ~ForkRegistry() = default;
+
+  // Zero until the first fork, then bumped by every fork. A count last
+  // captured at another epoch has to be captured before it changes.
+  [[nodiscard]] auto GetEpoch() const -> std::uint64_t
+  {
+    return m_epoch.load(std::memory_order_acquire);
+  }
+
+  // Not to be called while passenger counts of the network change.
+  void Register(const std::shared_ptr<ForkedPassengerCounts> &pCounts);
+
+  // Hands the count of a station, as it is before changing, to the forks that
+  // still read it from source: a station's counter, or null for a count kept
+  // by the ForkedPassengerCounts of the network itself.
+  void Capture(
+    StationIndex station,
+    const PassengerCounter *pSource,
+    std::size_t count) const;
+
+private:
+  mutable std::mutex m_mutex{};
+  std::vector<std::weak_ptr<ForkedPassengerCounts>> m_forks{};
+  std::atomic<std::uint64_t> m_epoch{0};
+};
+
+} // namespace Structures::TransportNetwork
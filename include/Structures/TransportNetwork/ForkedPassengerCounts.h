@@ -0,0 +1,138 @@
+#pragma once
+
+#include "CopyOnWrite.h"
+#include "ForkRegistry.h"
+#include "LazyPages.h"
+#include "PassengerCounter.h"
+#include "TransportNetworkTypes.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace Structures::TransportNetwork {
+
+class Station;
+
+// Passenger counts a fork of a network keeps apart from the network it was
+// forked from, whose stations it otherwise shares. They read as the origin's
+// counts at the time of the fork, so events recorded into either network
+// afterwards leave the other's counts alone. Nothing is copied when forking:
+// a count is read from the station, or from the parent fork's counts, until
+// either the source is about to change and captures it through the origin's
+// ForkRegistry, or the fork changes it. Lock-free like PassengerCounter, but
+// for the first GetClone() of a station.
+class ForkedPassengerCounts {
+public:
+  // Covers the stations the fork was made with. The counts of those pParent
+  // covers are pParent's, the others those of the stations. Counts the fork
+  // changes are captured into the forks of pForks first.
+  ForkedPassengerCounts(
+    CopyOnWrite<std::vector<std::shared_ptr<Station>>> stations,
+    std::shared_ptr<const ForkedPassengerCounts> pParent,
+    std::shared_ptr<ForkRegistry> pForks);
+
+  ForkedPassengerCounts(const ForkedPassengerCounts &) = delete;
+  auto operator=(const ForkedPassengerCounts &)
+    -> ForkedPassengerCounts & = delete;
+
+  ForkedPassengerCounts(ForkedPassengerCounts &&) = delete;
+  auto operator=(ForkedPassengerCounts &&) -> ForkedPassengerCounts & = delete;
+
+  ~ForkedPassengerCounts() = default;
+
+  [[nodiscard]] auto Covers(StationIndex station) const -> bool;
+
+  [[nodiscard]] auto Get(StationIndex station) const -> std::size_t;
+
+  // Atomically replaces the count with update(count), see
+  // PassengerCounter::Update.
+  template <typename TUpdate>
+  void Update(const StationIndex station, TUpdate &&update)
+  {
+    auto &slot{m_slots.Get(station)};
+    beforeChange(station, slot);
+
+    auto count{slot.count.load(std::memory_order_acquire)};
+    std::uint64_t next{};
+    do {
+      if (count == kCloned) {
+        slot.pClone.load(std::memory_order_acquire)->Update(update);
+        return;
+      }
+
+      next = update(
+        count == kUncaptured ? source(station)
+                             : static_cast<std::size_t>(count));
+    } while (!slot.count.compare_exchange_weak(
+      count,
+      next,
+      std::memory_order_acq_rel,
+      std::memory_order_acquire));
+  }
+
+  void Set(StationIndex station, std::size_t count);
+
+  // The fork's own copy of a station, made by clone() on the first call for
+  // the station and returned by every later one. Its count is the fork's
+  // from then on, so events recorded into it count for the fork.
+  template <typename TClone>
+  auto GetClone(const StationIndex station, TClone &&clone)
+    -> std::shared_ptr<Station>
+  {
+    std::lock_guard lock{m_cloneMutex};
+    if (auto pClone{findClone(station)}) {
+      return pClone;
+    }
+
+    return adoptClone(station, clone());
+  }
+
+  // Keeps count as the fork's, unless it already has its own, if source is
+  // where the fork reads the station's count from; see ForkRegistry.
+  void Capture(
+    StationIndex station,
+    const PassengerCounter *pSource,
+    std::size_t count);
+
+  // Heap bytes held, see MemoryUsage.h. Clones count as one station each.
+  [[nodiscard]] auto GetMemoryUsage() const -> std::size_t;
+
+private:
+  // Counts are kept below these.
+  static constexpr auto kUncaptured{
+    std::numeric_limits<std::uint64_t>::max()};
+  static constexpr auto kCloned{kUncaptured - 1};
+
+  struct Slot {
+    std::atomic<std::uint64_t> count{kUncaptured};
+    // Epoch of the fork's registry the count was last captured at.
+    std::atomic<std::uint64_t> epoch{0};
+    // Counter of the station's clone, valid while count is kCloned.
+    std::atomic<PassengerCounter *> pClone{nullptr};
+  };
+
+  // The count the fork had until it captured one, see Get().
+  [[nodiscard]] auto source(StationIndex station) const -> std::size_t;
+
+  void beforeChange(StationIndex station, Slot &slot);
+
+  auto findClone(StationIndex station) const -> std::shared_ptr<Station>;
+  auto adoptClone(StationIndex station, std::shared_ptr<Station> pClone)
+    -> std::shared_ptr<Station>;
+
+  CopyOnWrite<std::vector<std::shared_ptr<Station>>> m_stations;
+  std::shared_ptr<const ForkedPassengerCounts> m_pParent;
+  std::shared_ptr<ForkRegistry> m_pForks;
+  LazyPages<Slot> m_slots;
+
+  mutable std::mutex m_cloneMutex{};
+  std::unordered_map<StationIndex, std::shared_ptr<Station>> m_clones{};
+};
+
+} // namespace Structures::TransportNetwork
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "NetworkArena.h"
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace Structures::TransportNetwork {
+
+using InternedId = std::uint32_t;
+
+constexpr InternedId kInvalidId{std::numeric_limits<InternedId>::max()};
+
+// Maps string identifiers onto dense indices [0, Size()) in insertion order, so
+// that containers can be keyed by a 32-bit integer instead of a string.
+class IdInterner {
+public:
+  IdInterner() = default;
+
+  // The index lives in memory from the allocator's resource.
+  explicit IdInterner(ArenaAllocator<std::byte> allocator);
+
+  IdInterner(const IdInterner &other);
+
+  // Copy whose index lives in memory from the allocator's resource.
+  IdInterner(const IdInterner &other, ArenaAllocator<std::byte> allocator);
+  auto operator=(const IdInterner &other) -> IdInterner &;
+
+  IdInterner(IdInterner &&) = default;
+  auto operator=(IdInterner &&) -> IdInterner & = default;
+
+  ~IdInterner() = default;
+
+  // Returns the index of the id, assigning the next free one if it is new.
+  auto Intern(const std::string &id) -> InternedId;
+
+  // Returns kInvalidId if the id was never interned.
+  [[nodiscard]] auto Find(std::string_view id) const -> InternedId;
+
+  [[nodiscard]] auto Resolve(InternedId index) const -> const std::string &;
+  [[nodiscard]] auto Size() const -> std::size_t;
+
+  // Heap bytes held, see MemoryUsage.h.
+  [[nodiscard]] auto GetMemoryUsage() const -> std::size_t;
+
+  void Reserve(std::size_t size);
+
+private:
+  struct Hash {
+    using is_transparent = void;
+
+    auto operator()(std::string_view id) const noexcept -> std::size_t
+    {
+      return std::hash<std::string_view>{}(id);
+    }
+  };
+
+  void rebuildKeys();
+
+  std::unordered_map<
+    std::string,
+    InternedId,
+    Hash,
+    std::equal_to<>,
+    ArenaAllocator<std::pair<const std::string, InternedId>>>
+    m_indices{};
+
+  // Points into the nodes of m_indices, which are never relocated.
+  std::vector<const std::string *> m_ids{};
+};
+
+} // namespace Structures::TransportNetwork
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "PathFinder.h"
+#include "TransportNetworkTypes.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace Structures::TransportNetwork {
+
+struct ItineraryCacheStats {
+  std::size_t hits{};
+  std::size_t misses{};
+  std::size_t evictions{};
+
+  // Entries dropped because a hop they ride changed.
+  std::size_t invalidations{};
+  std::size_t entries{};
+};
+
+// Fixed number of fastest itineraries keyed by (start, end, options), with
+// CLOCK eviction: a hit only sets the entry's reference bit, so lookups run
+// concurrently under a shared lock, and the hand clears bits until it finds
+// an entry not used since its last pass. Every entry is also listed under
+// the hops, pairs of consecutive stations, it rides, so that a change to a
+// hop drops only the entries that use it. Slots are allocated as entries
+// come in, so that a cache never queried, or a copy of one, costs little.
+//
+// Find() and Insert() may be called from any number of threads.
+class ItineraryCache {
+public:
+  static constexpr std::size_t kDefaultCapacity{4096};
+
+  explicit ItineraryCache(std::size_t capacity = kDefaultCapacity);
+
+  ItineraryCache(const ItineraryCache &other);
+  auto operator=(const ItineraryCache &) -> ItineraryCache & = delete;
+
+  ItineraryCache(ItineraryCache &&) = delete;
+  auto operator=(ItineraryCache &&) -> ItineraryCache & = delete;
+
+  ~ItineraryCache() = default;
+
+  [[nodiscard]] auto GetCapacity() const -> std::size_t;
+  [[nodiscard]] auto GetStats() const -> ItineraryCacheStats;
+
+  // Heap bytes held, see MemoryUsage.h.
+  [[nodiscard]] auto GetMemoryUsage() const -> std::size_t;
+
+  // Copies the cached itinerary into result, which is left alone on a miss.
+  auto Find(
+    StationIndex start,
+    StationIndex end,
+    const ItineraryOptions &options,
+    Itinerary &result) -> bool;
+
+  // An empty itinerary records that end is unreachable.
+  void Insert(
+    StationIndex start,
+    StationIndex end,
+    const ItineraryOptions &options,
+    const Itinerary &itinerary);
+
+  // Drops the entries that ride from one station straight to the other.
+  void InvalidateHop(StationIndex from, StationIndex to);
+  void Clear();
+
+private:
+  struct Key {
+    StationIndex start{kInvalidId};
+    StationIndex end{kInvalidId};
+    ItineraryOptions options{};
+
+    auto operator==(const Key &other) const -> bool = default;
+  };
+
+  struct KeyHash {
+    auto operator()(const Key &key) const -> std::size_t;
+  };
+
+  struct Slot {
+    Slot() = default;
+    Slot(const Slot &other);
+    auto operator=(const Slot &) -> Slot & = delete;
+
+    Slot(Slot &&other) noexcept;
+    auto operator=(Slot &&) -> Slot & = delete;
+
+    ~Slot() = default;
+
+    Key key{};
+    Itinerary itinerary{};
+    bool used{false};
+    std::atomic<bool> referenced{false};
+  };
+
+  static auto hopKey(StationIndex from, StationIndex to) -> std::uint64_t;
+
+  // Slot to fill next, evicting an entry if the cache is full.
+  auto takeSlot() -> std::uint32_t;
+  void erase(std::uint32_t slot);
+
+  const std::size_t m_capacity;
+
+  mutable std::shared_mutex m_mutex{};
+  std::vector<Slot> m_slots{};
+  std::vector<std::uint32_t> m_freeSlots{};
+  std::unordered_map<Key, std::uint32_t, KeyHash> m_entries{};
+  std::unordered_map<std::uint64_t, std::vector<std::uint32_t>> m_hops{};
+  std::size_t m_hand{0};
+
+  std::atomic<std::size_t> m_hits{0};
+  std::atomic<std::size_t> m_misses{0};
+  std::atomic<std::size_t> m_evictions{0};
+  std::atomic<std::size_t> m_invalidations{0};
+};
+
+} // namespace Structures::TransportNetwork
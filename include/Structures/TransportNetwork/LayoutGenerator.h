@@ -0,0 +1,63 @@
+#pragma once
+
+#include "NetworkLayout.h"
+#include "PassengerStatistics.h"
+#include "TransportNetwork.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Structures::TransportNetwork {
+
+struct LayoutGeneratorOptions {
+  std::size_t stationCount{1000};
+  std::size_t lineCount{20};
+
+  // Stops of every route, at least 2 and at most stationCount.
+  std::size_t routeLength{50};
+
+  // Share of a line's stops, in [0, 1], taken from stations that earlier
+  // lines already serve. Any positive density connects every line to an
+  // earlier one through at least one interchange.
+  double interchangeDensity{0.2};
+
+  unsigned int minTravelTime{1};
+  unsigned int maxTravelTime{5};
+  std::uint64_t seed{1};
+};
+
+struct PassengerEventOptions {
+  std::size_t eventCount{100000};
+
+  // Gaps between consecutive events are drawn from [0, 2 * meanInterval].
+  PassengerTimestamp start{std::chrono::seconds{1704067200}};
+  std::chrono::microseconds meanInterval{1000};
+
+  // Chance of an event being a passenger leaving a station, rather than
+  // entering one.
+  double outShare{0.5};
+  std::uint64_t seed{1};
+};
+
+// Synthetic layouts in the shape of network-layout.json, for testing at scales
+// the real layout does not reach. Output depends only on the options: draws are
+// made from std::mt19937_64 directly, as the standard distributions differ
+// between standard libraries.
+class LayoutGenerator {
+public:
+  // Every line gets an inbound route and an outbound one walking the same
+  // stops backwards, and one travel time per pair of neighbouring stops.
+  // Throws std::invalid_argument for options out of range.
+  static auto Generate(const LayoutGeneratorOptions &options) -> NetworkLayout;
+
+  // Events at the stations of the layout, weighted by the number of lines
+  // serving them. Passengers only leave stations they entered earlier in the
+  // stream, so a network built from the layout accepts every event.
+  static auto GeneratePassengerEvents(
+    const NetworkLayout &layout,
+    const PassengerEventOptions &options) -> std::vector<PassengerEvent>;
+};
+
+} // namespace Structures::TransportNetwork
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+
+namespace Structures::TransportNetwork {
+
+// Fixed number of value-initialized elements, allocated a page at a time when
+// an element of the page is first asked for, so that making one costs a
+// table of page pointers however many elements it holds. Find() and Get() may
+// be called from any number of threads; elements must synchronize themselves.
+template <typename T, std::size_t kPageSize = 256> class LazyPages {
+public:
+  explicit LazyPages(const std::size_t size)
+      : m_size(size),
+        m_pages(std::make_unique<std::atomic<T *>[]>(pageCount(size)))
+  {
+  }
+
+  LazyPages(const LazyPages &) = delete;
+  auto operator=(const LazyPages &) -> LazyPages & = delete;
+
+  LazyPages(LazyPages &&) = delete;
+  auto operator=(LazyPages &&) -> LazyPages & = delete;
+
+  ~LazyPages()
+  {
+    for (std::size_t page{0}; page < pageCount(m_size); ++page) {
+      delete[] m_pages[page].load(std::memory_order_relaxed);
+    }
+  }
+
+  [[nodiscard]] auto Size() const -> std::size_t { return m_size; }
+
+  // Null if no element of the page was asked for yet.
+  [[nodiscard]] auto Find(const std::size_t index) const -> const T *
+  {
+    assert(index < m_size);
+    const auto *pPage{
+      m_pages[index / kPageSize].load(std::memory_order_acquire)};
+    return pPage ? pPage + index % kPageSize : nullptr;
+  }
+
+  auto Get(const std::size_t index) -> T &
+  {
+    assert(index < m_size);
+    auto &page{m_pages[index / kPageSize]};
+    auto *pPage{page.load(std::memory_order_acquire)};
+    if (pPage == nullptr) {
+      // Racing threads allocate a page each, all but the first to publish
+      // theirs free it again.
+      auto *pNew{new T[kPageSize]{}};
+      if (page.compare_exchange_strong(
+            pPage,
+            pNew,
+            std::memory_order_acq_rel,
+            std::memory_order_acquire)) {
+        pPage = pNew;
+        m_allocatedPages.fetch_add(1, std::memory_order_relaxed);
+      }
+      else {
+        delete[] pNew;
+      }
+    }
+
+    return pPage[index % kPageSize];
+  }
+
+  // Heap bytes held, see MemoryUsage.h.
+  [[nodiscard]] auto GetMemoryUsage() const -> std::size_t
+  {
+    return pageCount(m_size) * sizeof(std::atomic<T *>) +
+           m_allocatedPages.load(std::memory_order_relaxed) * kPageSize *
+             sizeof(T);
+  }
+
+private:
+  static constexpr auto pageCount(const std::size_t size) -> std::size_t
+  {
+    return (size + kPageSize - 1) / kPageSize;
+  }
+
+  std::size_t m_size;
+  std::unique_ptr<std::atomic<T *>[]> m_pages;
+  std::atomic<std::size_t> m_allocatedPages{0};
+};
+
+} // namespace Structures::TransportNetwork
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Structures::TransportNetwork {
+
+// Estimates of the heap memory held by standard containers, for the
+// GetMemoryUsage() methods of the network's structures. They only read sizes
+// and capacities, so they are cheap enough to call at any time. None of them
+// counts the object itself, which its owner accounts for.
+
+// Bytes a std::make_shared allocation adds to the object: the control block's
+// two counts and its vtable pointer.
+constexpr std::size_t kSharedControlBlockBytes{
+  sizeof(void *) + 2 * sizeof(int)};
+
+// A hash table node holds the next pointer and the cached hash next to the
+// element.
+constexpr std::size_t kHashNodeOverheadBytes{2 * sizeof(void *)};
+
+[[nodiscard]] inline auto HeapBytes(const std::string &string) -> std::size_t
+{
+  // Short strings live inside the object.
+  static const auto kInlineCapacity{std::string{}.capacity()};
+  return string.capacity() > kInlineCapacity ? string.capacity() + 1 : 0;
+}
+
+template <typename T, typename TAllocator>
+[[nodiscard]] auto HeapBytes(const std::vector<T, TAllocator> &vector)
+  -> std::size_t
+{
+  return vector.capacity() * sizeof(T);
+}
+
+// Buckets and nodes of a std::unordered_* container or hashed index.
+template <typename THashTable>
+[[nodiscard]] auto HashTableBytes(const THashTable &table) -> std::size_t
+{
+  return table.bucket_count() * sizeof(void *) +
+         table.size() *
+           (sizeof(typename THashTable::value_type) + kHashNodeOverheadBytes);
+}
+
+// Allocation of an object made with std::make_shared, zero for null.
+template <typename T>
+[[nodiscard]] auto SharedBytes(const std::shared_ptr<T> &pObject) -> std::size_t
+{
+  return pObject ? sizeof(T) + kSharedControlBlockBytes : 0;
+}
+
+} // namespace Structures::TransportNetwork
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Structures::TransportNetwork {
+
+// Memory resource for the layout of a network. While a network is loaded,
+// allocations are carved out of a few large monotonic blocks, deallocation
+// does nothing, and the blocks are released together when the arena is
+// destroyed. Everything else, the diffs, rehashes and copy-on-write clones
+// of a network that keeps changing, is drawn from a pool that reuses what is
+// freed, so that the arena does not grow without bound. Copies of a network
+// share its arena, so allocation is serialized with a mutex; loading a
+// network allocates from a single thread, which never has to wait for it.
+class NetworkArena final : public std::pmr::memory_resource {
+public:
+  static constexpr std::size_t kDefaultBlockSize{64 * 1024};
+
+  explicit NetworkArena(
+    std::size_t initialBlockSize = kDefaultBlockSize,
+    std::pmr::memory_resource *pUpstream = std::pmr::get_default_resource());
+
+  NetworkArena(const NetworkArena &) = delete;
+  auto operator=(const NetworkArena &) -> NetworkArena & = delete;
+
+  NetworkArena(NetworkArena &&) = delete;
+  auto operator=(NetworkArena &&) -> NetworkArena & = delete;
+
+  ~NetworkArena() override = default;
+
+  // Allocations made while any load is under way are carved out of the
+  // monotonic blocks. Loads may overlap, as when builders share the arena,
+  // and each BeginLoad() needs an EndLoad() of its own; see
+  // TransportNetworkBuilder.
+  void BeginLoad();
+  void EndLoad();
+
+  // Bytes handed out and not freed; those of the monotonic blocks count
+  // until destruction.
+  [[nodiscard]] auto GetAllocatedBytes() const -> std::size_t;
+
+private:
+  // Upstream of the monotonic resource, which remembers the blocks it hands
+  // out so that deallocation can tell their memory from the pool's.
+  class BlockResource final : public std::pmr::memory_resource {
+  public:
+    explicit BlockResource(std::pmr::memory_resource *pUpstream);
+
+    [[nodiscard]] auto Contains(const void *p) const -> bool;
+
+  private:
+    auto do_allocate(std::size_t bytes, std::size_t alignment)
+      -> void * override;
+    void do_deallocate(void *p, std::size_t bytes, std::size_t alignment)
+      override;
+    [[nodiscard]] auto do_is_equal(
+      const std::pmr::memory_resource &other) const noexcept -> bool override;
+
+    std::pmr::memory_resource *m_pUpstream;
+    std::vector<std::pair<const std::byte *, std::size_t>> m_blocks{};
+  };
+
+  auto do_allocate(std::size_t bytes, std::size_t alignment) -> void * override;
+  void do_deallocate(void *p, std::size_t bytes, std::size_t alignment)
+    override;
+  [[nodiscard]] auto do_is_equal(const std::pmr::memory_resource &other) const
+    noexcept -> bool override;
+
+  mutable std::mutex m_mutex{};
+  BlockResource m_blocks;
+  std::pmr::monotonic_buffer_resource m_resource;
+  std::pmr::unsynchronized_pool_resource m_pool;
+  std::size_t m_loads{0};
+  std::size_t m_allocatedBytes{0};
+};
+
+// Allocator drawing from a memory resource it co-owns, so that a container,
+// or an object made with std::allocate_shared, keeps its resource alive for
+// as long as it holds memory from it. It propagates with the container's
+// contents, which therefore never outlive their resource however networks
+// are copied, moved or swapped.
+template <typename T> class ArenaAllocator {
+public:
+  using value_type = T;
+  using propagate_on_container_copy_assignment = std::true_type;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+
+  // Allocates from std::pmr::get_default_resource().
+  ArenaAllocator() noexcept
+      : ArenaAllocator(nullptr)
+  {
+  }
+
+  // Null stands for std::pmr::get_default_resource().
+  explicit ArenaAllocator(
+    std::shared_ptr<std::pmr::memory_resource> pResource) noexcept
+      : m_pResource(
+          pResource ? std::move(pResource)
+                    : std::shared_ptr<std::pmr::memory_resource>{
+                        std::shared_ptr<void>{},
+                        std::pmr::get_default_resource()})
+  {
+  }
+
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U> &other) noexcept
+      : m_pResource(other.GetResource())
+  {
+  }
+
+  // No move: a moved-from container must still be able to allocate.
+  ArenaAllocator(const ArenaAllocator &) noexcept = default;
+  auto operator=(const ArenaAllocator &) noexcept
+    -> ArenaAllocator & = default;
+
+  ~ArenaAllocator() = default;
+
+  [[nodiscard]] auto allocate(const std::size_t count) -> T *
+  {
+    if (count > std::numeric_limits<std::size_t>::max() / sizeof(T)) {
+      throw std::bad_array_new_length{};
+    }
+
+    return static_cast<T *>(
+      m_pResource->allocate(count * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T *p, const std::size_t count) noexcept
+  {
+    m_pResource->deallocate(p, count * sizeof(T), alignof(T));
+  }
+
+  [[nodiscard]] auto GetResource() const noexcept
+    -> const std::shared_ptr<std::pmr::memory_resource> &
+  {
+    return m_pResource;
+  }
+
+  template <typename U>
+  auto operator==(const ArenaAllocator<U> &other) const noexcept -> bool
+  {
+    return *m_pResource == *other.GetResource();
+  }
+
+private:
+  std::shared_ptr<std::pmr::memory_resource> m_pResource;
+};
+
+template <typename T> using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+} // namespace Structures::TransportNetwork
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "TransportNetwork.h"
+#include "TransportNetworkTypes.h"
+
+#include <vector>
+
+namespace Structures::TransportNetwork {
+
+struct LayoutTravelTime {
+  StationId startStationId{};
+  StationId endStationId{};
+  LineId lineId{};
+  RouteId routeId{};
+  unsigned int travelTime{};
+};
+
+// Plain description of a network, as found in network-layout.json.
+struct NetworkLayout {
+  std::vector<Station> stations{};
+  std::vector<Line> lines{};
+  std::vector<LayoutTravelTime> travelTimes{};
+};
+
+} // namespace Structures::TransportNetwork
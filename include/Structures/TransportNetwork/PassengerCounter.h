@@ -0,0 +1,116 @@
+#pragma once
+
+#include "ForkRegistry.h"
+#include "TransportNetworkTypes.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+namespace Structures::TransportNetwork {
+
+constexpr std::size_t kCacheLineSize{64};
+
+// Lock-free passenger counter. Each instance occupies a cache line of its own
+// so that stations updated from different threads do not false-share. The
+// counter of a station in a network is tracked by the network's ForkRegistry,
+// which it hands its count to before it first changes after each fork.
+class alignas(kCacheLineSize) PassengerCounter {
+public:
+  explicit PassengerCounter(std::size_t count = 0)
+      : m_count{count}
+  {
+  }
+
+  // Copies take a snapshot of the current value and are not tracked.
+  // Assigning stores the value as is, without capturing the previous one.
+  PassengerCounter(const PassengerCounter &other)
+      : m_count{other.Get()}
+  {
+  }
+
+  auto operator=(const PassengerCounter &other) -> PassengerCounter &
+  {
+    m_count.store(other.Get(), std::memory_order_release);
+    return *this;
+  }
+
+  ~PassengerCounter() = default;
+
+  // Not to be called while the counter changes.
+  void Track(std::shared_ptr<ForkRegistry> pForks, const StationIndex station)
+  {
+    m_pForks = std::move(pForks);
+    m_station = station;
+  }
+
+  void Increment()
+  {
+    capture();
+    m_count.fetch_add(1, std::memory_order_release);
+  }
+
+  // Fails instead of going below zero.
+  auto TryDecrement() -> bool
+  {
+    capture();
+    auto count{m_count.load(std::memory_order_relaxed)};
+    do {
+      if (count == 0) {
+        return false;
+      }
+    } while (!m_count.compare_exchange_weak(
+      count,
+      count - 1,
+      std::memory_order_release,
+      std::memory_order_relaxed));
+
+    return true;
+  }
+
+  // Atomically replaces the count with update(count). Under contention the
+  // update is retried with the fresh count, so it must be idempotent.
+  template <typename TUpdate> void Update(TUpdate &&update)
+  {
+    capture();
+    auto count{m_count.load(std::memory_order_relaxed)};
+    while (!m_count.compare_exchange_weak(
+      count,
+      update(count),
+      std::memory_order_release,
+      std::memory_order_relaxed)) {
+    }
+  }
+
+  // Acquires the change that made the count, so that forks finding their
+  // snapshot uncaptured after reading it know the count is still theirs.
+  [[nodiscard]] auto Get() const -> std::size_t
+  {
+    return m_count.load(std::memory_order_acquire);
+  }
+
+private:
+  void capture()
+  {
+    if (!m_pForks) {
+      return;
+    }
+
+    // Threads racing here capture the same count: each captures before it
+    // changes the count, and forks keep the first count captured.
+    const auto epoch{m_pForks->GetEpoch()};
+    if (m_capturedEpoch.load(std::memory_order_acquire) != epoch) {
+      m_pForks->Capture(m_station, this, Get());
+      m_capturedEpoch.store(epoch, std::memory_order_release);
+    }
+  }
+
+  std::atomic<std::size_t> m_count;
+  std::atomic<std::uint64_t> m_capturedEpoch{0};
+  std::shared_ptr<ForkRegistry> m_pForks{};
+  StationIndex m_station{};
+};
+
+} // namespace Structures::TransportNetwork
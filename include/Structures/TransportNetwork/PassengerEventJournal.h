@@ -0,0 +1,207 @@
+#pragma once
+
+#include "TransportNetwork.h"
+#include "TransportNetworkTypes.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include <boost/lockfree/spsc_queue.hpp>
+
+namespace Structures::TransportNetwork {
+
+constexpr std::uint32_t kJournalVersion{1};
+
+struct JournalOptions {
+  // Longest a flushed event waits before its group of events is committed.
+  std::chrono::milliseconds commitInterval{10};
+
+  // Size a segment grows to before a checkpoint is taken and a new segment
+  // begun, bounding the journal tail replayed on recovery.
+  std::uint64_t checkpointBytes{std::uint64_t{64} << 20U};
+
+  // Events each writer may have flushed ahead of the committer.
+  std::size_t writerCapacity{std::size_t{1} << 18U};
+};
+
+// Journaled event. The stamp holds microseconds since the epoch shifted left
+// by one and or-ed with the type, split in halves to keep records 12 bytes.
+struct JournalRecord {
+  StationIndex station{kInvalidId};
+  std::array<std::uint32_t, 2> stamp{};
+};
+
+struct JournalRecovery {
+  bool hasCheckpoint{};
+  std::size_t segmentCount{};
+  std::size_t recordCount{};
+
+  // Of a torn last commit, and of whatever followed it.
+  std::uint64_t discardedBytes{};
+};
+
+// Write-ahead journal of the passenger events recorded into a network, so
+// that counts survive a restart. Events are recorded into the network
+// through a Writer, one per producer thread, which journals the accepted
+// ones as 12-byte records: station index, type and timestamp to the
+// microsecond. A committer thread collects them every commit interval and
+// appends them to the current segment as one checksummed block, followed by
+// a single fdatasync for the whole group.
+//
+// The committer also keeps the counts the journal adds up to. A checkpoint
+// writes them out, along with the segment the events after them begin in,
+// and drops the segments before it; recovery loads the last checkpoint and
+// replays the segments since. Layout, directory and file formats are:
+//
+//   checkpoint.bin       header, stationCount x i64 count
+//   journal-NNNNNN.bin   header, blocks of {u32 count, u32 checksum,
+//                        count x {u32 station, u64 microseconds << 1 | type}}
+//
+// Both are in the byte order of the machine that wrote them.
+class PassengerEventJournal {
+public:
+  class Writer {
+  public:
+    // Flushed after this many events.
+    static constexpr std::size_t kBatchSize{64};
+
+    Writer(const Writer &) = delete;
+    auto operator=(const Writer &) -> Writer & = delete;
+
+    Writer(Writer &&) = default;
+    auto operator=(Writer &&) -> Writer & = delete;
+
+    ~Writer();
+
+    // Records the event into the network and journals it if accepted, see
+    // TransportNetwork::RecordPassengerEvent. Events without a timestamp are
+    // stamped here. Waits while the committer is behind, and throws
+    // std::runtime_error if it has failed.
+    auto Record(const PassengerEvent &event) -> bool;
+    auto Record(
+      StationIndex station,
+      PassengerEvent::Type type,
+      PassengerTimestamp timestamp = {}) -> bool;
+
+    // Returns the number of events accepted.
+    auto Record(std::span<const PassengerEvent> events) -> std::size_t;
+
+    // Hands the events recorded since the last flush to the committer.
+    void Flush();
+
+  private:
+    friend class PassengerEventJournal;
+
+    struct Channel {
+      explicit Channel(std::size_t capacity);
+
+      boost::lockfree::spsc_queue<JournalRecord> queue;
+      std::atomic<bool> closed{false};
+    };
+
+    Writer(PassengerEventJournal &journal, std::size_t capacity);
+
+    PassengerEventJournal *m_pJournal;
+    std::shared_ptr<Channel> m_pChannel;
+    std::array<JournalRecord, kBatchSize> m_batch{};
+    std::size_t m_batchSize{};
+  };
+
+  // Opens the journal in directory, creating it if need be, and checkpoints
+  // the network's current counts there, replacing whatever the directory
+  // held: recover from it first to carry on from a previous run. Throws
+  // std::runtime_error on I/O errors. The network must outlive the journal
+  // and not change its layout meanwhile.
+  PassengerEventJournal(
+    const TransportNetwork &network,
+    std::filesystem::path directory,
+    JournalOptions options = {});
+
+  PassengerEventJournal(const PassengerEventJournal &) = delete;
+  auto operator=(const PassengerEventJournal &)
+    -> PassengerEventJournal & = delete;
+
+  PassengerEventJournal(PassengerEventJournal &&) = delete;
+  auto operator=(PassengerEventJournal &&) -> PassengerEventJournal & = delete;
+
+  // Commits the events still flushed before stopping the committer. Every
+  // writer must have been destroyed by then.
+  ~PassengerEventJournal();
+
+  // Safe to call from any thread.
+  [[nodiscard]] auto CreateWriter() -> Writer;
+
+  // Blocks until every event flushed before the call is durable. Throws
+  // std::runtime_error if the committer has failed.
+  void Sync();
+
+  // Same, then checkpoints the counts and starts a new segment.
+  void Checkpoint();
+
+  // Replaces the passenger counts of the network with the ones in the
+  // journal in directory, and adds the replayed events to the stations'
+  // statistics. Replay stops at the first torn or corrupt block, which is
+  // where the last run crashed; the rest is reported as discarded. A count
+  // below zero, left by an Out whose In was lost unflushed in another
+  // writer, recovers as zero. The network must not be a fork and have the
+  // layout it had when journaled.
+  // Throws std::runtime_error if the checkpoint is corrupt or does not fit
+  // the network, and on I/O errors.
+  static auto Recover(
+    const std::filesystem::path &directory,
+    const TransportNetwork &network) -> JournalRecovery;
+
+private:
+  void commit(const std::stop_token &stopToken);
+
+  // Drains the writers into checksummed blocks and makes them durable.
+  void commitPass();
+  void requestCommit();
+
+  // Begins the next segment, then writes out the counts up to it.
+  void checkpoint();
+  void writeCheckpoint() const;
+
+  [[nodiscard]] auto segmentPath(std::uint64_t segment) const
+    -> std::filesystem::path;
+
+  const TransportNetwork &m_network;
+  const std::filesystem::path m_directory;
+  const JournalOptions m_options;
+  const std::size_t m_stationCount;
+
+  // Written by the committer only, after construction. Signed, as the
+  // writers' events are committed in no particular order.
+  std::vector<std::int64_t> m_counts{};
+  std::vector<JournalRecord> m_drained{};
+  std::uint64_t m_segment{};
+  std::uint64_t m_segmentSize{};
+  int m_fd{-1};
+
+  std::mutex m_mutex{};
+  std::condition_variable_any m_wakeup{};
+  std::condition_variable m_committed{};
+  std::vector<std::shared_ptr<Writer::Channel>> m_channels{};
+  std::uint64_t m_startedPasses{};
+  std::uint64_t m_completedPasses{};
+  bool m_checkpointRequested{};
+  std::exception_ptr m_pError{};
+
+  std::atomic<bool> m_commitRequested{false};
+  std::atomic<bool> m_failed{false};
+
+  std::jthread m_committer{};
+};
+
+} // namespace Structures::TransportNetwork
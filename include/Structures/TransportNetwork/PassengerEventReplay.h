@@ -0,0 +1,95 @@
+#pragma once
+
+#include "TransportNetwork.h"
+#include "TransportNetworkTypes.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace Structures::TransportNetwork {
+
+struct ReplayOptions {
+  // Zero replays as fast as possible. Otherwise events are paced to their
+  // timestamps, played back this many times faster than they were recorded.
+  double speed{0.0};
+
+  // Threads replaying in parallel when unpaced, at least one.
+  std::size_t threadCount{1};
+};
+
+struct ReplayReport {
+  std::size_t accepted{};
+  std::size_t rejected{};
+  std::chrono::nanoseconds elapsed{};
+
+  // Of the network once replayed, see PassengerEventReplay::Checksum().
+  std::uint64_t checksum{};
+
+  [[nodiscard]] auto EventsPerSecond() const -> double;
+};
+
+// Replays a recorded log of passenger events into a network, to reproduce
+// incidents or to benchmark ingestion. Events are resolved to station indices
+// once, up front, and replayed through TransportNetwork::RecordPassengerEvent
+// with their recorded timestamps.
+//
+// Unpaced, each station's events are replayed in their recorded order, but
+// grouped by station: a station's counters then stay in cache from one event
+// to the next, and threads replay disjoint sets of stations without ever
+// contending. Counts, statistics and segment loads end up the same as if the
+// events were recorded one by one in order; only readers looking on during
+// the replay can tell the difference.
+class PassengerEventReplay {
+public:
+  // Events for stations unknown to the network are kept, and rejected on
+  // replay. Throws std::logic_error for logs of 2^32 events or more.
+  PassengerEventReplay(
+    const TransportNetwork &network,
+    std::span<const PassengerEvent> events);
+
+  [[nodiscard]] auto GetEventCount() const -> std::size_t;
+
+  // Replays the events into the network they were resolved against, or a
+  // copy or fork of it, which share its station indices; forks replay the
+  // same log over and over from the same counts. Throws std::logic_error if
+  // the network has fewer stations than the one the events were resolved
+  // against. No thread may change the network meanwhile.
+  auto Run(const TransportNetwork &network, const ReplayOptions &options = {})
+    const -> ReplayReport;
+
+  // Order-sensitive hash of the passenger count of every station, equal for
+  // networks whose counts are.
+  [[nodiscard]] static auto Checksum(const TransportNetwork &network)
+    -> std::uint64_t;
+
+private:
+  struct ResolvedEvent {
+    StationIndex station{kInvalidId};
+    PassengerEvent::Type type{};
+    PassengerTimestamp timestamp{};
+  };
+
+  // Replays m_events[first, last) and adds up the outcome in report.
+  void replay(
+    const TransportNetwork &network,
+    std::size_t first,
+    std::size_t last,
+    ReplayReport &report) const;
+  void replayPaced(
+    const TransportNetwork &network,
+    double speed,
+    ReplayReport &report) const;
+
+  // Sorted by station, unknown ones last, each station's in recorded order.
+  std::vector<ResolvedEvent> m_events{};
+
+  // Positions in m_events in recorded order.
+  std::vector<std::uint32_t> m_order{};
+
+  std::size_t m_stationCount{};
+};
+
+} // namespace Structures::TransportNetwork
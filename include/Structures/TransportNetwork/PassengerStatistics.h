@@ -0,0 +1,80 @@
+#pragma once
+
+#include "PassengerCounter.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace Structures::TransportNetwork {
+
+using PassengerClock = std::chrono::system_clock;
+using PassengerTimestamp = PassengerClock::time_point;
+
+// Passengers per minute.
+struct PassengerRates {
+  double in{};
+  double out{};
+};
+
+// Lock-free ring of time buckets counting the passengers that entered and left
+// a station. Every bucket packs its time tag and both counts into one atomic
+// word, so that recording an event is a single compare-and-swap and a bucket
+// is recycled by the first event of a newer period that maps onto it.
+class alignas(kCacheLineSize) PassengerStatistics {
+public:
+  static constexpr std::size_t kBucketCount{64};
+  static constexpr std::chrono::seconds kBucketWidth{60};
+
+  PassengerStatistics() = default;
+
+  // Copies take a snapshot of the current buckets.
+  PassengerStatistics(const PassengerStatistics &other);
+  auto operator=(const PassengerStatistics &other) -> PassengerStatistics &;
+
+  ~PassengerStatistics() = default;
+
+  // A default-constructed timestamp stands for now. Events older than the
+  // ring, or for a bucket that has already been recycled, are dropped.
+  // Counts saturate at about a million per bucket.
+  void Record(
+    PassengerTimestamp timestamp,
+    std::uint32_t in,
+    std::uint32_t out);
+
+  // The window is rounded up to whole buckets, at most kBucketCount of them,
+  // and ends with the bucket of now, which counts as a full one.
+  [[nodiscard]] auto GetRates(
+    std::chrono::seconds window,
+    PassengerTimestamp now = PassengerClock::now()) const -> PassengerRates;
+
+  // Nearest-rank percentile, in [0, 100], of the per-bucket rates over the
+  // window.
+  [[nodiscard]] auto GetRatePercentiles(
+    std::chrono::seconds window,
+    double percentile,
+    PassengerTimestamp now = PassengerClock::now()) const -> PassengerRates;
+
+  // Index of the bucket period that contains the timestamp.
+  [[nodiscard]] static auto GetPeriod(PassengerTimestamp timestamp)
+    -> std::uint64_t;
+
+private:
+  struct Counts {
+    std::uint32_t in{};
+    std::uint32_t out{};
+  };
+
+  // Fills counts with the buckets of the window, oldest first, and returns
+  // their number.
+  auto collect(
+    std::chrono::seconds window,
+    PassengerTimestamp now,
+    std::array<Counts, kBucketCount> &counts) const -> std::size_t;
+
+  std::array<std::atomic<std::uint64_t>, kBucketCount> m_buckets{};
+};
+
+} // namespace Structures::TransportNetwork
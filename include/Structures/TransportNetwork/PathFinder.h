@@ -0,0 +1,109 @@
+#pragma once
+
+#include "TransportGraph.h"
+#include "TransportNetworkTypes.h"
+
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <span>
+#include <vector>
+
+namespace Structures::TransportNetwork {
+
+constexpr unsigned int kDefaultLineChangePenalty{5};
+constexpr unsigned int kDefaultPassengersPerMinute{50};
+constexpr unsigned int kDefaultOverlapPenalty{100};
+constexpr unsigned int kUnreachableTime{std::numeric_limits<unsigned>::max()};
+
+struct ItineraryOptions {
+  // Added to the total time whenever the itinerary changes route at a stop.
+  unsigned int lineChangePenalty{kDefaultLineChangePenalty};
+
+  auto operator==(const ItineraryOptions &other) const -> bool = default;
+};
+
+struct ItineraryStep {
+  StationIndex station{kInvalidId};
+
+  // Route taken from the previous step, kInvalidId for the first step.
+  RouteIndex route{kInvalidId};
+
+  auto operator==(const ItineraryStep &other) const -> bool = default;
+};
+
+struct Itinerary {
+  std::vector<ItineraryStep> steps{};
+
+  // Time spent travelling between stations.
+  unsigned int travelTime{};
+
+  // Travel time plus the penalties of every route change.
+  unsigned int totalTime{};
+
+  [[nodiscard]] auto Empty() const -> bool { return steps.empty(); }
+};
+
+struct QuietItineraryOptions {
+  unsigned int lineChangePenalty{kDefaultLineChangePenalty};
+
+  // Passing through a station with this many passengers costs as much as one
+  // more minute of travel. Zero ignores crowding.
+  unsigned int passengersPerMinute{kDefaultPassengersPerMinute};
+
+  // Percentage by which the edges of every itinerary found get more
+  // expensive for the searches that follow, steering them onto alternatives.
+  unsigned int overlapPenalty{kDefaultOverlapPenalty};
+};
+
+struct QuietItinerary {
+  Itinerary itinerary{};
+
+  // Passengers at the stations the itinerary arrives at, end included, when
+  // it was computed.
+  std::size_t crowding{};
+
+  // Total time plus the crowding cost; itineraries are ranked by it.
+  unsigned int score{};
+};
+
+// Runs Dijkstra over the edges of the graph, so that a route change can be
+// charged when leaving a stop on a different route than the one arrived on.
+// Search state lives in thread-local buffers that only grow; reusing the
+// same result object across calls therefore makes the query allocation-free.
+// Returns false and leaves the result empty if end is unreachable.
+auto FindFastestPath(
+  const TransportGraph &graph,
+  StationIndex start,
+  StationIndex end,
+  const ItineraryOptions &options,
+  Itinerary &result) -> bool;
+
+// Total time of the fastest itinerary from start to every station, as
+// FindFastestPath would report it, or kUnreachableTime. times must hold one
+// element per station of the graph.
+void FindTravelTimes(
+  const TransportGraph &graph,
+  StationIndex start,
+  const ItineraryOptions &options,
+  std::span<unsigned int> times);
+
+// Passengers at a station, for crowding costs.
+using PassengerCountFunction = std::function<std::size_t(StationIndex)>;
+
+// Up to count distinct itineraries, best score first, found by repeating the
+// search with the edges of earlier results penalized. passengerCount is only
+// called for the stations the searches reach, once per station and query.
+// Shares the thread-local buffers of FindFastestPath, and reuses the
+// itineraries already in results. Returns false and leaves results empty if
+// end is unreachable.
+auto FindQuietItineraries(
+  const TransportGraph &graph,
+  StationIndex start,
+  StationIndex end,
+  std::size_t count,
+  const QuietItineraryOptions &options,
+  const PassengerCountFunction &passengerCount,
+  std::vector<QuietItinerary> &results) -> bool;
+
+} // namespace Structures::TransportNetwork
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "LazyPages.h"
+#include "PassengerStatistics.h"
+#include "TransportGraph.h"
+#include "TransportNetworkTypes.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace Structures::TransportNetwork {
+
+// Estimated number of passengers riding a route between the stops at
+// position and position + 1 over a window of time.
+struct SegmentLoad {
+  RouteIndex route{kInvalidId};
+  StopPosition position{};
+  double load{};
+};
+
+// Estimates the passenger load of every route segment from station events
+// alone. A passenger entering a station is assumed to board, in equal shares,
+// every route that leaves it; one leaving a station to alight, in equal
+// shares, from every route that arrives at it. The net flow of each stop is
+// kept in a ring of time buckets like PassengerStatistics, one ring per stop
+// of the graph, allocated as stops see events. The load of a segment over a
+// window is the running sum of the net flows up to its first stop within the
+// window: passengers who boarded upstream during the window, less those who
+// alighted upstream, so riders leave the estimate with the buckets they
+// boarded in, wherever they alight.
+//
+// Record() is lock-free and may be called from any number of threads.
+class SegmentLoadEstimator {
+public:
+  static constexpr std::size_t kBucketCount{16};
+  static constexpr auto kBucketWidth{PassengerStatistics::kBucketWidth};
+
+  // The whole ring.
+  static constexpr std::chrono::seconds kWindow{kBucketWidth * kBucketCount};
+
+  explicit SegmentLoadEstimator(std::shared_ptr<const TransportGraph> pGraph);
+
+  SegmentLoadEstimator(const SegmentLoadEstimator &) = delete;
+  auto operator=(const SegmentLoadEstimator &)
+    -> SegmentLoadEstimator & = delete;
+
+  SegmentLoadEstimator(SegmentLoadEstimator &&) = delete;
+  auto operator=(SegmentLoadEstimator &&) -> SegmentLoadEstimator & = delete;
+
+  ~SegmentLoadEstimator() = default;
+
+  // A default-constructed timestamp stands for now. Events older than the
+  // ring, or for a bucket that has already been recycled, are dropped.
+  void Record(
+    StationIndex station,
+    PassengerTimestamp timestamp,
+    std::uint32_t in,
+    std::uint32_t out);
+
+  // The window is rounded up to whole buckets, at most kBucketCount of them,
+  // and ends with the bucket of now. Never negative, zero past the route's
+  // last segment.
+  [[nodiscard]] auto GetLoad(
+    RouteIndex route,
+    StopPosition position,
+    std::chrono::seconds window = kWindow,
+    PassengerTimestamp now = PassengerClock::now()) const -> double;
+
+  // Up to count segments with a positive load, most loaded first.
+  [[nodiscard]] auto GetMostCrowdedSegments(
+    std::size_t count,
+    std::chrono::seconds window = kWindow,
+    PassengerTimestamp now = PassengerClock::now()) const
+    -> std::vector<SegmentLoad>;
+
+  // Heap bytes held, see MemoryUsage.h.
+  [[nodiscard]] auto GetMemoryUsage() const -> std::size_t;
+
+private:
+  // Net flows are counted in fractions of a passenger, so that shares among
+  // up to ten routes add up exactly.
+  static constexpr std::int64_t kPassenger{2520};
+
+  // Buckets of a stop, each packing its period tag and net flow.
+  using Ring = std::array<std::atomic<std::uint64_t>, kBucketCount>;
+
+  // Bucket periods [first, first + size) of a window.
+  struct Periods {
+    std::uint64_t first{};
+    std::size_t size{};
+  };
+
+  [[nodiscard]] static auto getPeriods(
+    std::chrono::seconds window,
+    PassengerTimestamp now) -> Periods;
+
+  void distribute(
+    StationIndex station,
+    std::uint64_t period,
+    std::int64_t passengers,
+    bool in);
+
+  [[nodiscard]] auto netFlow(std::uint32_t stop, Periods periods) const
+    -> std::int64_t;
+
+  std::shared_ptr<const TransportGraph> m_pGraph{};
+  LazyPages<Ring> m_netFlows;
+};
+
+} // namespace Structures::TransportNetwork
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "PassengerStatistics.h"
+#include "TransportNetwork.h"
+#include "TransportNetworkTypes.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include <boost/lockfree/queue.hpp>
+
+namespace Structures::TransportNetwork {
+
+struct IngestionStats {
+  std::size_t accepted{};
+  std::size_t rejected{};
+};
+
+// Feeds passenger events into a network from any number of producer threads
+// with one worker thread per shard. Stations are partitioned across shards
+// by a hash of their index; producers only resolve the station and push the
+// event onto its shard's lock-free queue, and each station's counters and
+// statistics are then only ever written by its shard's worker, so that no
+// two cores contend for them.
+//
+// The network itself is the merged view of all shards: counts read through
+// it, or through GetPassengerCount(), include every event applied so far,
+// and every event recorded before a call to Drain() once it returns. The
+// network must outlive the ingestor and not change its layout meanwhile.
+class ShardedPassengerIngestor {
+public:
+  static constexpr std::size_t kDefaultQueueCapacity{16384};
+
+  // Uses at least one shard.
+  explicit ShardedPassengerIngestor(
+    const TransportNetwork &network,
+    std::size_t shardCount = std::thread::hardware_concurrency(),
+    std::size_t queueCapacity = kDefaultQueueCapacity);
+
+  ShardedPassengerIngestor(const ShardedPassengerIngestor &) = delete;
+  auto operator=(const ShardedPassengerIngestor &)
+    -> ShardedPassengerIngestor & = delete;
+
+  ShardedPassengerIngestor(ShardedPassengerIngestor &&) = delete;
+  auto operator=(ShardedPassengerIngestor &&)
+    -> ShardedPassengerIngestor & = delete;
+
+  // Applies the events still queued before stopping the workers.
+  ~ShardedPassengerIngestor();
+
+  [[nodiscard]] auto GetShardCount() const -> std::size_t;
+  [[nodiscard]] auto GetShard(StationIndex station) const -> std::size_t;
+
+  // Queues the event on its station's shard, waiting while the queue is
+  // full. Events without a timestamp are stamped here. Returns false for
+  // unknown stations and types only; events that would take a count below
+  // zero are rejected when applied, and counted in GetStats().
+  auto Record(const PassengerEvent &event) -> bool;
+  auto Record(
+    StationIndex station,
+    PassengerEvent::Type type,
+    PassengerTimestamp timestamp = {}) -> bool;
+
+  // Returns the number of events queued. Events are grouped by shard, and
+  // each shard touched once.
+  auto Record(std::span<const PassengerEvent> events) -> std::size_t;
+
+  // Blocks until every event queued before the call has been applied.
+  void Drain();
+
+  [[nodiscard]] auto GetPassengerCount(StationIndex station) const
+    -> std::size_t;
+  [[nodiscard]] auto GetStats() const -> IngestionStats;
+
+private:
+  struct QueuedEvent {
+    StationIndex station{kInvalidId};
+    PassengerEvent::Type type{};
+    PassengerTimestamp timestamp{};
+  };
+
+  struct alignas(64) Shard {
+    explicit Shard(std::size_t queueCapacity);
+
+    boost::lockfree::queue<QueuedEvent> queue;
+
+    // Taken by producers before pushing, one per event, and waited on by
+    // the worker while it sleeps.
+    alignas(64) std::atomic<std::uint64_t> tickets{0};
+    std::atomic<bool> sleeping{false};
+
+    // Written by the worker only.
+    alignas(64) std::atomic<std::uint64_t> applied{0};
+    std::atomic<std::size_t> accepted{0};
+    std::atomic<std::size_t> rejected{0};
+  };
+
+  // Validates and stamps the event, false if it cannot be queued.
+  auto resolve(
+    StationIndex station,
+    PassengerEvent::Type type,
+    PassengerTimestamp timestamp,
+    QueuedEvent &event) const -> bool;
+  void push(Shard &shard, std::span<const QueuedEvent> events);
+  void work(Shard &shard, const std::stop_token &stopToken);
+
+  const TransportNetwork &m_network;
+  std::vector<std::unique_ptr<Shard>> m_shards{};
+  std::vector<std::jthread> m_workers{};
+};
+
+} // namespace Structures::TransportNetwork
@@ -0,0 +1,180 @@
+#pragma once
+
+#include "TransportNetworkTypes.h"
+
+#include <compare>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <unordered_set>
+#include <vector>
+
+namespace Structures::TransportNetwork {
+
+// The stops of a route, as a view over an immutable array that any number of
+// routes may share. The view may run over the array backwards, so that the
+// two directions of a line share a single array.
+class StopSequence {
+public:
+  using Stops = std::vector<StationId>;
+
+  class Iterator {
+  public:
+    using iterator_concept = std::random_access_iterator_tag;
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = StationId;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const StationId *;
+    using reference = const StationId &;
+
+    Iterator() = default;
+    Iterator(const StopSequence *pSequence, difference_type position)
+        : m_pSequence(pSequence),
+          m_position(position)
+    {
+    }
+
+    auto operator*() const -> reference
+    {
+      return (*m_pSequence)[static_cast<std::size_t>(m_position)];
+    }
+    auto operator->() const -> pointer { return &**this; }
+    auto operator[](const difference_type n) const -> reference
+    {
+      return *(*this + n);
+    }
+
+    auto operator++() -> Iterator &
+    {
+      ++m_position;
+      return *this;
+    }
+    auto operator++(int) -> Iterator
+    {
+      auto result{*this};
+      ++m_position;
+      return result;
+    }
+    auto operator--() -> Iterator &
+    {
+      --m_position;
+      return *this;
+    }
+    auto operator--(int) -> Iterator
+    {
+      auto result{*this};
+      --m_position;
+      return result;
+    }
+
+    auto operator+=(const difference_type n) -> Iterator &
+    {
+      m_position += n;
+      return *this;
+    }
+    auto operator-=(const difference_type n) -> Iterator &
+    {
+      m_position -= n;
+      return *this;
+    }
+
+    friend auto operator+(Iterator it, const difference_type n) -> Iterator
+    {
+      return it += n;
+    }
+    friend auto operator+(const difference_type n, Iterator it) -> Iterator
+    {
+      return it += n;
+    }
+    friend auto operator-(Iterator it, const difference_type n) -> Iterator
+    {
+      return it -= n;
+    }
+    friend auto operator-(const Iterator &lhs, const Iterator &rhs)
+      -> difference_type
+    {
+      return lhs.m_position - rhs.m_position;
+    }
+
+    auto operator==(const Iterator &other) const -> bool
+    {
+      return m_position == other.m_position;
+    }
+    auto operator<=>(const Iterator &other) const -> std::strong_ordering
+    {
+      return m_position <=> other.m_position;
+    }
+
+  private:
+    const StopSequence *m_pSequence{nullptr};
+    difference_type m_position{0};
+  };
+
+  StopSequence() = default;
+  StopSequence(std::initializer_list<StationId> stops);
+  StopSequence(Stops stops);
+  StopSequence(std::shared_ptr<const Stops> pStops, bool reversed);
+
+  StopSequence(const StopSequence &) = default;
+  auto operator=(const StopSequence &) -> StopSequence & = default;
+
+  StopSequence(StopSequence &&) = default;
+  auto operator=(StopSequence &&) -> StopSequence & = default;
+
+  ~StopSequence() = default;
+
+  [[nodiscard]] auto size() const -> std::size_t;
+  [[nodiscard]] auto empty() const -> bool;
+  [[nodiscard]] auto begin() const -> Iterator;
+  [[nodiscard]] auto end() const -> Iterator;
+  [[nodiscard]] auto front() const -> const StationId &;
+  [[nodiscard]] auto back() const -> const StationId &;
+  auto operator[](std::size_t position) const -> const StationId &;
+
+  // The same stops in the opposite order, sharing this sequence's array.
+  [[nodiscard]] auto Reversed() const -> StopSequence;
+  [[nodiscard]] auto IsReversed() const -> bool;
+  [[nodiscard]] auto SharesStopsWith(const StopSequence &other) const -> bool;
+  [[nodiscard]] auto GetStops() const -> const std::shared_ptr<const Stops> &;
+
+  // Heap bytes of the array, in full however many sequences share it.
+  [[nodiscard]] auto GetMemoryUsage() const -> std::size_t;
+
+  // Compares stops, not arrays.
+  auto operator==(const StopSequence &other) const -> bool;
+
+private:
+  std::shared_ptr<const Stops> m_pStops{};
+  bool m_reversed{false};
+};
+
+// Hands out StopSequences sharing one array per distinct sequence of stops,
+// whichever direction it is walked in.
+class StopSequencePool {
+public:
+  auto Intern(StopSequence::Stops stops) -> StopSequence;
+
+  // Distinct arrays handed out so far.
+  [[nodiscard]] auto GetSequenceCount() const -> std::size_t;
+
+private:
+  struct StopsHash {
+    auto operator()(const std::shared_ptr<const StopSequence::Stops> &pStops)
+      const -> std::size_t;
+  };
+
+  struct StopsEqual {
+    auto operator()(
+      const std::shared_ptr<const StopSequence::Stops> &lhs,
+      const std::shared_ptr<const StopSequence::Stops> &rhs) const -> bool;
+  };
+
+  std::unordered_set<
+    std::shared_ptr<const StopSequence::Stops>,
+    StopsHash,
+    StopsEqual>
+    m_sequences{};
+};
+
+} // namespace Structures::TransportNetwork
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "TransportNetworkTypes.h"
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace Structures::TransportNetwork {
+
+using EdgeIndex = std::uint32_t;
+using StopPosition = std::uint32_t;
+
+struct GraphEdge {
+  StationIndex target{kInvalidId};
+  unsigned int travelTime{};
+  LineIndex line{kInvalidId};
+  RouteIndex route{kInvalidId};
+};
+
+// A route as fed to the graph: travelTimes[i] is the time from stops[i] to
+// stops[i + 1].
+struct GraphRoute {
+  LineIndex line{kInvalidId};
+  std::span<const StationIndex> stops{};
+  std::span<const unsigned int> travelTimes{};
+};
+
+// Occurrence of a station along a route.
+struct RouteStop {
+  RouteIndex route{kInvalidId};
+  StopPosition position{};
+};
+
+// Immutable adjacency of the network in compressed-sparse-row form: the edges
+// leaving station s are m_edges[m_edgeOffsets[s], m_edgeOffsets[s + 1]).
+// Alongside it every route keeps the cumulative travel time up to each of its
+// stops, which turns the time between any two stops into a subtraction.
+class TransportGraph {
+public:
+  TransportGraph() = default;
+
+  // Route indices are positions in the routes span.
+  TransportGraph(std::size_t stationCount, std::span<const GraphRoute> routes);
+
+  TransportGraph(const TransportGraph &) = default;
+  auto operator=(const TransportGraph &) -> TransportGraph & = default;
+
+  TransportGraph(TransportGraph &&) = default;
+  auto operator=(TransportGraph &&) -> TransportGraph & = default;
+
+  ~TransportGraph() = default;
+
+  [[nodiscard]] auto GetStationCount() const -> std::size_t;
+  [[nodiscard]] auto GetEdgeCount() const -> std::size_t;
+  [[nodiscard]] auto GetRouteCount() const -> std::size_t;
+
+  [[nodiscard]] auto GetNeighbors(StationIndex station) const
+    -> std::span<const GraphEdge>;
+
+  // Global index of the first edge leaving the station, so that per-edge
+  // state can be kept in flat arrays of GetEdgeCount() elements.
+  [[nodiscard]] auto GetFirstEdge(StationIndex station) const -> EdgeIndex;
+  [[nodiscard]] auto GetEdge(EdgeIndex edge) const -> const GraphEdge &;
+
+  [[nodiscard]] auto GetRouteStops(RouteIndex route) const
+    -> std::span<const StationIndex>;
+
+  // Global index of the route's first stop, so that per-stop state can be
+  // kept in flat arrays of GetStopCount() elements.
+  [[nodiscard]] auto GetStopCount() const -> std::size_t;
+  [[nodiscard]] auto GetFirstStop(RouteIndex route) const -> std::uint32_t;
+
+  // Every position at which routes stop at the station, ordered by route.
+  [[nodiscard]] auto GetStationStops(StationIndex station) const
+    -> std::span<const RouteStop>;
+
+  // First position of the station on the route at or after the given one,
+  // kInvalidId if there is none.
+  [[nodiscard]] auto GetStopPosition(
+    RouteIndex route,
+    StationIndex station,
+    StopPosition after = 0) const -> StopPosition;
+
+  // Travel time between two positions of a route, from <= to.
+  [[nodiscard]] auto GetSegmentTravelTime(
+    RouteIndex route,
+    StopPosition from,
+    StopPosition to) const -> unsigned int;
+
+  // Travel time along the route from start to the next visit of end, zero if
+  // the route does not go from one to the other.
+  [[nodiscard]] auto GetRouteTravelTime(
+    RouteIndex route,
+    StationIndex start,
+    StationIndex end) const -> unsigned int;
+
+  // Heap bytes held, see MemoryUsage.h.
+  [[nodiscard]] auto GetMemoryUsage() const -> std::size_t;
+
+private:
+  std::vector<EdgeIndex> m_edgeOffsets{0};
+  std::vector<GraphEdge> m_edges{};
+
+  // m_routeStops and m_cumulativeTimes share the offsets of m_routeOffsets.
+  std::vector<std::uint32_t> m_routeOffsets{0};
+  std::vector<StationIndex> m_routeStops{};
+  std::vector<unsigned int> m_cumulativeTimes{};
+
+  std::vector<std::uint32_t> m_stationStopOffsets{0};
+  std::vector<RouteStop> m_stationStops{};
+};
+
+} // namespace Structures::TransportNetwork
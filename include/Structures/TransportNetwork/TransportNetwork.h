@@ -1,27 +1,40 @@
 #pragma once
 
+#include "CopyOnWrite.h"
+#include "ForkRegistry.h"
+#include "ForkedPassengerCounts.h"
+#include "IdInterner.h"
+#include "ItineraryCache.h"
+#include "NetworkArena.h"
+#include "PassengerCounter.h"
+#include "PassengerStatistics.h"
+#include "PathFinder.h"
+#include "SegmentLoadEstimator.h"
+#include "StopSequence.h"
+#include "TransportGraph.h"
+#include "TransportNetworkTypes.h"
+#include "TravelTimeMatrix.h"
+
+#include <chrono>
 #include <memory>
+#include <memory_resource>
+#include <span>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
+#include <boost/dynamic_bitset.hpp>
 #include <boost/multi_index/composite_key.hpp>
 #include <boost/multi_index/hashed_index.hpp>
 #include <boost/multi_index/indexed_by.hpp>
 #include <boost/multi_index/key_extractors.hpp>
 #include <boost/multi_index/member.hpp>
-#include <boost/multi_index/ordered_index.hpp>
-#include <boost/multi_index/ordered_index_fwd.hpp>
 #include <boost/multi_index_container.hpp>
 #include <boost/multi_index_container_fwd.hpp>
 
 namespace Structures::TransportNetwork {
 
-using LineId = std::string;
-using RouteId = std::string;
-using StationId = std::string;
-using StationName = std::string;
-
 enum class RouteDirection {
   kInbound = 0,
   kOutbound,
@@ -39,15 +52,21 @@ struct PassengerEvent {
 
   StationId m_stationId{};
   Type m_type{};
+
+  // Left default-constructed, the event is taken to happen when recorded.
+  PassengerTimestamp m_timestamp{};
 };
 
+// Bit i is set if the i-th event of a batch was rejected.
+using PassengerEventRejections = boost::dynamic_bitset<>;
+
 struct Route {
   LineId lineId{};
   RouteId routeId{};
   RouteDirection direction{};
   StationId startStationId{};
   StationId endStationId{};
-  std::vector<StationId> stops{};
+  StopSequence stops{};
 
   auto operator==(const Route &other) const -> bool;
   auto operator!=(const Route &other) const -> bool;
@@ -67,20 +86,47 @@ public:
 
   ~Station() = default;
 
+  // Lock-free, may be called from any number of threads concurrently.
+  // Accepted events are also counted in the station's statistics.
   auto RecordPassengerEvent(const PassengerEvent &event) -> bool;
+  auto RecordPassengerEvent(
+    PassengerEvent::Type type,
+    PassengerTimestamp timestamp = {}) -> bool;
   [[nodiscard]] auto GetPassengerCount() const -> std::size_t;
+  [[nodiscard]] auto GetPassengerStatistics() const
+    -> const PassengerStatistics &;
+
+  // Counts already accepted events in the statistics only.
+  void RecordPassengerStatistics(
+    PassengerTimestamp timestamp,
+    std::uint32_t in,
+    std::uint32_t out);
+
+  // Atomically replaces the passenger count with update(count), see
+  // PassengerCounter::Update.
+  template <typename TUpdate> void UpdatePassengerCount(TUpdate &&update)
+  {
+    m_passengerCount.Update(std::forward<TUpdate>(update));
+  }
 
   auto operator==(const Station &rhs) const noexcept -> bool;
 
   auto AddRoute(std::shared_ptr<Route> pRoute) -> bool;
   [[nodiscard]] auto GetRoutes() const -> std::vector<std::shared_ptr<Route>>;
+  [[nodiscard]] auto GetRoutesView() const
+    -> std::span<const std::shared_ptr<Route>>;
 
   StationId m_id{};
   StationName m_name{};
   std::vector<std::shared_ptr<Route>> m_routes{};
 
 private:
-  std::size_t m_passengerCount{0};
+  // They track counters in their ForkRegistry.
+  friend class ForkedPassengerCounts;
+  friend class TransportNetwork;
+
+  PassengerCounter m_passengerCount{};
+  PassengerStatistics m_passengerStatistics{};
 };
 
 struct Line {
@@ -93,27 +139,99 @@ struct Line {
 };
 
 struct TravelTime {
-  StationId m_startStationId{};
-  StationId m_endStationId{};
-  LineId m_lineId{};
-  RouteId m_routeId{};
+  StationIndex m_startStation{kInvalidId};
+  StationIndex m_endStation{kInvalidId};
+  LineIndex m_line{kInvalidId};
+  RouteIndex m_route{kInvalidId};
   unsigned int m_travelTime{};
 };
 
 using TravelTimes = boost::multi_index_container<
   TravelTime,
   boost::multi_index::indexed_by<
-    boost::multi_index::ordered_unique<boost::multi_index::composite_key<
+    boost::multi_index::hashed_unique<boost::multi_index::composite_key<
       TravelTime,
       boost::multi_index::
-        member<TravelTime, StationId, &TravelTime::m_startStationId>,
+        member<TravelTime, StationIndex, &TravelTime::m_startStation>,
       boost::multi_index::
-        member<TravelTime, StationId, &TravelTime::m_endStationId>>>>>;
+        member<TravelTime, StationIndex, &TravelTime::m_endStation>>>>,
+  ArenaAllocator<TravelTime>>;
+
+// Interned form of a Route, with stops stored as station indices.
+struct RouteRecord {
+  LineIndex line{kInvalidId};
+  ArenaVector<StationIndex> stops{};
+  std::shared_ptr<Route> route{};
+};
+
+struct NetworkLayout;
+
+// Bytes held by a network, broken down by structure. Each figure covers the
+// objects, the strings they own, and for hash tables buckets and nodes, as
+// estimated by MemoryUsage.h. Objects shared with copies of the network count
+// in full; stop arrays shared between routes count once.
+struct NetworkMemoryUsage {
+  // The three id interners.
+  std::size_t ids{};
+  std::size_t stations{};
+
+  // Routes listed on stations.
+  std::size_t stationRoutes{};
+  std::size_t lines{};
+
+  // Route objects, their stops and their interned records.
+  std::size_t routes{};
+  std::size_t passengerEvents{};
+  std::size_t travelTimes{};
+  std::size_t graph{};
+  std::size_t segmentLoads{};
+  std::size_t travelTimeMatrix{};
+  std::size_t itineraryCache{};
+
+  // Passenger counts a fork keeps apart from its origin.
+  std::size_t forkedPassengerCounts{};
+
+  // Bytes allocated from the network's resource if it is a NetworkArena, see
+  // NetworkArena::GetAllocatedBytes(). Part of the above rather than on top
+  // of it, so not in the total.
+  std::size_t arenaBytes{};
+
+  [[nodiscard]] auto Total() const -> std::size_t;
+};
+
+// What ApplyLayoutDiff() changed. A line counts as modified if its name or
+// any of its routes changed, and is then replaced as a whole.
+struct LayoutDiff {
+  std::size_t addedStations{};
+  std::size_t removedStations{};
+  std::size_t modifiedStations{};
+  std::size_t addedLines{};
+  std::size_t removedLines{};
+  std::size_t modifiedLines{};
+  std::size_t addedTravelTimes{};
+  std::size_t removedTravelTimes{};
+  std::size_t modifiedTravelTimes{};
+
+  [[nodiscard]] auto Empty() const -> bool;
+};
 
 class TransportNetwork {
 public:
-  TransportNetwork() = default;
-
+  TransportNetwork();
+
+  // Stations, lines, stops, ids and travel times are allocated from the
+  // resource, which copies of the network and every station and line handed
+  // out keep alive. Null stands for a new NetworkArena, which pools what the
+  // network allocates outside of a load by TransportNetworkBuilder. A
+  // resource shared between networks used from several threads must be
+  // thread-safe.
+  explicit TransportNetwork(
+    std::shared_ptr<std::pmr::memory_resource> pMemoryResource);
+
+  // Copies share their stations, lines, routes, ids and travel times, and
+  // take constant time. Each of these is cloned before either copy changes
+  // it, so changing one copy's layout never shows through the other;
+  // passenger counts of untouched stations stay shared.
   TransportNetwork(const TransportNetwork &) = default;
   TransportNetwork(TransportNetwork &&) = default;
 
@@ -122,31 +240,314 @@ public:
 
   ~TransportNetwork() = default;
 
+  // Copy for what-if changes, made without visiting stations or routes: the
+  // fork shares them with this network until either changes them. Unlike a
+  // plain copy, the fork keeps passenger counts of its own, those of this
+  // network at the time of the call, read in place until either network
+  // changes them, see ForkedPassengerCounts. It estimates segment loads from
+  // zero, and its events leave passenger rates alone, so they are those of
+  // this network. Whatever the fork clones or adds is allocated from the
+  // resource, null standing for a new NetworkArena that goes away with the
+  // fork. May be called from any number of threads, as long as no thread
+  // changes this network.
+  [[nodiscard]] auto Fork(
+    std::shared_ptr<std::pmr::memory_resource> pMemoryResource = {}) const
+    -> TransportNetwork;
+
   auto AddStation(Station station) -> bool;
-  auto GetStation(const StationId& stationId) const -> std::shared_ptr<Station>;
 
+  // On a fork, the fork's own copy of the station, made by the first call and
+  // returned by later ones, as the station itself may be shared with the
+  // origin. Events recorded into the copy count for the fork alone.
+  auto GetStation(const StationId& stationId) const -> std::shared_ptr<Station>;
+  auto GetStation(StationIndex station) const -> std::shared_ptr<Station>;
+
+  // Index lookups return kInvalidId for ids unknown to the network.
+  [[nodiscard]] auto GetStationIndex(const StationId &stationId) const
+    -> StationIndex;
+  [[nodiscard]] auto GetStationId(StationIndex station) const
+    -> const StationId &;
+  // Size of the station index space. Removed stations keep their index, so
+  // that it stays stable, and still count here.
+  [[nodiscard]] auto GetStationCount() const -> std::size_t;
+
+  [[nodiscard]] auto GetLineIndex(const LineId &lineId) const -> LineIndex;
+  [[nodiscard]] auto GetRouteIndex(const RouteId &routeId) const -> RouteIndex;
+  [[nodiscard]] auto GetRouteId(RouteIndex route) const -> const RouteId &;
+
+  // Throws std::logic_error if the line has no routes, a stop is missing from
+  // the network or a route id is already taken.
   auto AddLine(Line line) -> bool;
   auto GetLine(const LineId& lineId) const -> std::shared_ptr<Line>;
 
+  // Detaches the line's routes from their stations. Returns false if the
+  // network contains no such line.
+  auto RemoveLine(const LineId &lineId) -> bool;
+
+  // Drops the station together with its travel times and passenger count.
+  // Returns false if there is no such station; throws std::logic_error if
+  // routes still stop at it.
+  auto RemoveStation(const StationId &stationId) -> bool;
+
+  // Brings the network in line with a new layout by adding, removing and
+  // modifying only the stations, lines and travel times that differ.
+  // Stations present in both keep their passenger counts. Throws
+  // std::logic_error, leaving the network untouched, if the layout refers to
+  // stations it does not contain.
+  auto ApplyLayoutDiff(const NetworkLayout &layout) -> LayoutDiff;
+
+  // Passenger events and counts may be recorded and read from any number of
+  // threads, as long as no thread changes the network at the same time.
   auto RecordPassengerEvent(const PassengerEvent &event) const -> bool;
+  auto RecordPassengerEvent(
+    StationIndex station,
+    PassengerEvent::Type type,
+    PassengerTimestamp timestamp = {}) const -> bool;
+
+  // Records a burst of events with one counter update per station. The
+  // outcome matches recording the events one by one in order: events for
+  // unknown stations, of unknown type or that would take a count below zero
+  // are rejected.
+  auto RecordPassengerEvents(std::span<const PassengerEvent> events) const
+    -> PassengerEventRejections;
   auto GetPassengerCount(const StationId &stationId) const -> std::size_t;
+  auto GetPassengerCount(StationIndex station) const -> std::size_t;
+
+  // Passengers per minute entering and leaving the station over the last
+  // window, on average or at a percentile of its minutes; see
+  // PassengerStatistics. Zero for unknown stations.
+  [[nodiscard]] auto GetPassengerRates(
+    const StationId &stationId,
+    std::chrono::seconds window,
+    PassengerTimestamp now = PassengerClock::now()) const -> PassengerRates;
+  [[nodiscard]] auto GetPassengerRates(
+    StationIndex station,
+    std::chrono::seconds window,
+    PassengerTimestamp now = PassengerClock::now()) const -> PassengerRates;
+  [[nodiscard]] auto GetPassengerRatePercentiles(
+    const StationId &stationId,
+    std::chrono::seconds window,
+    double percentile,
+    PassengerTimestamp now = PassengerClock::now()) const -> PassengerRates;
+  [[nodiscard]] auto GetPassengerRatePercentiles(
+    StationIndex station,
+    std::chrono::seconds window,
+    double percentile,
+    PassengerTimestamp now = PassengerClock::now()) const -> PassengerRates;
 
   auto
   GetRoutesServingStation(const StationId &stationId) const -> std::vector<std::shared_ptr<Route>>;
 
+  // Non-owning counterparts of the accessors above. They neither allocate nor
+  // touch reference counts, and stay valid until the network is modified. A
+  // fork's stations may be shared with its origin, so their passenger counts
+  // are the origin's: ask the network for the fork's, see GetPassengerCount().
+  [[nodiscard]] auto FindStation(const StationId &stationId) const
+    -> const Station *;
+  [[nodiscard]] auto FindStation(StationIndex station) const
+    -> const Station *;
+  [[nodiscard]] auto FindLine(const LineId &lineId) const -> const Line *;
+  [[nodiscard]] auto FindRoute(RouteIndex route) const -> const Route *;
+  [[nodiscard]] auto GetRouteStopsView(RouteIndex route) const
+    -> std::span<const StationIndex>;
+  [[nodiscard]] auto GetRoutesServingStationView(
+    const StationId &stationId) const
+    -> std::span<const std::shared_ptr<Route>>;
+  [[nodiscard]] auto GetRoutesServingStationView(StationIndex station) const
+    -> std::span<const std::shared_ptr<Route>>;
+
+  // Both stations must already be part of the network.
   auto SetTravelTime(
     const StationId &start,
     const StationId &end,
     unsigned int travelTime) -> bool;
+  auto SetTravelTime(
+    StationIndex start,
+    StationIndex end,
+    unsigned int travelTime) -> bool;
 
   auto
   GetTravelTime(const StationId &start, const StationId &end) const -> unsigned int;
+  auto GetTravelTime(StationIndex start, StationIndex end) const
+    -> unsigned int;
+
+  // Freezes the current stations, routes and travel times into a graph. Any
+  // later change to the network drops it until BuildGraph() is called again.
+  void BuildGraph();
+  [[nodiscard]] auto GetGraph() const -> std::shared_ptr<const TransportGraph>;
+
+  // Fills a TravelTimeMatrix from the graph, which it is dropped with. Throws
+  // std::logic_error if the graph is not built.
+  void PrecomputeTravelTimes(
+    const ItineraryOptions &options = {},
+    std::size_t threadCount = std::thread::hardware_concurrency());
+  [[nodiscard]] auto GetTravelTimeMatrix() const
+    -> std::shared_ptr<const TravelTimeMatrix>;
+
+  // Shortest travel time between any pair of stations, line changes
+  // included, from the matrix. Zero if end is unreachable from start; throws
+  // std::logic_error if the travel times are not precomputed.
+  [[nodiscard]] auto GetShortestTravelTime(
+    const StationId &start,
+    const StationId &end) const -> unsigned int;
+  [[nodiscard]] auto GetShortestTravelTime(
+    StationIndex start,
+    StationIndex end) const -> unsigned int;
+
+  // Travel time along a route from start to the next visit of end, computed
+  // from the graph's cumulative route times. Zero if the route does not go
+  // from start to end; throws std::logic_error if the graph is not built.
+  auto GetTravelTime(
+    const RouteId &routeId,
+    const StationId &start,
+    const StationId &end) const -> unsigned int;
+  auto GetTravelTime(RouteIndex route, StationIndex start, StationIndex end)
+    const -> unsigned int;
+
+  // Estimated passenger loads of route segments over the window ending now,
+  // see SegmentLoadEstimator. Estimates start from zero whenever the graph is
+  // built and cover the events recorded since. Both throw std::logic_error if
+  // the graph is not built.
+  [[nodiscard]] auto GetSegmentLoad(
+    RouteIndex route,
+    StopPosition position,
+    std::chrono::seconds window = SegmentLoadEstimator::kWindow,
+    PassengerTimestamp now = PassengerClock::now()) const -> double;
+  [[nodiscard]] auto GetMostCrowdedSegments(
+    std::size_t count,
+    std::chrono::seconds window = SegmentLoadEstimator::kWindow,
+    PassengerTimestamp now = PassengerClock::now()) const
+    -> std::vector<SegmentLoad>;
+
+  // Fastest itinerary between two stations, empty if there is none. Both
+  // throw std::logic_error if the graph has not been built. Results are
+  // cached, see ItineraryCache; layout changes drop only the entries whose
+  // itineraries they may change, and survive rebuilding the graph.
+  auto GetFastestPath(
+    const StationId &start,
+    const StationId &end,
+    const ItineraryOptions &options = {}) const -> Itinerary;
+  auto GetFastestPath(
+    StationIndex start,
+    StationIndex end,
+    Itinerary &itinerary,
+    const ItineraryOptions &options = {}) const -> bool;
+
+  [[nodiscard]] auto GetMemoryResource() const
+    -> const std::shared_ptr<std::pmr::memory_resource> &;
+
+  // Walks every structure once without allocating, so it can be called
+  // periodically; not while another thread changes the network.
+  [[nodiscard]] auto GetMemoryUsage() const -> NetworkMemoryUsage;
+
+  // Empties the itinerary cache and resizes it, zero disables it.
+  void SetItineraryCacheCapacity(std::size_t capacity);
+  [[nodiscard]] auto GetItineraryCacheStats() const -> ItineraryCacheStats;
+
+  // Up to count alternative itineraries ranked by total time plus the
+  // crowding of the stations they pass through, see FindQuietItineraries.
+  // Both throw std::logic_error if the graph has not been built.
+  auto GetQuietItineraries(
+    const StationId &start,
+    const StationId &end,
+    std::size_t count,
+    const QuietItineraryOptions &options = {}) const
+    -> std::vector<QuietItinerary>;
+  auto GetQuietItineraries(
+    StationIndex start,
+    StationIndex end,
+    std::size_t count,
+    std::vector<QuietItinerary> &itineraries,
+    const QuietItineraryOptions &options = {}) const -> bool;
 
 private:
-  std::unordered_map<LineId, std::shared_ptr<Line>> m_lines{};
-  std::unordered_map<StationId, std::shared_ptr<Station>> m_stations{};
+  friend class TransportNetworkBuilder;
+  friend class TransportNetworkImage;
+
+  // Station to be modified in place, cloned first if another copy of the
+  // network may share it.
+  auto mutableStation(StationIndex station) -> Station &;
+
+  // Layout structures to be modified in place, cloned first from this
+  // network's resource if another copy of the network shares them.
+  auto mutableIds(CopyOnWrite<IdInterner> &ids) -> IdInterner &;
+  auto mutableRoutes() -> std::vector<RouteRecord> &;
+  auto mutableTravelTimes() -> TravelTimes &;
+
+  // Has the station's counter, held at index, captured into forks of the
+  // network before it changes. Every station the network holds is tracked.
+  void track(StationIndex index, Station &station) const;
+
+  // Count of a station, which a fork may keep apart from the station itself.
+  auto passengerCount(StationIndex index, const Station &station) const
+    -> std::size_t;
+
+  // Drops the graph and everything derived from it.
+  void resetGraph();
+
+  // Travel time as set, ignoring the matrix.
+  auto findTravelTime(StationIndex start, StationIndex end) const
+    -> unsigned int;
+
+  // Travel time the graph uses for a hop from start to end.
+  auto hopTime(StationIndex start, StationIndex end) const -> unsigned int;
+
+  // Itinerary cache to be modified in place, cloned first if another copy of
+  // the network may share it. Null for a moved-from network.
+  auto mutableItineraryCache() -> ItineraryCache *;
+
+  // Drops the cached itineraries that a change of the hop from start to end,
+  // which took before to travel, may have made stale. Only longer hops leave
+  // the itineraries that do not ride them valid; shorter ones drop them all.
+  void invalidateHop(StationIndex start, StationIndex end, unsigned int before);
+  void clearItineraryCache();
+
+  void detachLine(LineIndex line);
+  auto eraseTravelTimes(StationIndex station) -> std::size_t;
+
+  // Registers a route whose id and stops have already been validated.
+  void attachRoute(
+    LineIndex line,
+    const std::shared_ptr<Route> &pRoute,
+    ArenaVector<StationIndex> stops);
+
+  template <typename T> [[nodiscard]] auto allocator() const
+    -> ArenaAllocator<T>
+  {
+    return ArenaAllocator<T>{m_pMemoryResource};
+  }
+
+  // Shared with copies of the network.
+  std::shared_ptr<std::pmr::memory_resource> m_pMemoryResource;
+
+  CopyOnWrite<IdInterner> m_lineIds;
+  CopyOnWrite<IdInterner> m_routeIds;
+  CopyOnWrite<IdInterner> m_stationIds;
+
+  // Indexed by LineIndex, RouteIndex and StationIndex respectively.
+  CopyOnWrite<std::vector<std::shared_ptr<Line>>> m_lines{};
+  CopyOnWrite<std::vector<RouteRecord>> m_routes{};
+  CopyOnWrite<std::vector<std::shared_ptr<Station>>> m_stations{};
+
   std::unordered_map<StationId, std::size_t> m_passengerEvents{};
-  TravelTimes m_travelTimes{};
+  CopyOnWrite<TravelTimes> m_travelTimes;
+
+  // Null unless the network is a fork; shared by plain copies of the fork.
+  std::shared_ptr<ForkedPassengerCounts> m_passengerCounts{};
+
+  // Forks of the network and of its plain copies, see track().
+  std::shared_ptr<ForkRegistry> m_pForks{std::make_shared<ForkRegistry>()};
+
+  std::shared_ptr<const TransportGraph> m_graph{};
+  std::shared_ptr<SegmentLoadEstimator> m_segmentLoads{};
+  std::shared_ptr<const TravelTimeMatrix> m_travelTimeMatrix{};
+
+  // Outlives the graph; shared by copies until either changes its layout.
+  std::shared_ptr<ItineraryCache> m_itineraryCache{
+    std::make_shared<ItineraryCache>()};
+
+  // Owned by every copy of this network, see mutableStation().
+  std::shared_ptr<const void> m_copyToken{std::make_shared<char>()};
 };
 
 } // namespace Structures::TransportNetwork
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "NetworkLayout.h"
+#include "TransportNetwork.h"
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+namespace Structures::TransportNetwork {
+
+// Bulk construction of a TransportNetwork. Stations, lines and travel times
+// may be added in any order; stops and travel times are resolved in a single
+// pass by Build(), with every container sized up front.
+class TransportNetworkBuilder {
+public:
+  TransportNetworkBuilder();
+
+  // Networks built are allocated from the resource, see the constructor of
+  // TransportNetwork. By default each gets a NetworkArena of its own. The
+  // load of a network into a NetworkArena begins with the first addition to
+  // the builder, and ends with Build() or the builder's destruction.
+  explicit TransportNetworkBuilder(
+    std::shared_ptr<std::pmr::memory_resource> pMemoryResource);
+
+  TransportNetworkBuilder(const TransportNetworkBuilder &) = delete;
+  auto operator=(const TransportNetworkBuilder &)
+    -> TransportNetworkBuilder & = delete;
+
+  TransportNetworkBuilder(TransportNetworkBuilder &&) = default;
+  auto operator=(TransportNetworkBuilder &&other) -> TransportNetworkBuilder &;
+
+  ~TransportNetworkBuilder() = default;
+
+  void Reserve(
+    std::size_t stationCount,
+    std::size_t lineCount,
+    std::size_t travelTimeCount);
+
+  // Return false for duplicate station and line ids. AddLine throws
+  // std::logic_error for lines without routes or with a route id that is
+  // already taken. Of several travel times for the same pair of stations the
+  // first one wins.
+  auto AddStation(Station station) -> bool;
+  auto AddLine(Line line) -> bool;
+  void SetTravelTime(LayoutTravelTime travelTime);
+
+  void AddLayout(NetworkLayout layout);
+
+  // Throws std::logic_error if a route stops at, or a travel time refers to,
+  // a station that was never added. A successful build empties the builder.
+  auto Build() -> TransportNetwork;
+
+private:
+  std::shared_ptr<std::pmr::memory_resource> m_pMemoryResource{};
+  TransportNetwork m_network;
+  std::vector<Line> m_lines{};
+  std::vector<LayoutTravelTime> m_travelTimes{};
+
+  struct EndLoad {
+    void operator()(NetworkArena *pArena) const;
+  };
+
+  void beginLoad();
+
+  // Set while loading into a NetworkArena. Declared last, and assigned first,
+  // so that the load ends before the network, and with it the arena, can go.
+  std::unique_ptr<NetworkArena, EndLoad> m_pLoadingArena{};
+};
+
+} // namespace Structures::TransportNetwork
@@ -0,0 +1,216 @@
+#pragma once
+
+#include "TransportNetwork.h"
+#include "TransportNetworkTypes.h"
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <memory_resource>
+#include <span>
+#include <string_view>
+
+#include <boost/interprocess/mapped_region.hpp>
+
+namespace Structures::TransportNetwork {
+
+// On-disk records of a network image. They consist of fixed-width integers
+// only and refer to each other by index or by offset from the start of the
+// file, so that an image can be used in place wherever it gets mapped.
+constexpr std::uint32_t kImageVersion{1};
+constexpr std::uint32_t kImageByteOrderMark{0x01020304};
+
+// ImageHeader::flags
+constexpr std::uint32_t kImageHasPassengerCounts{1U << 0U};
+
+// ImageStation::flags, ImageLine::flags and ImageRoute::flags
+constexpr std::uint32_t kImageRemoved{1U << 0U};
+
+enum class ImageSectionId : std::uint32_t {
+  kStrings = 0,
+  kStations,
+  kStationsById,
+  kStationRoutes,
+  kLines,
+  kLinesById,
+  kLineRoutes,
+  kRoutes,
+  kRoutesById,
+  kStops,
+  kTravelTimes,
+  kPassengerCounts,
+
+  kSizeOfEnum
+};
+
+constexpr std::size_t kImageSectionCount{
+  static_cast<std::size_t>(ImageSectionId::kSizeOfEnum)};
+
+struct ImageSection {
+  std::uint64_t offset{};
+  std::uint64_t size{};
+};
+
+struct ImageHeader {
+  std::array<char, 8> magic{};
+  std::uint32_t version{};
+  std::uint32_t byteOrderMark{};
+  std::uint64_t size{};
+  std::uint32_t flags{};
+  std::uint32_t reserved{};
+  std::array<ImageSection, kImageSectionCount> sections{};
+};
+
+// Slice of the strings section.
+struct ImageString {
+  std::uint32_t offset{};
+  std::uint32_t size{};
+};
+
+// Slice of an index section, such as kStationRoutes or kStops.
+struct ImageRange {
+  std::uint32_t first{};
+  std::uint32_t count{};
+};
+
+struct ImageStation {
+  ImageString id{};
+  ImageString name{};
+  ImageRange routes{};
+  std::uint32_t flags{};
+  std::uint32_t reserved{};
+};
+
+struct ImageLine {
+  ImageString id{};
+  ImageString name{};
+  ImageRange routes{};
+  std::uint32_t flags{};
+  std::uint32_t reserved{};
+};
+
+struct ImageRoute {
+  ImageString id{};
+  ImageString startStationId{};
+  ImageString endStationId{};
+  ImageRange stops{};
+  LineIndex line{kInvalidId};
+  std::uint32_t direction{};
+  std::uint32_t flags{};
+  std::uint32_t reserved{};
+};
+
+// Sorted by start, then end station.
+struct ImageTravelTime {
+  StationIndex startStation{kInvalidId};
+  StationIndex endStation{kInvalidId};
+  LineIndex line{kInvalidId};
+  RouteIndex route{kInvalidId};
+  std::uint32_t travelTime{};
+};
+
+// Read-only view of a TransportNetwork that was written out with Write() and
+// memory-mapped back by Load(). Loading validates the image once but neither
+// parses nor allocates per object; stations, lines and routes keep the
+// indices they had in the written network, removed ones included.
+class TransportNetworkImage {
+public:
+  // Writes to a temporary file next to path and, once synced, renames it over
+  // path, so that a concurrent Load(), or one after a crash, sees either the
+  // old or the new image. Throws std::runtime_error on I/O errors.
+  static void Write(
+    const TransportNetwork &network,
+    const std::filesystem::path &path,
+    bool withPassengerCounts = false);
+
+  // Throws std::runtime_error if the file is not a valid image of this
+  // version.
+  static auto Load(const std::filesystem::path &path) -> TransportNetworkImage;
+
+  TransportNetworkImage() = default;
+
+  TransportNetworkImage(const TransportNetworkImage &) = delete;
+  auto operator=(const TransportNetworkImage &)
+    -> TransportNetworkImage & = delete;
+
+  TransportNetworkImage(TransportNetworkImage &&) = default;
+  auto operator=(TransportNetworkImage &&) -> TransportNetworkImage & = default;
+
+  ~TransportNetworkImage() = default;
+
+  [[nodiscard]] auto HasPassengerCounts() const -> bool;
+
+  // Lookups by id return kInvalidId for unknown and removed ids.
+  [[nodiscard]] auto GetStationCount() const -> std::size_t;
+  [[nodiscard]] auto GetStationIndex(std::string_view stationId) const
+    -> StationIndex;
+  [[nodiscard]] auto IsStationRemoved(StationIndex station) const -> bool;
+  [[nodiscard]] auto GetStationId(StationIndex station) const
+    -> std::string_view;
+  [[nodiscard]] auto GetStationName(StationIndex station) const
+    -> std::string_view;
+  [[nodiscard]] auto GetRoutesServingStation(StationIndex station) const
+    -> std::span<const RouteIndex>;
+
+  // Zero unless the image was written with passenger counts.
+  [[nodiscard]] auto GetPassengerCount(StationIndex station) const
+    -> std::size_t;
+
+  [[nodiscard]] auto GetLineCount() const -> std::size_t;
+  [[nodiscard]] auto GetLineIndex(std::string_view lineId) const -> LineIndex;
+  [[nodiscard]] auto IsLineRemoved(LineIndex line) const -> bool;
+  [[nodiscard]] auto GetLineId(LineIndex line) const -> std::string_view;
+  [[nodiscard]] auto GetLineName(LineIndex line) const -> std::string_view;
+  [[nodiscard]] auto GetLineRoutes(LineIndex line) const
+    -> std::span<const RouteIndex>;
+
+  [[nodiscard]] auto GetRouteCount() const -> std::size_t;
+  [[nodiscard]] auto GetRouteIndex(std::string_view routeId) const
+    -> RouteIndex;
+  [[nodiscard]] auto IsRouteRemoved(RouteIndex route) const -> bool;
+  [[nodiscard]] auto GetRouteId(RouteIndex route) const -> std::string_view;
+  [[nodiscard]] auto GetRouteLine(RouteIndex route) const -> LineIndex;
+  [[nodiscard]] auto GetRouteDirection(RouteIndex route) const
+    -> RouteDirection;
+  [[nodiscard]] auto GetRouteStops(RouteIndex route) const
+    -> std::span<const StationIndex>;
+
+  [[nodiscard]] auto GetTravelTimeCount() const -> std::size_t;
+  [[nodiscard]] auto GetTravelTime(StationIndex start, StationIndex end) const
+    -> unsigned int;
+
+  // Materializes a mutable network with the same indices, where removed
+  // stations, lines and routes stay removed. Unlike the image itself this
+  // allocates every object, from the resource if given, but resolves no ids.
+  [[nodiscard]] auto ToNetwork(
+    std::shared_ptr<std::pmr::memory_resource> pMemoryResource = {}) const
+    -> TransportNetwork;
+
+private:
+  explicit TransportNetworkImage(boost::interprocess::mapped_region region);
+
+  template <typename T>
+  [[nodiscard]] auto section(ImageSectionId id) const -> std::span<const T>;
+  [[nodiscard]] auto string(ImageString string) const -> std::string_view;
+  void validate() const;
+
+  boost::interprocess::mapped_region m_region{};
+  std::uint32_t m_flags{};
+
+  // Views into m_region, which keeps its address when moved.
+  std::string_view m_strings{};
+  std::span<const ImageStation> m_stations{};
+  std::span<const StationIndex> m_stationsById{};
+  std::span<const RouteIndex> m_stationRoutes{};
+  std::span<const ImageLine> m_lines{};
+  std::span<const LineIndex> m_linesById{};
+  std::span<const RouteIndex> m_lineRoutes{};
+  std::span<const ImageRoute> m_routes{};
+  std::span<const RouteIndex> m_routesById{};
+  std::span<const StationIndex> m_stops{};
+  std::span<const ImageTravelTime> m_travelTimes{};
+  std::span<const std::uint64_t> m_passengerCounts{};
+};
+
+} // namespace Structures::TransportNetwork
@@ -1,7 +1,26 @@
 #pragma once
 
+#include "NetworkLayout.h"
+
+#include <istream>
+#include <string>
+#include <vector>
+
 namespace Structures::TransportNetwork {
 
-class TransportNetworkParser {};
+// Reads the network-layout.json schema. Both throw std::runtime_error for
+// unreadable or malformed input.
+class TransportNetworkParser {
+public:
+  static auto Parse(std::istream &input) -> NetworkLayout;
+  static auto ParseFile(const std::string &path) -> NetworkLayout;
+
+  // Passenger events as written by TransportNetworkWriter, one JSON object
+  // per line. Blank lines are skipped.
+  static auto ParsePassengerEvents(std::istream &input)
+    -> std::vector<PassengerEvent>;
+  static auto ParsePassengerEventsFile(const std::string &path)
+    -> std::vector<PassengerEvent>;
+};
 
 } // namespace Structures::TransportNetwork
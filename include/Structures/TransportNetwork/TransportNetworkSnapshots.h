@@ -0,0 +1,55 @@
+#pragma once
+
+#include "TransportNetwork.h"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+namespace Structures::TransportNetwork {
+
+// Read-copy-update publication of a TransportNetwork. Readers acquire the
+// current immutable version without taking any lock and may keep using it
+// for as long as they hold it. Writers derive the next version from a copy of
+// the current one, off to the side, and publish it with an atomic swap.
+//
+// Versions share every station that a writer did not touch, so passenger
+// events recorded through any version keep counting. Events recorded into a
+// station of the old version after a writer cloned it are not carried over.
+class TransportNetworkSnapshots {
+public:
+  using Snapshot = std::shared_ptr<const TransportNetwork>;
+
+  explicit TransportNetworkSnapshots(TransportNetwork network = {});
+
+  TransportNetworkSnapshots(const TransportNetworkSnapshots &) = delete;
+  auto operator=(const TransportNetworkSnapshots &)
+    -> TransportNetworkSnapshots & = delete;
+
+  TransportNetworkSnapshots(TransportNetworkSnapshots &&) = delete;
+  auto operator=(TransportNetworkSnapshots &&)
+    -> TransportNetworkSnapshots & = delete;
+
+  ~TransportNetworkSnapshots() = default;
+
+  [[nodiscard]] auto Acquire() const -> Snapshot;
+
+  // Incremented by every publication, starting at zero.
+  [[nodiscard]] auto GetVersion() const -> std::uint64_t;
+
+  // Replaces the current version outright.
+  void Publish(TransportNetwork network);
+
+  // Applies update to a copy of the current version and publishes the copy,
+  // unless update throws. Writers are serialized against each other only.
+  void Update(const std::function<void(TransportNetwork &)> &update);
+
+private:
+  std::atomic<Snapshot> m_current;
+  std::atomic<std::uint64_t> m_version{0};
+  std::mutex m_writerMutex{};
+};
+
+} // namespace Structures::TransportNetwork
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "IdInterner.h"
+
+#include <string>
+
+namespace Structures::TransportNetwork {
+
+using LineId = std::string;
+using RouteId = std::string;
+using StationId = std::string;
+using StationName = std::string;
+
+// Dense handles assigned by TransportNetwork when an id is first seen.
+using LineIndex = InternedId;
+using RouteIndex = InternedId;
+using StationIndex = InternedId;
+
+} // namespace Structures::TransportNetwork
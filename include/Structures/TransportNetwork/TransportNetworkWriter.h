@@ -0,0 +1,30 @@
+#pragma once
+
+#include "NetworkLayout.h"
+#include "TransportNetwork.h"
+
+#include <ostream>
+#include <span>
+#include <string>
+
+namespace Structures::TransportNetwork {
+
+// Writes what TransportNetworkParser reads. The file variants throw
+// std::runtime_error if the file cannot be written.
+class TransportNetworkWriter {
+public:
+  // In the network-layout.json schema.
+  static void Write(const NetworkLayout &layout, std::ostream &output);
+  static void WriteFile(const NetworkLayout &layout, const std::string &path);
+
+  // One JSON object per line, with the station_id, the passenger_event ("in"
+  // or "out") and the timestamp in microseconds since the Unix epoch.
+  static void WritePassengerEvents(
+    std::span<const PassengerEvent> events,
+    std::ostream &output);
+  static void WritePassengerEventsFile(
+    std::span<const PassengerEvent> events,
+    const std::string &path);
+};
+
+} // namespace Structures::TransportNetwork
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "PathFinder.h"
+#include "TransportGraph.h"
+#include "TransportNetworkTypes.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <vector>
+
+namespace Structures::TransportNetwork {
+
+// Travel times between every pair of stations of a graph, precomputed with
+// one search per start station spread over a number of threads. Times are
+// stored row-major, a row per start station, in 16 bits each.
+class TravelTimeMatrix {
+public:
+  using Time = std::uint16_t;
+
+  // Longer times saturate at kMaxTime.
+  static constexpr Time kUnreachable{std::numeric_limits<Time>::max()};
+  static constexpr Time kMaxTime{kUnreachable - 1};
+
+  TravelTimeMatrix() = default;
+
+  // Times are total times as FindFastestPath reports them for the options.
+  // Uses at least one thread.
+  TravelTimeMatrix(
+    const TransportGraph &graph,
+    const ItineraryOptions &options,
+    std::size_t threadCount);
+
+  TravelTimeMatrix(const TravelTimeMatrix &) = default;
+  auto operator=(const TravelTimeMatrix &) -> TravelTimeMatrix & = default;
+
+  TravelTimeMatrix(TravelTimeMatrix &&) = default;
+  auto operator=(TravelTimeMatrix &&) -> TravelTimeMatrix & = default;
+
+  ~TravelTimeMatrix() = default;
+
+  [[nodiscard]] auto GetStationCount() const -> std::size_t;
+
+  // kUnreachable for unknown stations too.
+  [[nodiscard]] auto Get(StationIndex start, StationIndex end) const -> Time;
+  [[nodiscard]] auto GetRow(StationIndex start) const -> std::span<const Time>;
+
+  // Heap bytes held, see MemoryUsage.h.
+  [[nodiscard]] auto GetMemoryUsage() const -> std::size_t;
+
+private:
+  std::size_t m_stationCount{0};
+  std::vector<Time> m_times{};
+};
+
+} // namespace Structures::TransportNetwork
@@ -0,0 +1,30 @@
+#include <TransportNetwork/ForkRegistry.h>
+#include <TransportNetwork/ForkedPassengerCounts.h>
+
+#include <algorithm>
+
+namespace Structures::TransportNetwork {
+
+void ForkRegistry::Register(
+  const std::shared_ptr<ForkedPassengerCounts> &pCounts)
+{
+  std::lock_guard lock{m_mutex};
+  std::erase_if(m_forks, [](const auto &pFork) { return pFork.expired(); });
+  m_forks.push_back(pCounts);
+  m_epoch.fetch_add(1, std::memory_order_acq_rel);
+}
+
+void ForkRegistry::Capture(
+  const StationIndex station,
+  const PassengerCounter *pSource,
+  const std::size_t count) const
+{
+  std::lock_guard lock{m_mutex};
+  for (const auto &pFork : m_forks) {
+    if (const auto pCounts{pFork.lock()}) {
+      pCounts->Capture(station, pSource, count);
+    }
+  }
+}
+
+} // namespace Structures::TransportNetwork
@@ -0,0 +1,159 @@
+#include <TransportNetwork/ForkedPassengerCounts.h>
+#include <TransportNetwork/TransportNetwork.h>
+
+#include <cassert>
+#include <utility>
+
+namespace Structures::TransportNetwork {
+
+ForkedPassengerCounts::ForkedPassengerCounts(
+  CopyOnWrite<std::vector<std::shared_ptr<Station>>> stations,
+  std::shared_ptr<const ForkedPassengerCounts> pParent,
+  std::shared_ptr<ForkRegistry> pForks)
+    : m_stations(std::move(stations)),
+      m_pParent(std::move(pParent)),
+      m_pForks(std::move(pForks)),
+      m_slots(m_stations->size())
+{
+  assert(m_pForks);
+}
+
+auto ForkedPassengerCounts::Covers(const StationIndex station) const -> bool
+{
+  return station < m_slots.Size();
+}
+
+auto ForkedPassengerCounts::Get(const StationIndex station) const
+  -> std::size_t
+{
+  assert(Covers(station));
+
+  const auto *pSlot{m_slots.Find(station)};
+  auto count{pSlot ? pSlot->count.load(std::memory_order_acquire)
+                   : kUncaptured};
+  if (count == kUncaptured) {
+    // A source about to change captures its count first, so if the count is
+    // still uncaptured after reading the source, the source was unchanged.
+    const auto sourceCount{source(station)};
+    pSlot = m_slots.Find(station);
+    count = pSlot ? pSlot->count.load(std::memory_order_acquire)
+                  : kUncaptured;
+    if (count == kUncaptured) {
+      return sourceCount;
+    }
+  }
+
+  if (count == kCloned) {
+    return pSlot->pClone.load(std::memory_order_acquire)->Get();
+  }
+
+  return count;
+}
+
+void ForkedPassengerCounts::Set(
+  const StationIndex station,
+  const std::size_t count)
+{
+  assert(Covers(station));
+
+  auto &slot{m_slots.Get(station)};
+  beforeChange(station, slot);
+  slot.count.store(count, std::memory_order_release);
+}
+
+void ForkedPassengerCounts::Capture(
+  const StationIndex station,
+  const PassengerCounter *pSource,
+  const std::size_t count)
+{
+  if (!Covers(station)) {
+    return;
+  }
+
+  // Covered by the parent, the fork reads whatever the parent counts, which
+  // only the parent's own counts and clones change. Otherwise it reads the
+  // station it was forked with, which the source has to be.
+  if (!m_pParent || !m_pParent->Covers(station)) {
+    const auto &pStation{(*m_stations)[station]};
+    if (!pStation || &pStation->m_passengerCount != pSource) {
+      return;
+    }
+  }
+
+  auto expected{kUncaptured};
+  m_slots.Get(station).count.compare_exchange_strong(
+    expected,
+    count,
+    std::memory_order_acq_rel,
+    std::memory_order_acquire);
+}
+
+auto ForkedPassengerCounts::GetMemoryUsage() const -> std::size_t
+{
+  std::lock_guard lock{m_cloneMutex};
+  return m_slots.GetMemoryUsage() + m_clones.size() * sizeof(Station);
+}
+
+auto ForkedPassengerCounts::source(const StationIndex station) const
+  -> std::size_t
+{
+  if (m_pParent && m_pParent->Covers(station)) {
+    return m_pParent->Get(station);
+  }
+
+  const auto &pStation{(*m_stations)[station]};
+  return pStation ? pStation->GetPassengerCount() : 0;
+}
+
+void ForkedPassengerCounts::beforeChange(
+  const StationIndex station,
+  Slot &slot)
+{
+  const auto epoch{m_pForks->GetEpoch()};
+  if (slot.epoch.load(std::memory_order_acquire) != epoch) {
+    m_pForks->Capture(station, nullptr, Get(station));
+    slot.epoch.store(epoch, std::memory_order_release);
+  }
+}
+
+auto ForkedPassengerCounts::findClone(const StationIndex station) const
+  -> std::shared_ptr<Station>
+{
+  const auto *pSlot{m_slots.Find(station)};
+  if (pSlot == nullptr ||
+      pSlot->count.load(std::memory_order_acquire) != kCloned) {
+    return nullptr;
+  }
+
+  return m_clones.at(station);
+}
+
+auto ForkedPassengerCounts::adoptClone(
+  const StationIndex station,
+  std::shared_ptr<Station> pClone) -> std::shared_ptr<Station>
+{
+  assert(pClone);
+
+  // The clone holds the fork's count before the fork reads and changes it
+  // there. Changes racing with this one retry on top of the clone.
+  auto &counter{pClone->m_passengerCount};
+  counter.Track(m_pForks, station);
+
+  auto &slot{m_slots.Get(station)};
+  slot.pClone.store(&counter, std::memory_order_release);
+  auto count{slot.count.load(std::memory_order_acquire)};
+  do {
+    counter = PassengerCounter{
+      count == kUncaptured ? source(station)
+                           : static_cast<std::size_t>(count)};
+  } while (!slot.count.compare_exchange_weak(
+    count,
+    kCloned,
+    std::memory_order_acq_rel,
+    std::memory_order_acquire));
+
+  m_clones[station] = pClone;
+  return pClone;
+}
+
+} // namespace Structures::TransportNetwork
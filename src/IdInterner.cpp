@@ -0,0 +1,91 @@
+#include <TransportNetwork/IdInterner.h>
+#include <TransportNetwork/MemoryUsage.h>
+
+#include <cassert>
+
+namespace Structures::TransportNetwork {
+
+IdInterner::IdInterner(const ArenaAllocator<std::byte> allocator)
+    : m_indices(allocator)
+{
+}
+
+IdInterner::IdInterner(const IdInterner &other)
+    : m_indices(other.m_indices)
+{
+  rebuildKeys();
+}
+
+IdInterner::IdInterner(
+  const IdInterner &other,
+  const ArenaAllocator<std::byte> allocator)
+    : m_indices(other.m_indices, allocator)
+{
+  rebuildKeys();
+}
+
+auto IdInterner::operator=(const IdInterner &other) -> IdInterner &
+{
+  if (this != &other) {
+    m_indices = other.m_indices;
+    rebuildKeys();
+  }
+
+  return *this;
+}
+
+auto IdInterner::Intern(const std::string &id) -> InternedId
+{
+  assert(m_ids.size() < kInvalidId);
+
+  const auto [it, inserted]{
+    m_indices.try_emplace(id, static_cast<InternedId>(m_ids.size()))};
+  if (inserted) {
+    m_ids.push_back(&it->first);
+  }
+
+  return it->second;
+}
+
+auto IdInterner::Find(std::string_view id) const -> InternedId
+{
+  const auto cit{m_indices.find(id)};
+  return (cit != m_indices.end() ? cit->second : kInvalidId);
+}
+
+auto IdInterner::Resolve(InternedId index) const -> const std::string &
+{
+  assert(index < m_ids.size());
+  return *m_ids[index];
+}
+
+auto IdInterner::Size() const -> std::size_t
+{
+  return m_ids.size();
+}
+
+auto IdInterner::GetMemoryUsage() const -> std::size_t
+{
+  auto bytes{HashTableBytes(m_indices) + HeapBytes(m_ids)};
+  for (const auto &[id, index] : m_indices) {
+    bytes += HeapBytes(id);
+  }
+
+  return bytes;
+}
+
+void IdInterner::Reserve(std::size_t size)
+{
+  m_indices.reserve(size);
+  m_ids.reserve(size);
+}
+
+void IdInterner::rebuildKeys()
+{
+  m_ids.assign(m_indices.size(), nullptr);
+  for (const auto &[id, index] : m_indices) {
+    m_ids[index] = &id;
+  }
+}
+
+} // namespace Structures::TransportNetwork
@@ -0,0 +1,253 @@
+#include <TransportNetwork/ItineraryCache.h>
+#include <TransportNetwork/MemoryUsage.h>
+
+#include <algorithm>
+#include <cassert>
+#include <mutex>
+
+#include <boost/container_hash/hash.hpp>
+
+namespace Structures::TransportNetwork {
+
+ItineraryCache::Slot::Slot(const Slot &other)
+    : key(other.key),
+      itinerary(other.itinerary),
+      used(other.used),
+      referenced(other.referenced.load(std::memory_order_relaxed))
+{
+}
+
+ItineraryCache::Slot::Slot(Slot &&other) noexcept
+    : key(other.key),
+      itinerary(std::move(other.itinerary)),
+      used(other.used),
+      referenced(other.referenced.load(std::memory_order_relaxed))
+{
+}
+
+ItineraryCache::ItineraryCache(const std::size_t capacity)
+    : m_capacity(capacity)
+{
+}
+
+ItineraryCache::ItineraryCache(const ItineraryCache &other)
+    : m_capacity(other.m_capacity)
+{
+  const std::shared_lock lock{other.m_mutex};
+
+  m_slots.reserve(other.m_slots.size());
+  for (const auto &slot : other.m_slots) {
+    m_slots.push_back(slot);
+  }
+
+  m_freeSlots = other.m_freeSlots;
+  m_entries = other.m_entries;
+  m_hops = other.m_hops;
+  m_hand = other.m_hand;
+
+  m_hits.store(other.m_hits.load(std::memory_order_relaxed));
+  m_misses.store(other.m_misses.load(std::memory_order_relaxed));
+  m_evictions.store(other.m_evictions.load(std::memory_order_relaxed));
+  m_invalidations.store(
+    other.m_invalidations.load(std::memory_order_relaxed));
+}
+
+auto ItineraryCache::GetCapacity() const -> std::size_t
+{
+  return m_capacity;
+}
+
+auto ItineraryCache::GetStats() const -> ItineraryCacheStats
+{
+  const std::shared_lock lock{m_mutex};
+
+  return ItineraryCacheStats{
+    .hits = m_hits.load(std::memory_order_relaxed),
+    .misses = m_misses.load(std::memory_order_relaxed),
+    .evictions = m_evictions.load(std::memory_order_relaxed),
+    .invalidations = m_invalidations.load(std::memory_order_relaxed),
+    .entries = m_entries.size()};
+}
+
+auto ItineraryCache::GetMemoryUsage() const -> std::size_t
+{
+  const std::shared_lock lock{m_mutex};
+
+  auto bytes{
+    m_slots.capacity() * sizeof(Slot) + HeapBytes(m_freeSlots) +
+    HashTableBytes(m_entries) + HashTableBytes(m_hops)};
+  for (const auto &slot : m_slots) {
+    bytes += HeapBytes(slot.itinerary.steps);
+  }
+
+  for (const auto &[hop, slots] : m_hops) {
+    bytes += HeapBytes(slots);
+  }
+
+  return bytes;
+}
+
+auto ItineraryCache::Find(
+  const StationIndex start,
+  const StationIndex end,
+  const ItineraryOptions &options,
+  Itinerary &result) -> bool
+{
+  const std::shared_lock lock{m_mutex};
+
+  const auto it{m_entries.find(Key{start, end, options})};
+  if (it == m_entries.end()) {
+    m_misses.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  auto &slot{m_slots[it->second]};
+  slot.referenced.store(true, std::memory_order_relaxed);
+  const auto &steps{slot.itinerary.steps};
+  result.steps.assign(steps.begin(), steps.end());
+  result.travelTime = slot.itinerary.travelTime;
+  result.totalTime = slot.itinerary.totalTime;
+
+  m_hits.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+void ItineraryCache::Insert(
+  const StationIndex start,
+  const StationIndex end,
+  const ItineraryOptions &options,
+  const Itinerary &itinerary)
+{
+  if (m_capacity == 0) {
+    return;
+  }
+
+  const std::unique_lock lock{m_mutex};
+
+  // Another thread may have inserted the same query in the meantime.
+  const Key key{start, end, options};
+  if (m_entries.contains(key)) {
+    return;
+  }
+
+  const auto index{takeSlot()};
+  auto &slot{m_slots[index]};
+  slot.key = key;
+  slot.itinerary.steps.assign(
+    itinerary.steps.begin(),
+    itinerary.steps.end());
+  slot.itinerary.travelTime = itinerary.travelTime;
+  slot.itinerary.totalTime = itinerary.totalTime;
+  slot.used = true;
+  slot.referenced.store(false, std::memory_order_relaxed);
+
+  m_entries.emplace(key, index);
+  const auto &steps{slot.itinerary.steps};
+  for (std::size_t i{1}; i < steps.size(); ++i) {
+    m_hops[hopKey(steps[i - 1].station, steps[i].station)].push_back(index);
+  }
+}
+
+void ItineraryCache::InvalidateHop(
+  const StationIndex from,
+  const StationIndex to)
+{
+  const std::unique_lock lock{m_mutex};
+
+  const auto it{m_hops.find(hopKey(from, to))};
+  if (it == m_hops.end()) {
+    return;
+  }
+
+  // Erasing an entry updates the list being walked.
+  const auto slots{std::move(it->second)};
+  m_hops.erase(it);
+  for (const auto slot : slots) {
+    if (m_slots[slot].used) {
+      erase(slot);
+      m_invalidations.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+}
+
+void ItineraryCache::Clear()
+{
+  const std::unique_lock lock{m_mutex};
+
+  m_slots.clear();
+  m_freeSlots.clear();
+  m_entries.clear();
+  m_hops.clear();
+  m_hand = 0;
+}
+
+auto ItineraryCache::KeyHash::operator()(const Key &key) const -> std::size_t
+{
+  std::size_t seed{0};
+  boost::hash_combine(seed, key.start);
+  boost::hash_combine(seed, key.end);
+  boost::hash_combine(seed, key.options.lineChangePenalty);
+  return seed;
+}
+
+auto ItineraryCache::hopKey(const StationIndex from, const StationIndex to)
+  -> std::uint64_t
+{
+  return (static_cast<std::uint64_t>(from) << 32) | to;
+}
+
+auto ItineraryCache::takeSlot() -> std::uint32_t
+{
+  if (!m_freeSlots.empty()) {
+    const auto slot{m_freeSlots.back()};
+    m_freeSlots.pop_back();
+    return slot;
+  }
+
+  if (m_slots.size() < m_capacity) {
+    m_slots.emplace_back();
+    return static_cast<std::uint32_t>(m_slots.size() - 1);
+  }
+
+  // Full, so every slot is in use.
+  while (m_slots[m_hand].referenced.exchange(
+    false,
+    std::memory_order_relaxed)) {
+    m_hand = (m_hand + 1) % m_slots.size();
+  }
+
+  const auto slot{static_cast<std::uint32_t>(m_hand)};
+  m_hand = (m_hand + 1) % m_slots.size();
+
+  erase(slot);
+  m_evictions.fetch_add(1, std::memory_order_relaxed);
+
+  m_freeSlots.pop_back();
+  return slot;
+}
+
+void ItineraryCache::erase(const std::uint32_t slot)
+{
+  auto &entry{m_slots[slot]};
+  assert(entry.used);
+
+  m_entries.erase(entry.key);
+
+  const auto &steps{entry.itinerary.steps};
+  for (std::size_t i{1}; i < steps.size(); ++i) {
+    const auto hop{hopKey(steps[i - 1].station, steps[i].station)};
+    const auto it{m_hops.find(hop)};
+    if (it != m_hops.end()) {
+      std::erase(it->second, slot);
+      if (it->second.empty()) {
+        m_hops.erase(it);
+      }
+    }
+  }
+
+  entry.itinerary.steps.clear();
+  entry.used = false;
+  m_freeSlots.push_back(slot);
+}
+
+} // namespace Structures::TransportNetwork
@@ -0,0 +1,280 @@
+#include <TransportNetwork/LayoutGenerator.h>
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <utility>
+
+namespace Structures::TransportNetwork {
+
+namespace {
+
+using Random = std::mt19937_64;
+
+// Uniform in [0, bound) for bound > 0, with a bias far below what the bounds
+// used here could show.
+auto Draw(Random &random, const std::uint64_t bound) -> std::uint64_t
+{
+  return random() % bound;
+}
+
+// Uniform in [0, 1).
+auto DrawUnit(Random &random) -> double
+{
+  return static_cast<double>(random() >> 11U) * 0x1.0p-53;
+}
+
+// Numbered as in network-layout.json, e.g. station_007.
+auto MakeId(
+  const std::string_view prefix,
+  const std::size_t number,
+  const std::size_t count) -> std::string
+{
+  const auto largest{count > 0 ? count - 1 : 0};
+  const auto width{std::max<std::size_t>(std::to_string(largest).size(), 3)};
+  auto digits{std::to_string(number)};
+  digits.insert(0, width - digits.size(), '0');
+  return std::string{prefix} + digits;
+}
+
+auto PairKey(const std::uint32_t a, const std::uint32_t b) -> std::uint64_t
+{
+  return (static_cast<std::uint64_t>(std::min(a, b)) << 32U) | std::max(a, b);
+}
+
+void Validate(const LayoutGeneratorOptions &options)
+{
+  if (options.routeLength < 2 || options.routeLength > options.stationCount) {
+    throw std::invalid_argument(
+      "(LayoutGenerator::Generate): routeLength must be in [2, stationCount]");
+  }
+
+  if (!(options.interchangeDensity >= 0.0 &&
+        options.interchangeDensity <= 1.0)) {
+    throw std::invalid_argument(
+      "(LayoutGenerator::Generate): interchangeDensity must be in [0, 1]");
+  }
+
+  if (options.minTravelTime == 0 ||
+      options.minTravelTime > options.maxTravelTime) {
+    throw std::invalid_argument(
+      "(LayoutGenerator::Generate): Travel times must be in "
+      "[minTravelTime, maxTravelTime], with 0 < minTravelTime");
+  }
+}
+
+} // namespace
+
+auto LayoutGenerator::Generate(const LayoutGeneratorOptions &options)
+  -> NetworkLayout
+{
+  Validate(options);
+
+  Random random{options.seed};
+  NetworkLayout layout{};
+
+  const auto stationCount{options.stationCount};
+  layout.stations.reserve(stationCount);
+  for (std::size_t i{0}; i < stationCount; ++i) {
+    layout.stations.emplace_back(
+      MakeId("station_", i, stationCount),
+      MakeId("Station ", i, stationCount));
+  }
+
+  // Stations no line serves yet, taken from the back.
+  std::vector<std::uint32_t> fresh(stationCount);
+  std::iota(fresh.begin(), fresh.end(), 0U);
+  for (auto i{fresh.size()}; i > 1; --i) {
+    std::swap(fresh[i - 1], fresh[Draw(random, i)]);
+  }
+
+  std::vector<std::uint32_t> served{};
+  served.reserve(stationCount);
+
+  // The last line to stop at each station, so that no line stops twice at
+  // the same one.
+  std::vector<std::size_t> lastLine(stationCount, options.lineCount);
+
+  std::unordered_set<std::uint64_t> timedPairs{};
+  const auto routeCount{2 * options.lineCount};
+  const auto timeRange{options.maxTravelTime - options.minTravelTime + 1};
+
+  layout.lines.reserve(options.lineCount);
+  for (std::size_t lineNumber{0}; lineNumber < options.lineCount;
+       ++lineNumber) {
+    std::vector<std::uint32_t> stops{};
+    stops.reserve(options.routeLength);
+    const auto take{[&](const std::uint32_t station) {
+      lastLine[station] = lineNumber;
+      stops.push_back(station);
+    }};
+
+    // Scans on from a random served station for one this line has not
+    // stopped at yet.
+    const auto takeServed{[&]() {
+      if (served.empty()) {
+        return false;
+      }
+
+      const auto first{Draw(random, served.size())};
+      for (std::size_t i{0}; i < served.size(); ++i) {
+        const auto station{served[(first + i) % served.size()]};
+        if (lastLine[station] != lineNumber) {
+          take(station);
+          return true;
+        }
+      }
+
+      return false;
+    }};
+
+    const auto takeFresh{[&]() {
+      if (fresh.empty()) {
+        return false;
+      }
+
+      take(fresh.back());
+      served.push_back(fresh.back());
+      fresh.pop_back();
+      return true;
+    }};
+
+    const auto canInterchange{!served.empty()};
+    const auto forcedInterchange{Draw(random, options.routeLength)};
+    for (std::size_t i{0}; i < options.routeLength; ++i) {
+      const auto interchange{
+        canInterchange && options.interchangeDensity > 0.0 &&
+        (i == forcedInterchange ||
+         DrawUnit(random) < options.interchangeDensity)};
+
+      // Once every station is served, lines can only reuse them.
+      if (!(interchange && takeServed()) && !takeFresh()) {
+        takeServed();
+      }
+    }
+
+    const auto lineId{MakeId("line_", lineNumber, options.lineCount)};
+    auto &line{layout.lines.emplace_back(Line{
+      .id = lineId,
+      .name = MakeId("Line ", lineNumber, options.lineCount)})};
+
+    StopSequence::Stops stopIds{};
+    stopIds.reserve(stops.size());
+    for (const auto station : stops) {
+      stopIds.push_back(layout.stations[station].m_id);
+    }
+
+    const StopSequence inbound{std::move(stopIds)};
+    const auto routeId{[&](const std::size_t offset) {
+      return MakeId("route_", 2 * lineNumber + offset, routeCount);
+    }};
+
+    line.routes.push_back(std::make_shared<Route>(Route{
+      .lineId = lineId,
+      .routeId = routeId(0),
+      .direction = RouteDirection::kInbound,
+      .startStationId = inbound.front(),
+      .endStationId = inbound.back(),
+      .stops = inbound}));
+    line.routes.push_back(std::make_shared<Route>(Route{
+      .lineId = lineId,
+      .routeId = routeId(1),
+      .direction = RouteDirection::kOutbound,
+      .startStationId = inbound.back(),
+      .endStationId = inbound.front(),
+      .stops = inbound.Reversed()}));
+
+    // One travel time per pair of neighbouring stations, whichever line
+    // reaches them first, as in network-layout.json.
+    for (std::size_t i{1}; i < stops.size(); ++i) {
+      if (timedPairs.insert(PairKey(stops[i - 1], stops[i])).second) {
+        layout.travelTimes.push_back(LayoutTravelTime{
+          .startStationId = inbound[i - 1],
+          .endStationId = inbound[i],
+          .lineId = lineId,
+          .routeId = line.routes.front()->routeId,
+          .travelTime = options.minTravelTime +
+                        static_cast<unsigned int>(Draw(random, timeRange))});
+      }
+    }
+  }
+
+  return layout;
+}
+
+auto LayoutGenerator::GeneratePassengerEvents(
+  const NetworkLayout &layout,
+  const PassengerEventOptions &options) -> std::vector<PassengerEvent>
+{
+  if (!(options.outShare >= 0.0 && options.outShare <= 1.0)) {
+    throw std::invalid_argument(
+      "(LayoutGenerator::GeneratePassengerEvents): outShare must be in [0, 1]");
+  }
+
+  if (options.meanInterval.count() < 0) {
+    throw std::invalid_argument(
+      "(LayoutGenerator::GeneratePassengerEvents): meanInterval must not be "
+      "negative");
+  }
+
+  // A station appears once for every line that stops at it.
+  std::vector<const StationId *> stops{};
+  for (const auto &line : layout.lines) {
+    if (!line.routes.empty()) {
+      for (const auto &stop : line.routes.front()->stops) {
+        stops.push_back(&stop);
+      }
+    }
+  }
+
+  if (stops.empty()) {
+    for (const auto &station : layout.stations) {
+      stops.push_back(&station.m_id);
+    }
+  }
+
+  std::vector<PassengerEvent> events{};
+  if (stops.empty()) {
+    return events;
+  }
+
+  // The station of every passenger inside one.
+  std::vector<const StationId *> inside{};
+
+  Random random{options.seed};
+  const auto maxGap{
+    2 * static_cast<std::uint64_t>(options.meanInterval.count())};
+  auto timestamp{options.start};
+
+  events.reserve(options.eventCount);
+  for (std::size_t i{0}; i < options.eventCount; ++i) {
+    timestamp += std::chrono::microseconds{
+      static_cast<std::chrono::microseconds::rep>(Draw(random, maxGap + 1))};
+
+    if (!inside.empty() && DrawUnit(random) < options.outShare) {
+      const auto passenger{Draw(random, inside.size())};
+      std::swap(inside[passenger], inside.back());
+      events.push_back(PassengerEvent{
+        .m_stationId = *inside.back(),
+        .m_type = PassengerEvent::Type::kOut,
+        .m_timestamp = timestamp});
+      inside.pop_back();
+    }
+    else {
+      const auto *pStation{stops[Draw(random, stops.size())]};
+      inside.push_back(pStation);
+      events.push_back(PassengerEvent{
+        .m_stationId = *pStation,
+        .m_type = PassengerEvent::Type::kIn,
+        .m_timestamp = timestamp});
+    }
+  }
+
+  return events;
+}
+
+} // namespace Structures::TransportNetwork
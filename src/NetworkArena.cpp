@@ -0,0 +1,106 @@
+#include <TransportNetwork/NetworkArena.h>
+
+#include <algorithm>
+#include <cassert>
+#include <functional>
+
+namespace Structures::TransportNetwork {
+
+NetworkArena::BlockResource::BlockResource(
+  std::pmr::memory_resource *pUpstream)
+    : m_pUpstream(pUpstream)
+{
+}
+
+auto NetworkArena::BlockResource::Contains(const void *p) const -> bool
+{
+  const auto *pByte{static_cast<const std::byte *>(p)};
+  return std::ranges::any_of(m_blocks, [pByte](const auto &block) {
+    return !std::less<>{}(pByte, block.first) &&
+           std::less<>{}(pByte, block.first + block.second);
+  });
+}
+
+auto NetworkArena::BlockResource::do_allocate(
+  const std::size_t bytes,
+  const std::size_t alignment) -> void *
+{
+  auto *p{m_pUpstream->allocate(bytes, alignment)};
+  m_blocks.emplace_back(static_cast<const std::byte *>(p), bytes);
+  return p;
+}
+
+void NetworkArena::BlockResource::do_deallocate(
+  void *p,
+  const std::size_t bytes,
+  const std::size_t alignment)
+{
+  std::erase_if(m_blocks, [p](const auto &block) { return block.first == p; });
+  m_pUpstream->deallocate(p, bytes, alignment);
+}
+
+auto NetworkArena::BlockResource::do_is_equal(
+  const std::pmr::memory_resource &other) const noexcept -> bool
+{
+  return this == &other;
+}
+
+NetworkArena::NetworkArena(
+  const std::size_t initialBlockSize,
+  std::pmr::memory_resource *pUpstream)
+    : m_blocks(pUpstream),
+      m_resource(initialBlockSize, &m_blocks),
+      m_pool(pUpstream)
+{
+}
+
+void NetworkArena::BeginLoad()
+{
+  const std::scoped_lock lock{m_mutex};
+  m_loads++;
+}
+
+void NetworkArena::EndLoad()
+{
+  const std::scoped_lock lock{m_mutex};
+  assert(m_loads != 0);
+  m_loads--;
+}
+
+auto NetworkArena::GetAllocatedBytes() const -> std::size_t
+{
+  const std::scoped_lock lock{m_mutex};
+  return m_allocatedBytes;
+}
+
+auto NetworkArena::do_allocate(
+  const std::size_t bytes,
+  const std::size_t alignment) -> void *
+{
+  const std::scoped_lock lock{m_mutex};
+  auto *p{
+    m_loads != 0 ? m_resource.allocate(bytes, alignment)
+              : m_pool.allocate(bytes, alignment)};
+  m_allocatedBytes += bytes;
+  return p;
+}
+
+void NetworkArena::do_deallocate(
+  void *p,
+  const std::size_t bytes,
+  const std::size_t alignment)
+{
+  const std::scoped_lock lock{m_mutex};
+  if (!m_blocks.Contains(p)) {
+    m_pool.deallocate(p, bytes, alignment);
+    m_allocatedBytes -= bytes;
+  }
+}
+
+auto NetworkArena::do_is_equal(const std::pmr::memory_resource &other) const
+  noexcept -> bool
+{
+  return this == &other;
+}
+
+} // namespace Structures::TransportNetwork
@@ -0,0 +1,778 @@
+#include <TransportNetwork/PassengerEventJournal.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace Structures::TransportNetwork {
+
+namespace {
+
+constexpr std::array<char, 8> kSegmentMagic{
+  'L', 'T', 'N', 'S', 'J', 'R', 'N', '\0'};
+constexpr std::array<char, 8> kCheckpointMagic{
+  'L', 'T', 'N', 'S', 'C', 'K', 'P', '\0'};
+constexpr std::uint32_t kByteOrderMark{0x01020304};
+constexpr std::string_view kCheckpointName{"checkpoint.bin"};
+constexpr std::string_view kSegmentPrefix{"journal-"};
+constexpr std::string_view kSegmentSuffix{".bin"};
+
+// Keeps blocks small enough to be read back whole.
+constexpr std::uint32_t kMaxBlockRecords{std::uint32_t{1} << 16U};
+
+struct SegmentHeader {
+  std::array<char, 8> magic{};
+  std::uint32_t version{};
+  std::uint32_t byteOrderMark{};
+  std::uint64_t segment{};
+};
+
+struct BlockHeader {
+  std::uint32_t recordCount{};
+  std::uint32_t checksum{};
+};
+
+struct CheckpointHeader {
+  std::array<char, 8> magic{};
+  std::uint32_t version{};
+  std::uint32_t byteOrderMark{};
+
+  // First segment to replay on top of the counts.
+  std::uint64_t segment{};
+  std::uint64_t stationCount{};
+  std::uint32_t checksum{};
+  std::uint32_t reserved{};
+};
+
+static_assert(sizeof(JournalRecord) == 12);
+static_assert(std::is_trivially_copyable_v<JournalRecord>);
+static_assert(std::is_trivially_copyable_v<SegmentHeader>);
+static_assert(std::is_trivially_copyable_v<BlockHeader>);
+static_assert(std::is_trivially_copyable_v<CheckpointHeader>);
+
+auto Encode(
+  const StationIndex station,
+  const PassengerEvent::Type type,
+  const PassengerTimestamp timestamp) -> JournalRecord
+{
+  const auto micros{
+    std::chrono::duration_cast<std::chrono::microseconds>(
+      timestamp.time_since_epoch())
+      .count()};
+  const auto stamp{
+    (static_cast<std::uint64_t>(micros) << 1U) |
+    (type == PassengerEvent::Type::kOut ? 1U : 0U)};
+  return JournalRecord{
+    .station = station,
+    .stamp = {
+      static_cast<std::uint32_t>(stamp),
+      static_cast<std::uint32_t>(stamp >> 32U)}};
+}
+
+auto IsOut(const JournalRecord &record) -> bool
+{
+  return (record.stamp[0] & 1U) != 0;
+}
+
+auto DecodeTimestamp(const JournalRecord &record) -> PassengerTimestamp
+{
+  const auto stamp{
+    (static_cast<std::uint64_t>(record.stamp[1]) << 32U) | record.stamp[0]};
+  return PassengerTimestamp{std::chrono::duration_cast<
+    PassengerTimestamp::duration>(std::chrono::microseconds{
+    static_cast<std::int64_t>(stamp) >> 1})};
+}
+
+// Fletcher-like sums over 32-bit words: cheap enough for the committer to
+// keep up with ingestion, and enough to tell a torn or half-written block.
+auto Checksum(const std::span<const std::byte> bytes, const std::uint64_t seed)
+  -> std::uint32_t
+{
+  assert(bytes.size() % sizeof(std::uint32_t) == 0);
+
+  std::uint64_t sum{seed};
+  std::uint64_t sumOfSums{0};
+  for (std::size_t i{0}; i < bytes.size(); i += sizeof(std::uint32_t)) {
+    std::uint32_t word{};
+    std::memcpy(&word, bytes.data() + i, sizeof(word));
+    sum += word;
+    sumOfSums += sum;
+  }
+
+  return static_cast<std::uint32_t>(sum ^ (sumOfSums >> 32U) ^ sumOfSums);
+}
+
+auto BlockChecksum(
+  const std::uint32_t recordCount,
+  const std::span<const std::byte> records) -> std::uint32_t
+{
+  return Checksum(records, recordCount);
+}
+
+auto Failed(const std::string &what, const std::filesystem::path &path)
+  -> std::runtime_error
+{
+  return std::runtime_error(
+    "(PassengerEventJournal): Failed to " + what + " " + path.string() + ": " +
+    std::system_category().message(errno));
+}
+
+auto Corrupt(const std::string &what) -> std::runtime_error
+{
+  return std::runtime_error(
+    "(PassengerEventJournal::Recover): Corrupt journal, " + what);
+}
+
+// Writes the parts back to back, as one write unless interrupted.
+void WriteAll(
+  const int fd,
+  std::array<std::span<const std::byte>, 2> parts,
+  const std::filesystem::path &path)
+{
+  std::size_t part{0};
+  while (part < parts.size()) {
+    std::array<iovec, 2> vectors{};
+    for (std::size_t i{part}; i < parts.size(); ++i) {
+      vectors[i - part] = iovec{
+        .iov_base = const_cast<std::byte *>(parts[i].data()),
+        .iov_len = parts[i].size()};
+    }
+
+    auto written{::writev(
+      fd,
+      vectors.data(),
+      static_cast<int>(parts.size() - part))};
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+
+      throw Failed("write", path);
+    }
+
+    for (; part < parts.size(); ++part) {
+      const auto size{std::min(
+        parts[part].size(),
+        static_cast<std::size_t>(written))};
+      parts[part] = parts[part].subspan(size);
+      written -= static_cast<ssize_t>(size);
+      if (!parts[part].empty()) {
+        break;
+      }
+    }
+  }
+}
+
+template <typename T> auto AsBytes(const T &value) -> std::span<const std::byte>
+{
+  return std::as_bytes(std::span{&value, 1});
+}
+
+// Makes renames and removals in the directory durable.
+void SyncDirectory(const std::filesystem::path &directory)
+{
+  const auto fd{::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC)};
+  if (fd < 0) {
+    throw Failed("open", directory);
+  }
+
+  if (::fsync(fd) != 0) {
+    // Built before close() can overwrite errno.
+    auto error{Failed("sync", directory)};
+    ::close(fd);
+    throw error;
+  }
+
+  ::close(fd);
+}
+
+auto ReadFile(const std::filesystem::path &path) -> std::vector<std::byte>
+{
+  std::ifstream input{path, std::ios::binary};
+  std::vector<char> data{
+    std::istreambuf_iterator<char>{input},
+    std::istreambuf_iterator<char>{}};
+  if (input.bad()) {
+    throw std::runtime_error(
+      "(PassengerEventJournal::Recover): Failed to read " + path.string());
+  }
+
+  const auto bytes{std::as_bytes(std::span{data})};
+  return {bytes.begin(), bytes.end()};
+}
+
+// Segments in the directory by number.
+auto ListSegments(const std::filesystem::path &directory)
+  -> std::map<std::uint64_t, std::filesystem::path>
+{
+  std::map<std::uint64_t, std::filesystem::path> segments;
+  for (const auto &entry : std::filesystem::directory_iterator{directory}) {
+    const auto name{entry.path().filename().string()};
+    if (!name.starts_with(kSegmentPrefix) || !name.ends_with(kSegmentSuffix)) {
+      continue;
+    }
+
+    const auto *pFirst{name.data() + kSegmentPrefix.size()};
+    const auto *pLast{name.data() + name.size() - kSegmentSuffix.size()};
+    std::uint64_t segment{};
+    if (const auto [pEnd, error]{std::from_chars(pFirst, pLast, segment)};
+        error == std::errc{} && pEnd == pLast) {
+      segments.emplace(segment, entry.path());
+    }
+  }
+
+  return segments;
+}
+
+} // namespace
+
+PassengerEventJournal::Writer::Channel::Channel(const std::size_t capacity)
+    : queue(capacity)
+{
+}
+
+PassengerEventJournal::Writer::Writer(
+  PassengerEventJournal &journal,
+  const std::size_t capacity)
+    : m_pJournal(&journal),
+      m_pChannel(std::make_shared<Channel>(capacity))
+{
+}
+
+PassengerEventJournal::Writer::~Writer()
+{
+  if (!m_pChannel) {
+    return;
+  }
+
+  try {
+    Flush();
+  }
+  catch (const std::runtime_error &) {
+    // The committer has failed, Sync() reports it.
+  }
+
+  m_pChannel->closed.store(true, std::memory_order_release);
+}
+
+auto PassengerEventJournal::Writer::Record(const PassengerEvent &event) -> bool
+{
+  return Record(
+    m_pJournal->m_network.GetStationIndex(event.m_stationId),
+    event.m_type,
+    event.m_timestamp);
+}
+
+auto PassengerEventJournal::Writer::Record(
+  const StationIndex station,
+  const PassengerEvent::Type type,
+  const PassengerTimestamp timestamp) -> bool
+{
+  assert(m_pChannel);
+
+  // Stations added after the journal was opened have no count in it.
+  if (station >= m_pJournal->m_stationCount) {
+    return false;
+  }
+
+  const auto stamped{
+    timestamp == PassengerTimestamp{} ? PassengerClock::now() : timestamp};
+  if (!m_pJournal->m_network.RecordPassengerEvent(station, type, stamped)) {
+    return false;
+  }
+
+  m_batch[m_batchSize++] = Encode(station, type, stamped);
+  if (m_batchSize == kBatchSize) {
+    Flush();
+  }
+
+  return true;
+}
+
+auto PassengerEventJournal::Writer::Record(
+  const std::span<const PassengerEvent> events) -> std::size_t
+{
+  return static_cast<std::size_t>(
+    std::ranges::count_if(events, [this](const PassengerEvent &event) {
+      return Record(event);
+    }));
+}
+
+void PassengerEventJournal::Writer::Flush()
+{
+  assert(m_pChannel);
+
+  auto &queue{m_pChannel->queue};
+  std::size_t pushed{0};
+  while (true) {
+    pushed += queue.push(m_batch.data() + pushed, m_batchSize - pushed);
+    if (pushed == m_batchSize) {
+      break;
+    }
+
+    if (m_pJournal->m_failed.load(std::memory_order_acquire)) {
+      throw std::runtime_error(
+        "(PassengerEventJournal::Writer::Flush): Committer has failed");
+    }
+
+    m_pJournal->requestCommit();
+    std::this_thread::yield();
+  }
+
+  m_batchSize = 0;
+
+  // Commit early rather than have the writer wait on a full queue.
+  if (queue.write_available() < m_pJournal->m_options.writerCapacity / 2) {
+    m_pJournal->requestCommit();
+  }
+}
+
+PassengerEventJournal::PassengerEventJournal(
+  const TransportNetwork &network,
+  std::filesystem::path directory,
+  JournalOptions options)
+    : m_network(network),
+      m_directory(std::move(directory)),
+      m_options(options),
+      m_stationCount(network.GetStationCount())
+{
+  std::filesystem::create_directories(m_directory);
+
+  const auto segments{ListSegments(m_directory)};
+  m_segment = segments.empty() ? 0 : segments.rbegin()->first;
+
+  m_counts.resize(m_stationCount);
+  for (StationIndex station{0}; station < m_stationCount; ++station) {
+    m_counts[station] =
+      static_cast<std::int64_t>(network.GetPassengerCount(station));
+  }
+
+  checkpoint();
+
+  m_committer = std::jthread{
+    [this](const std::stop_token &stopToken) { commit(stopToken); }};
+}
+
+PassengerEventJournal::~PassengerEventJournal()
+{
+  m_committer.request_stop();
+  m_committer.join();
+
+  if (m_fd >= 0) {
+    ::close(m_fd);
+  }
+}
+
+auto PassengerEventJournal::CreateWriter() -> Writer
+{
+  Writer writer{*this, std::max<std::size_t>(m_options.writerCapacity, 1)};
+
+  const std::lock_guard lock{m_mutex};
+  m_channels.push_back(writer.m_pChannel);
+  return writer;
+}
+
+void PassengerEventJournal::Sync()
+{
+  std::unique_lock lock{m_mutex};
+  const auto pass{m_startedPasses + 1};
+  m_commitRequested.store(true, std::memory_order_relaxed);
+  m_wakeup.notify_one();
+  m_committed.wait(lock, [this, pass]() {
+    return m_completedPasses >= pass || m_pError;
+  });
+
+  if (m_pError) {
+    std::rethrow_exception(m_pError);
+  }
+}
+
+void PassengerEventJournal::Checkpoint()
+{
+  {
+    const std::lock_guard lock{m_mutex};
+    m_checkpointRequested = true;
+  }
+
+  Sync();
+}
+
+auto PassengerEventJournal::Recover(
+  const std::filesystem::path &directory,
+  const TransportNetwork &network) -> JournalRecovery
+{
+  JournalRecovery recovery{};
+  const auto checkpointPath{directory / kCheckpointName};
+  if (!std::filesystem::exists(checkpointPath)) {
+    return recovery;
+  }
+
+  const auto checkpoint{ReadFile(checkpointPath)};
+  CheckpointHeader header{};
+  if (checkpoint.size() < sizeof(header)) {
+    throw Corrupt("checkpoint is too small");
+  }
+
+  std::memcpy(&header, checkpoint.data(), sizeof(header));
+  if (header.magic != kCheckpointMagic) {
+    throw Corrupt("bad checkpoint magic");
+  }
+
+  if (header.byteOrderMark != kByteOrderMark) {
+    throw Corrupt("byte order differs from this machine's");
+  }
+
+  if (header.version != kJournalVersion) {
+    throw Corrupt(
+      "version=" + std::to_string(header.version) +
+      " differs from supported version=" + std::to_string(kJournalVersion));
+  }
+
+  const auto countBytes{
+    std::span{checkpoint}.subspan(sizeof(header))};
+  if (countBytes.size() != header.stationCount * sizeof(std::int64_t) ||
+      Checksum(countBytes, header.stationCount) != header.checksum) {
+    throw Corrupt("checkpoint counts do not match their checksum");
+  }
+
+  if (header.stationCount > network.GetStationCount()) {
+    throw std::runtime_error(
+      "(PassengerEventJournal::Recover): Journal has " +
+      std::to_string(header.stationCount) + " stations, network only " +
+      std::to_string(network.GetStationCount()));
+  }
+
+  recovery.hasCheckpoint = true;
+  std::vector<std::int64_t> counts(header.stationCount);
+  std::memcpy(counts.data(), countBytes.data(), countBytes.size());
+
+  auto torn{false};
+  for (const auto &[segment, path] : ListSegments(directory)) {
+    if (segment < header.segment) {
+      continue;
+    }
+
+    const auto data{ReadFile(path)};
+    if (torn) {
+      recovery.discardedBytes += data.size();
+      continue;
+    }
+
+    recovery.segmentCount++;
+    SegmentHeader segmentHeader{};
+    std::size_t offset{sizeof(segmentHeader)};
+    if (data.size() >= sizeof(segmentHeader)) {
+      std::memcpy(&segmentHeader, data.data(), sizeof(segmentHeader));
+    }
+
+    // A crash may leave a segment without even a header.
+    if (data.size() < sizeof(segmentHeader) ||
+        segmentHeader.magic != kSegmentMagic ||
+        segmentHeader.byteOrderMark != kByteOrderMark ||
+        segmentHeader.version != kJournalVersion ||
+        segmentHeader.segment != segment) {
+      offset = 0;
+    }
+
+    while (offset != 0 && offset < data.size()) {
+      BlockHeader block{};
+      if (data.size() - offset < sizeof(block)) {
+        break;
+      }
+
+      std::memcpy(&block, data.data() + offset, sizeof(block));
+      const auto size{std::size_t{block.recordCount} * sizeof(JournalRecord)};
+      const auto records{
+        std::span{data}.subspan(offset + sizeof(block)).first(
+          std::min(size, data.size() - offset - sizeof(block)))};
+      if (block.recordCount == 0 || block.recordCount > kMaxBlockRecords ||
+          records.size() != size ||
+          BlockChecksum(block.recordCount, records) != block.checksum) {
+        break;
+      }
+
+      for (std::size_t i{0}; i < block.recordCount; ++i) {
+        JournalRecord record{};
+        std::memcpy(
+          &record,
+          records.data() + i * sizeof(record),
+          sizeof(record));
+        if (record.station >= counts.size()) {
+          throw Corrupt(
+            "record of unknown station=" + std::to_string(record.station));
+        }
+
+        const auto out{IsOut(record)};
+        counts[record.station] += out ? -1 : 1;
+        if (const auto pStation{network.GetStation(record.station)}) {
+          pStation->RecordPassengerStatistics(
+            DecodeTimestamp(record),
+            out ? 0 : 1,
+            out ? 1 : 0);
+        }
+      }
+
+      recovery.recordCount += block.recordCount;
+      offset += sizeof(block) + size;
+    }
+
+    if (offset != data.size()) {
+      torn = true;
+      recovery.discardedBytes += data.size() - offset;
+    }
+  }
+
+  // Writers commit independently, so an Out may be durable while the In it
+  // followed was lost with its writer's batch. Counts stop at zero as they
+  // do in the network, see PassengerCounter::TryDecrement.
+  for (StationIndex station{0}; station < counts.size(); ++station) {
+    if (const auto pStation{network.GetStation(station)}) {
+      pStation->UpdatePassengerCount(
+        [count = static_cast<std::size_t>(
+           std::max<std::int64_t>(counts[station], 0))](std::size_t) {
+          return count;
+        });
+    }
+  }
+
+  return recovery;
+}
+
+void PassengerEventJournal::commit(const std::stop_token &stopToken)
+{
+  while (!stopToken.stop_requested()) {
+    {
+      std::unique_lock lock{m_mutex};
+      m_wakeup.wait_for(
+        lock,
+        stopToken,
+        m_options.commitInterval,
+        [this]() {
+          return m_commitRequested.load(std::memory_order_relaxed) ||
+                 m_checkpointRequested;
+        });
+    }
+
+    commitPass();
+  }
+
+  // Whatever the writers flushed before the journal was destroyed.
+  commitPass();
+}
+
+void PassengerEventJournal::commitPass()
+{
+  std::vector<std::shared_ptr<Writer::Channel>> channels;
+  std::uint64_t pass{};
+  bool checkpointRequested{};
+  {
+    const std::lock_guard lock{m_mutex};
+    pass = ++m_startedPasses;
+    checkpointRequested = std::exchange(m_checkpointRequested, false);
+    m_commitRequested.store(false, std::memory_order_relaxed);
+
+    // Closed writers flushed before closing; drain them one last time.
+    std::erase_if(m_channels, [](const auto &pChannel) {
+      return pChannel->closed.load(std::memory_order_acquire) &&
+             pChannel->queue.read_available() == 0;
+    });
+    channels = m_channels;
+  }
+
+  // After a failure the writers are left to fill up and fail in turn.
+  try {
+    if (m_failed.load(std::memory_order_relaxed)) {
+      throw std::runtime_error(
+        "(PassengerEventJournal::commitPass): Committer has failed");
+    }
+
+    // Grown only, to skip zeroing it on every pass.
+    std::size_t drainedCount{0};
+    for (const auto &pChannel : channels) {
+      const auto available{pChannel->queue.read_available()};
+      if (m_drained.size() < drainedCount + available) {
+        m_drained.resize(drainedCount + available);
+      }
+
+      drainedCount +=
+        pChannel->queue.pop(m_drained.data() + drainedCount, available);
+    }
+
+    const std::span drained{m_drained.data(), drainedCount};
+
+    // Each block goes out as its header followed by the records in place.
+    const auto path{segmentPath(m_segment)};
+    std::uint64_t written{0};
+    for (std::size_t first{0}; first < drained.size();
+         first += kMaxBlockRecords) {
+      const auto records{std::as_bytes(drained.subspan(
+        first,
+        std::min<std::size_t>(kMaxBlockRecords, drained.size() - first)))};
+      const auto recordCount{
+        static_cast<std::uint32_t>(records.size() / sizeof(JournalRecord))};
+      const BlockHeader header{
+        .recordCount = recordCount,
+        .checksum = BlockChecksum(recordCount, records)};
+      WriteAll(m_fd, {AsBytes(header), records}, path);
+      written += sizeof(header) + records.size();
+    }
+
+    if (written != 0) {
+      if (::fdatasync(m_fd) != 0) {
+        throw Failed("sync", path);
+      }
+
+      m_segmentSize += written;
+      for (const auto &record : drained) {
+        if (IsOut(record)) {
+          m_counts[record.station]--;
+        }
+        else {
+          m_counts[record.station]++;
+        }
+      }
+    }
+
+    if (checkpointRequested || m_segmentSize >= m_options.checkpointBytes) {
+      checkpoint();
+    }
+  }
+  catch (const std::exception &) {
+    const std::lock_guard lock{m_mutex};
+    if (!m_pError) {
+      m_pError = std::current_exception();
+    }
+
+    m_failed.store(true, std::memory_order_release);
+  }
+
+  {
+    const std::lock_guard lock{m_mutex};
+    m_completedPasses = pass;
+  }
+
+  m_committed.notify_all();
+}
+
+void PassengerEventJournal::requestCommit()
+{
+  if (!m_commitRequested.exchange(true, std::memory_order_relaxed)) {
+    const std::lock_guard lock{m_mutex};
+    m_wakeup.notify_one();
+  }
+}
+
+void PassengerEventJournal::checkpoint()
+{
+  const auto segment{m_segment + 1};
+  const auto path{segmentPath(segment)};
+  const auto fd{
+    ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)};
+  if (fd < 0) {
+    throw Failed("create", path);
+  }
+
+  const SegmentHeader header{
+    .magic = kSegmentMagic,
+    .version = kJournalVersion,
+    .byteOrderMark = kByteOrderMark,
+    .segment = segment};
+  try {
+    WriteAll(fd, {AsBytes(header), {}}, path);
+    if (::fdatasync(fd) != 0) {
+      throw Failed("sync", path);
+    }
+  }
+  catch (...) {
+    ::close(fd);
+    throw;
+  }
+
+  if (m_fd >= 0) {
+    ::close(m_fd);
+  }
+
+  m_fd = fd;
+  m_segment = segment;
+  m_segmentSize = 0;
+
+  writeCheckpoint();
+
+  // Only once the new segment and checkpoint are durable may the segments
+  // the old checkpoint still refers to go.
+  SyncDirectory(m_directory);
+
+  // The checkpoint covers every segment before the new one.
+  for (const auto &[oldSegment, oldPath] : ListSegments(m_directory)) {
+    if (oldSegment < m_segment) {
+      std::filesystem::remove(oldPath);
+    }
+  }
+
+  SyncDirectory(m_directory);
+}
+
+void PassengerEventJournal::writeCheckpoint() const
+{
+  const auto counts{std::as_bytes(std::span{m_counts})};
+  const CheckpointHeader header{
+    .magic = kCheckpointMagic,
+    .version = kJournalVersion,
+    .byteOrderMark = kByteOrderMark,
+    .segment = m_segment,
+    .stationCount = m_counts.size(),
+    .checksum = Checksum(counts, m_counts.size())};
+
+  const auto path{m_directory / kCheckpointName};
+  auto temporary{path};
+  temporary += ".tmp";
+  const auto fd{::open(
+    temporary.c_str(),
+    O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+    0644)};
+  if (fd < 0) {
+    throw Failed("create", temporary);
+  }
+
+  try {
+    WriteAll(fd, {AsBytes(header), counts}, temporary);
+    if (::fsync(fd) != 0) {
+      throw Failed("sync", temporary);
+    }
+  }
+  catch (...) {
+    ::close(fd);
+    throw;
+  }
+
+  ::close(fd);
+  std::filesystem::rename(temporary, path);
+}
+
+auto PassengerEventJournal::segmentPath(const std::uint64_t segment) const
+  -> std::filesystem::path
+{
+  auto number{std::to_string(segment)};
+  if (number.size() < 6) {
+    number.insert(0, 6 - number.size(), '0');
+  }
+
+  return m_directory /
+         (std::string{kSegmentPrefix} + number + std::string{kSegmentSuffix});
+}
+
+} // namespace Structures::TransportNetwork
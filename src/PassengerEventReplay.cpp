@@ -0,0 +1,204 @@
+#include <TransportNetwork/PassengerEventReplay.h>
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+
+namespace Structures::TransportNetwork {
+
+auto ReplayReport::EventsPerSecond() const -> double
+{
+  const std::chrono::duration<double> seconds{elapsed};
+  return seconds.count() > 0
+           ? static_cast<double>(accepted + rejected) / seconds.count()
+           : 0.0;
+}
+
+PassengerEventReplay::PassengerEventReplay(
+  const TransportNetwork &network,
+  const std::span<const PassengerEvent> events)
+    : m_stationCount(network.GetStationCount())
+{
+  if (events.size() >= std::numeric_limits<std::uint32_t>::max()) {
+    throw std::logic_error(
+      "(PassengerEventReplay::PassengerEventReplay): Too many events!");
+  }
+
+  // Counting sort by station, with unknown stations in the last bucket.
+  std::vector<StationIndex> stations;
+  stations.reserve(events.size());
+  std::vector<std::uint32_t> offsets(m_stationCount + 2, 0);
+  const StationId *pLastId{nullptr};
+  auto lastStation{kInvalidId};
+  for (const auto &event : events) {
+    // Logs tend to repeat stations, skip hashing the same id twice in a row.
+    if (pLastId == nullptr || event.m_stationId != *pLastId) {
+      pLastId = &event.m_stationId;
+      lastStation = network.GetStationIndex(event.m_stationId);
+    }
+
+    const auto bucket{std::min<std::size_t>(lastStation, m_stationCount)};
+    stations.push_back(lastStation);
+    offsets[bucket + 1]++;
+  }
+
+  for (std::size_t i{1}; i < offsets.size(); ++i) {
+    offsets[i] += offsets[i - 1];
+  }
+
+  m_events.resize(events.size());
+  m_order.resize(events.size());
+  for (std::uint32_t i{0}; i < events.size(); ++i) {
+    const auto bucket{std::min<std::size_t>(stations[i], m_stationCount)};
+    const auto position{offsets[bucket]++};
+    m_events[position] = ResolvedEvent{
+      .station = stations[i],
+      .type = events[i].m_type,
+      .timestamp = events[i].m_timestamp};
+    m_order[i] = position;
+  }
+}
+
+auto PassengerEventReplay::GetEventCount() const -> std::size_t
+{
+  return m_events.size();
+}
+
+auto PassengerEventReplay::Run(
+  const TransportNetwork &network,
+  const ReplayOptions &options) const -> ReplayReport
+{
+  if (network.GetStationCount() < m_stationCount) {
+    throw std::logic_error(
+      "(PassengerEventReplay::Run): Network has fewer stations than the one "
+      "the events were resolved against!");
+  }
+
+  // Each thread replays a contiguous range of whole stations.
+  std::vector<std::size_t> bounds{0};
+  const auto threadCount{
+    options.speed > 0 ? 1 : std::max<std::size_t>(options.threadCount, 1)};
+  for (std::size_t i{1}; i < threadCount; ++i) {
+    auto bound{std::max(bounds.back(), m_events.size() * i / threadCount)};
+    while (bound > bounds.back() && bound < m_events.size() &&
+           m_events[bound].station == m_events[bound - 1].station) {
+      ++bound;
+    }
+
+    bounds.push_back(bound);
+  }
+
+  bounds.push_back(m_events.size());
+
+  std::vector<ReplayReport> reports(threadCount);
+  const auto start{std::chrono::steady_clock::now()};
+  if (options.speed > 0) {
+    replayPaced(network, options.speed, reports.front());
+  }
+  else {
+    std::vector<std::jthread> threads;
+    threads.reserve(threadCount - 1);
+    for (std::size_t i{1}; i < threadCount; ++i) {
+      threads.emplace_back([this, &network, &bounds, &reports, i]() {
+        replay(network, bounds[i], bounds[i + 1], reports[i]);
+      });
+    }
+
+    replay(network, bounds[0], bounds[1], reports.front());
+
+    // The threads are joined here, before the clock stops.
+  }
+
+  ReplayReport report{};
+  for (const auto &threadReport : reports) {
+    report.accepted += threadReport.accepted;
+    report.rejected += threadReport.rejected;
+  }
+
+  report.elapsed = std::chrono::steady_clock::now() - start;
+  report.checksum = Checksum(network);
+  return report;
+}
+
+auto PassengerEventReplay::Checksum(const TransportNetwork &network)
+  -> std::uint64_t
+{
+  // FNV-1a over the counts, a word at a time.
+  std::uint64_t hash{0xCBF29CE484222325ULL};
+  for (StationIndex station{0}; station < network.GetStationCount();
+       ++station) {
+    hash ^= network.GetPassengerCount(station);
+    hash *= 0x100000001B3ULL;
+  }
+
+  return hash;
+}
+
+void PassengerEventReplay::replay(
+  const TransportNetwork &network,
+  const std::size_t first,
+  const std::size_t last,
+  ReplayReport &report) const
+{
+  std::size_t accepted{0};
+  for (auto i{first}; i < last; ++i) {
+    const auto &event{m_events[i]};
+    if (network.RecordPassengerEvent(
+          event.station,
+          event.type,
+          event.timestamp)) {
+      accepted++;
+    }
+  }
+
+  report.accepted += accepted;
+  report.rejected += last - first - accepted;
+}
+
+void PassengerEventReplay::replayPaced(
+  const TransportNetwork &network,
+  const double speed,
+  ReplayReport &report) const
+{
+  using Clock = std::chrono::steady_clock;
+
+  const auto start{Clock::now()};
+  auto now{start};
+  auto due{start};
+  PassengerTimestamp origin{};
+  for (const auto position : m_order) {
+    const auto &event{m_events[position]};
+
+    // Events without a timestamp are due along with the one before them.
+    if (event.timestamp != PassengerTimestamp{}) {
+      if (origin == PassengerTimestamp{}) {
+        origin = event.timestamp;
+      }
+
+      const std::chrono::duration<double> offset{event.timestamp - origin};
+      due = start + std::chrono::duration_cast<Clock::duration>(offset / speed);
+    }
+
+    // Everything already due goes out back to back.
+    if (due > now) {
+      now = Clock::now();
+      if (due > now) {
+        std::this_thread::sleep_until(due);
+        now = Clock::now();
+      }
+    }
+
+    if (network.RecordPassengerEvent(
+          event.station,
+          event.type,
+          event.timestamp)) {
+      report.accepted++;
+    }
+    else {
+      report.rejected++;
+    }
+  }
+}
+
+} // namespace Structures::TransportNetwork
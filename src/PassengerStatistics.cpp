@@ -0,0 +1,179 @@
+#include <TransportNetwork/PassengerStatistics.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace Structures::TransportNetwork {
+
+namespace {
+
+// Bucket layout: period tag | in count | out count.
+constexpr unsigned int kCountBits{20};
+constexpr unsigned int kTagBits{64 - 2 * kCountBits};
+constexpr std::uint64_t kCountMask{(std::uint64_t{1} << kCountBits) - 1};
+constexpr std::uint64_t kTagMask{(std::uint64_t{1} << kTagBits) - 1};
+
+auto Tag(const std::uint64_t bucket) -> std::uint64_t
+{
+  return bucket >> (2 * kCountBits);
+}
+
+auto In(const std::uint64_t bucket) -> std::uint64_t
+{
+  return (bucket >> kCountBits) & kCountMask;
+}
+
+auto Out(const std::uint64_t bucket) -> std::uint64_t
+{
+  return bucket & kCountMask;
+}
+
+auto Pack(const std::uint64_t period, std::uint64_t in, std::uint64_t out)
+  -> std::uint64_t
+{
+  return ((period & kTagMask) << (2 * kCountBits)) |
+         (std::min(in, kCountMask) << kCountBits) | std::min(out, kCountMask);
+}
+
+auto PerMinute(const std::uint64_t count) -> double
+{
+  return static_cast<double>(count) * 60.0 /
+         static_cast<double>(PassengerStatistics::kBucketWidth.count());
+}
+
+} // namespace
+
+PassengerStatistics::PassengerStatistics(const PassengerStatistics &other)
+{
+  *this = other;
+}
+
+auto PassengerStatistics::operator=(const PassengerStatistics &other)
+  -> PassengerStatistics &
+{
+  for (std::size_t i{0}; i < kBucketCount; ++i) {
+    m_buckets[i].store(
+      other.m_buckets[i].load(std::memory_order_relaxed),
+      std::memory_order_relaxed);
+  }
+
+  return *this;
+}
+
+void PassengerStatistics::Record(
+  const PassengerTimestamp timestamp,
+  const std::uint32_t in,
+  const std::uint32_t out)
+{
+  const auto period{GetPeriod(timestamp)};
+  auto &bucket{m_buckets[period % kBucketCount]};
+
+  auto value{bucket.load(std::memory_order_relaxed)};
+  std::uint64_t next{};
+  do {
+    if (value == 0) {
+      next = Pack(period, in, out);
+      continue;
+    }
+
+    // Distance from the bucket's period to the event's, modulo the tag range.
+    const auto age{(period - Tag(value)) & kTagMask};
+    if (age > kTagMask / 2) {
+      return;
+    }
+
+    next = age == 0 ? Pack(period, In(value) + in, Out(value) + out)
+                    : Pack(period, in, out);
+  } while (!bucket.compare_exchange_weak(
+    value,
+    next,
+    std::memory_order_relaxed));
+}
+
+auto PassengerStatistics::GetRates(
+  const std::chrono::seconds window,
+  const PassengerTimestamp now) const -> PassengerRates
+{
+  std::array<Counts, kBucketCount> counts;
+  const auto size{collect(window, now, counts)};
+
+  std::uint64_t in{0};
+  std::uint64_t out{0};
+  for (std::size_t i{0}; i < size; ++i) {
+    in += counts[i].in;
+    out += counts[i].out;
+  }
+
+  return PassengerRates{
+    .in = PerMinute(in) / static_cast<double>(size),
+    .out = PerMinute(out) / static_cast<double>(size)};
+}
+
+auto PassengerStatistics::GetRatePercentiles(
+  const std::chrono::seconds window,
+  const double percentile,
+  const PassengerTimestamp now) const -> PassengerRates
+{
+  assert(percentile >= 0.0 && percentile <= 100.0);
+
+  std::array<Counts, kBucketCount> counts;
+  const auto size{collect(window, now, counts)};
+
+  const auto rank{static_cast<std::size_t>(
+    std::max(std::ceil(percentile / 100.0 * static_cast<double>(size)), 1.0))};
+  const auto nth{std::min(rank, size) - 1};
+  const auto select{[&counts, size, nth](auto member) {
+    std::array<std::uint32_t, kBucketCount> values;
+    for (std::size_t i{0}; i < size; ++i) {
+      values[i] = counts[i].*member;
+    }
+
+    std::nth_element(
+      values.begin(),
+      values.begin() + static_cast<std::ptrdiff_t>(nth),
+      values.begin() + static_cast<std::ptrdiff_t>(size));
+    return PerMinute(values[nth]);
+  }};
+
+  return PassengerRates{.in = select(&Counts::in), .out = select(&Counts::out)};
+}
+
+auto PassengerStatistics::GetPeriod(const PassengerTimestamp timestamp)
+  -> std::uint64_t
+{
+  const auto time{
+    timestamp == PassengerTimestamp{} ? PassengerClock::now() : timestamp};
+  return static_cast<std::uint64_t>(
+    std::chrono::floor<std::chrono::seconds>(time.time_since_epoch()) /
+    kBucketWidth);
+}
+
+auto PassengerStatistics::collect(
+  const std::chrono::seconds window,
+  const PassengerTimestamp now,
+  std::array<Counts, kBucketCount> &counts) const -> std::size_t
+{
+  const auto buckets{(window + kBucketWidth - std::chrono::seconds{1}) /
+                     kBucketWidth};
+  const auto size{std::clamp<std::size_t>(
+    static_cast<std::size_t>(std::max<decltype(buckets)>(buckets, 0)),
+    1,
+    kBucketCount)};
+
+  const auto last{GetPeriod(now)};
+  for (std::size_t i{0}; i < size; ++i) {
+    const auto period{last - (size - 1 - i)};
+    const auto value{
+      m_buckets[period % kBucketCount].load(std::memory_order_relaxed)};
+    counts[i] = value != 0 && Tag(value) == (period & kTagMask)
+                  ? Counts{
+                      .in = static_cast<std::uint32_t>(In(value)),
+                      .out = static_cast<std::uint32_t>(Out(value))}
+                  : Counts{};
+  }
+
+  return size;
+}
+
+} // namespace Structures::TransportNetwork
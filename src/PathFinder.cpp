@@ -0,0 +1,428 @@
+#include <TransportNetwork/PathFinder.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <utility>
+
+namespace Structures::TransportNetwork {
+
+namespace {
+
+constexpr EdgeIndex kNoEdge{std::numeric_limits<EdgeIndex>::max()};
+
+// Searches for a handful of alternatives before giving up on the next one.
+constexpr std::size_t kAttemptsPerItinerary{3};
+
+// Per-thread search state, indexed by EdgeIndex. Entries are only valid when
+// their stamp matches the current generation, which avoids clearing the
+// arrays between queries. Edge penalties follow the same scheme with a
+// generation of their own, so that they outlive the searches of one query.
+struct PathScratch {
+  std::vector<unsigned int> cost{};
+  std::vector<EdgeIndex> parent{};
+  std::vector<std::uint32_t> stamp{};
+  std::vector<std::pair<unsigned int, EdgeIndex>> heap{};
+  std::uint32_t generation{0};
+
+  std::vector<unsigned int> penalty{};
+  std::vector<std::uint32_t> penaltyStamp{};
+  std::uint32_t penaltyGeneration{0};
+
+  struct StationCost {
+    std::uint32_t stamp{};
+    unsigned int cost{};
+  };
+
+  // Passengers at the stations reached so far and the cost of arriving
+  // there, indexed by StationIndex and stamped with the penalty generation,
+  // so that each station's count is read once per query at most.
+  std::vector<std::size_t> passengers{};
+  std::vector<StationCost> stationCost{};
+  Itinerary candidate{};
+
+  void Prepare(const std::size_t edgeCount)
+  {
+    if (stamp.size() < edgeCount) {
+      cost.resize(edgeCount);
+      parent.resize(edgeCount);
+      stamp.resize(edgeCount, generation);
+    }
+
+    heap.clear();
+    if (++generation == 0) {
+      std::ranges::fill(stamp, 0);
+      generation = 1;
+    }
+  }
+
+  void PreparePenalties(
+    const std::size_t edgeCount,
+    const std::size_t stationCount)
+  {
+    if (penaltyStamp.size() < edgeCount) {
+      penalty.resize(edgeCount);
+      penaltyStamp.resize(edgeCount, penaltyGeneration);
+    }
+
+    if (stationCost.size() < stationCount) {
+      passengers.resize(stationCount);
+      stationCost.resize(
+        stationCount,
+        StationCost{.stamp = penaltyGeneration});
+    }
+
+    if (++penaltyGeneration == 0) {
+      std::ranges::fill(penaltyStamp, 0);
+      std::ranges::fill(stationCost, StationCost{});
+      penaltyGeneration = 1;
+    }
+  }
+
+  [[nodiscard]] auto Cost(const EdgeIndex edge) const -> unsigned int
+  {
+    return stamp[edge] == generation ? cost[edge]
+                                     : std::numeric_limits<unsigned>::max();
+  }
+
+  [[nodiscard]] auto Penalty(const EdgeIndex edge) const -> unsigned int
+  {
+    return penaltyStamp[edge] == penaltyGeneration ? penalty[edge] : 0;
+  }
+
+  // Cost of arriving at station, reading its count on first use in the
+  // query.
+  [[nodiscard]] auto ReachStation(
+    const StationIndex station,
+    const PassengerCountFunction &passengerCount,
+    const unsigned int passengersPerMinute) -> unsigned int
+  {
+    auto &entry{stationCost[station]};
+    if (entry.stamp != penaltyGeneration) {
+      passengers[station] = passengerCount(station);
+      entry.stamp = penaltyGeneration;
+      entry.cost = passengersPerMinute == 0
+                     ? 0
+                     : static_cast<unsigned int>(
+                         passengers[station] / passengersPerMinute);
+    }
+
+    return entry.cost;
+  }
+
+  void AddPenalty(const EdgeIndex edge, const unsigned int amount)
+  {
+    penalty[edge] = Penalty(edge) + amount;
+    penaltyStamp[edge] = penaltyGeneration;
+  }
+
+  void Push(const EdgeIndex edge, const unsigned int newCost, EdgeIndex from)
+  {
+    stamp[edge] = generation;
+    cost[edge] = newCost;
+    parent[edge] = from;
+    heap.emplace_back(newCost, edge);
+    std::ranges::push_heap(heap, std::greater<>{});
+  }
+};
+
+thread_local PathScratch tScratch{};
+
+// Costs charged on top of travel times and route changes.
+struct ExtraCosts {
+  // Charged on arrival at a station, a minute per passengersPerMinute
+  // passengers there; none if null.
+  const PassengerCountFunction *pPassengerCount{};
+  unsigned int passengersPerMinute{};
+
+  // Charge the scratch's edge penalties, and add to them along the result.
+  bool edgePenalties{false};
+  unsigned int overlapPenalty{};
+};
+
+// Relaxes the edges leaving station, reached through edge from at cost.
+void PushNeighbors(
+  const TransportGraph &graph,
+  const unsigned int lineChangePenalty,
+  const ExtraCosts &extra,
+  PathScratch &scratch,
+  const StationIndex station,
+  const EdgeIndex from,
+  const unsigned int cost)
+{
+  const auto firstEdge{graph.GetFirstEdge(station)};
+  const auto neighbors{graph.GetNeighbors(station)};
+  for (EdgeIndex i{0}; i < neighbors.size(); ++i) {
+    const auto &edge{neighbors[i]};
+    auto newCost{cost + edge.travelTime};
+    if (from != kNoEdge && graph.GetEdge(from).route != edge.route) {
+      newCost += lineChangePenalty;
+    }
+
+    if (extra.pPassengerCount != nullptr) {
+      newCost += scratch.ReachStation(
+        edge.target,
+        *extra.pPassengerCount,
+        extra.passengersPerMinute);
+    }
+
+    if (extra.edgePenalties) {
+      newCost += scratch.Penalty(firstEdge + i);
+    }
+
+    if (newCost < scratch.Cost(firstEdge + i)) {
+      scratch.Push(firstEdge + i, newCost, from);
+    }
+  }
+}
+
+// Edge-based Dijkstra from start to end, start != end.
+auto Search(
+  const TransportGraph &graph,
+  const StationIndex start,
+  const StationIndex end,
+  const unsigned int lineChangePenalty,
+  const ExtraCosts &extra,
+  PathScratch &scratch,
+  Itinerary &result) -> bool
+{
+  assert(start != end);
+
+  result.steps.clear();
+  result.travelTime = 0;
+  result.totalTime = 0;
+
+  scratch.Prepare(graph.GetEdgeCount());
+  PushNeighbors(graph, lineChangePenalty, extra, scratch, start, kNoEdge, 0);
+
+  EdgeIndex last{kNoEdge};
+  while (!scratch.heap.empty()) {
+    std::ranges::pop_heap(scratch.heap, std::greater<>{});
+    const auto [cost, edge]{scratch.heap.back()};
+    scratch.heap.pop_back();
+
+    if (cost != scratch.cost[edge]) {
+      continue;
+    }
+
+    const auto station{graph.GetEdge(edge).target};
+    if (station == end) {
+      last = edge;
+      break;
+    }
+
+    PushNeighbors(
+      graph,
+      lineChangePenalty,
+      extra,
+      scratch,
+      station,
+      edge,
+      cost);
+  }
+
+  if (last == kNoEdge) {
+    return false;
+  }
+
+  unsigned int changes{0};
+  for (auto edge{last}; edge != kNoEdge; edge = scratch.parent[edge]) {
+    const auto &graphEdge{graph.GetEdge(edge)};
+    const auto parent{scratch.parent[edge]};
+    if (parent != kNoEdge && graph.GetEdge(parent).route != graphEdge.route) {
+      changes++;
+    }
+
+    if (extra.edgePenalties) {
+      scratch.AddPenalty(
+        edge,
+        (graphEdge.travelTime + 1) * extra.overlapPenalty / 100);
+    }
+
+    result.steps.push_back(
+      ItineraryStep{.station = graphEdge.target, .route = graphEdge.route});
+    result.travelTime += graphEdge.travelTime;
+  }
+
+  result.steps.push_back(ItineraryStep{.station = start});
+  std::ranges::reverse(result.steps);
+  result.totalTime = result.travelTime + changes * lineChangePenalty;
+  return true;
+}
+
+} // namespace
+
+auto FindFastestPath(
+  const TransportGraph &graph,
+  const StationIndex start,
+  const StationIndex end,
+  const ItineraryOptions &options,
+  Itinerary &result) -> bool
+{
+  result.steps.clear();
+  result.travelTime = 0;
+  result.totalTime = 0;
+
+  const auto stationCount{graph.GetStationCount()};
+  if (start >= stationCount || end >= stationCount) {
+    return false;
+  }
+
+  if (start == end) {
+    result.steps.push_back(ItineraryStep{.station = start});
+    return true;
+  }
+
+  return Search(
+    graph,
+    start,
+    end,
+    options.lineChangePenalty,
+    ExtraCosts{},
+    tScratch,
+    result);
+}
+
+void FindTravelTimes(
+  const TransportGraph &graph,
+  const StationIndex start,
+  const ItineraryOptions &options,
+  const std::span<unsigned int> times)
+{
+  assert(times.size() >= graph.GetStationCount());
+
+  std::ranges::fill(times, kUnreachableTime);
+  if (start >= graph.GetStationCount()) {
+    return;
+  }
+
+  times[start] = 0;
+
+  auto &scratch{tScratch};
+  scratch.Prepare(graph.GetEdgeCount());
+  PushNeighbors(
+    graph,
+    options.lineChangePenalty,
+    ExtraCosts{},
+    scratch,
+    start,
+    kNoEdge,
+    0);
+
+  // Edges are settled in order of cost, so the first edge settled into a
+  // station carries its time.
+  while (!scratch.heap.empty()) {
+    std::ranges::pop_heap(scratch.heap, std::greater<>{});
+    const auto [cost, edge]{scratch.heap.back()};
+    scratch.heap.pop_back();
+
+    if (cost != scratch.cost[edge]) {
+      continue;
+    }
+
+    const auto station{graph.GetEdge(edge).target};
+    times[station] = std::min(times[station], cost);
+    PushNeighbors(
+      graph,
+      options.lineChangePenalty,
+      ExtraCosts{},
+      scratch,
+      station,
+      edge,
+      cost);
+  }
+}
+
+auto FindQuietItineraries(
+  const TransportGraph &graph,
+  const StationIndex start,
+  const StationIndex end,
+  const std::size_t count,
+  const QuietItineraryOptions &options,
+  const PassengerCountFunction &passengerCount,
+  std::vector<QuietItinerary> &results) -> bool
+{
+  const auto stationCount{graph.GetStationCount()};
+
+  if (start >= stationCount || end >= stationCount || count == 0) {
+    results.clear();
+    return false;
+  }
+
+  if (start == end) {
+    results.resize(1);
+    auto &result{results.front()};
+    result.itinerary.steps.assign(1, ItineraryStep{.station = start});
+    result.itinerary.travelTime = 0;
+    result.itinerary.totalTime = 0;
+    result.crowding = 0;
+    result.score = 0;
+    return true;
+  }
+
+  auto &scratch{tScratch};
+  scratch.PreparePenalties(graph.GetEdgeCount(), stationCount);
+
+  const ExtraCosts extra{
+    .pPassengerCount =
+      options.passengersPerMinute == 0 ? nullptr : &passengerCount,
+    .passengersPerMinute = options.passengersPerMinute,
+    .edgePenalties = true,
+    .overlapPenalty = options.overlapPenalty};
+
+  std::size_t found{0};
+  auto &candidate{scratch.candidate};
+  for (std::size_t attempt{0};
+       found < count && attempt < count * kAttemptsPerItinerary;
+       ++attempt) {
+    if (!Search(
+          graph,
+          start,
+          end,
+          options.lineChangePenalty,
+          extra,
+          scratch,
+          candidate)) {
+      break;
+    }
+
+    const auto duplicate{std::any_of(
+      results.begin(),
+      results.begin() + static_cast<std::ptrdiff_t>(found),
+      [&candidate](const QuietItinerary &result) {
+        return result.itinerary.steps == candidate.steps;
+      })};
+    if (duplicate) {
+      continue;
+    }
+
+    if (found == results.size()) {
+      results.emplace_back();
+    }
+
+    auto &result{results[found++]};
+    result.itinerary.steps.assign(
+      candidate.steps.begin(),
+      candidate.steps.end());
+    result.itinerary.travelTime = candidate.travelTime;
+    result.itinerary.totalTime = candidate.totalTime;
+    result.crowding = 0;
+    result.score = candidate.totalTime;
+    for (std::size_t i{1}; i < candidate.steps.size(); ++i) {
+      const auto station{candidate.steps[i].station};
+      result.score += scratch.ReachStation(
+        station,
+        passengerCount,
+        options.passengersPerMinute);
+      result.crowding += scratch.passengers[station];
+    }
+  }
+
+  results.resize(found);
+  std::ranges::stable_sort(results, {}, &QuietItinerary::score);
+  return found != 0;
+}
+
+} // namespace Structures::TransportNetwork
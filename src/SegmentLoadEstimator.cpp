@@ -0,0 +1,209 @@
+#include <TransportNetwork/SegmentLoadEstimator.h>
+
+#include <algorithm>
+#include <cassert>
+#include <utility>
+
+namespace Structures::TransportNetwork {
+
+namespace {
+
+// Bucket layout: period tag | net flow, in two's complement.
+constexpr unsigned int kFlowBits{40};
+constexpr unsigned int kTagBits{64 - kFlowBits};
+constexpr std::uint64_t kFlowMask{(std::uint64_t{1} << kFlowBits) - 1};
+constexpr std::uint64_t kTagMask{(std::uint64_t{1} << kTagBits) - 1};
+constexpr std::int64_t kMaxFlow{(std::int64_t{1} << (kFlowBits - 1)) - 1};
+
+auto Tag(const std::uint64_t bucket) -> std::uint64_t
+{
+  return bucket >> kFlowBits;
+}
+
+auto Flow(const std::uint64_t bucket) -> std::int64_t
+{
+  return static_cast<std::int64_t>(bucket << kTagBits) >> kTagBits;
+}
+
+auto Pack(const std::uint64_t period, const std::int64_t flow)
+  -> std::uint64_t
+{
+  return ((period & kTagMask) << kFlowBits) |
+         (static_cast<std::uint64_t>(std::clamp(flow, -kMaxFlow, kMaxFlow)) &
+          kFlowMask);
+}
+
+} // namespace
+
+SegmentLoadEstimator::SegmentLoadEstimator(
+  std::shared_ptr<const TransportGraph> pGraph)
+    : m_pGraph(std::move(pGraph)),
+      m_netFlows(m_pGraph->GetStopCount())
+{
+}
+
+void SegmentLoadEstimator::Record(
+  const StationIndex station,
+  const PassengerTimestamp timestamp,
+  const std::uint32_t in,
+  const std::uint32_t out)
+{
+  if (station >= m_pGraph->GetStationCount()) {
+    return;
+  }
+
+  const auto period{PassengerStatistics::GetPeriod(timestamp)};
+  if (in != 0) {
+    distribute(station, period, in, true);
+  }
+
+  if (out != 0) {
+    distribute(station, period, out, false);
+  }
+}
+
+auto SegmentLoadEstimator::GetLoad(
+  const RouteIndex route,
+  const StopPosition position,
+  const std::chrono::seconds window,
+  const PassengerTimestamp now) const -> double
+{
+  if (route >= m_pGraph->GetRouteCount() ||
+      position + 1 >= m_pGraph->GetRouteStops(route).size()) {
+    return 0.0;
+  }
+
+  const auto periods{getPeriods(window, now)};
+  const auto first{m_pGraph->GetFirstStop(route)};
+  std::int64_t load{0};
+  for (std::uint32_t i{first}; i <= first + position; ++i) {
+    load += netFlow(i, periods);
+  }
+
+  return static_cast<double>(std::max<std::int64_t>(load, 0)) / kPassenger;
+}
+
+auto SegmentLoadEstimator::GetMostCrowdedSegments(
+  const std::size_t count,
+  const std::chrono::seconds window,
+  const PassengerTimestamp now) const -> std::vector<SegmentLoad>
+{
+  const auto periods{getPeriods(window, now)};
+  std::vector<SegmentLoad> segments;
+  for (RouteIndex route{0}; route < m_pGraph->GetRouteCount(); ++route) {
+    const auto first{m_pGraph->GetFirstStop(route)};
+    const auto size{m_pGraph->GetRouteStops(route).size()};
+
+    std::int64_t load{0};
+    for (StopPosition position{0}; position + 1 < size; ++position) {
+      load += netFlow(first + position, periods);
+      if (load > 0) {
+        segments.push_back(SegmentLoad{
+          .route = route,
+          .position = position,
+          .load = static_cast<double>(load) / kPassenger});
+      }
+    }
+  }
+
+  const auto top{std::min(count, segments.size())};
+  std::ranges::partial_sort(
+    segments,
+    segments.begin() + static_cast<std::ptrdiff_t>(top),
+    std::ranges::greater{},
+    &SegmentLoad::load);
+  segments.resize(top);
+
+  return segments;
+}
+
+auto SegmentLoadEstimator::GetMemoryUsage() const -> std::size_t
+{
+  return m_netFlows.GetMemoryUsage();
+}
+
+auto SegmentLoadEstimator::getPeriods(
+  const std::chrono::seconds window,
+  const PassengerTimestamp now) -> Periods
+{
+  const auto buckets{(window + kBucketWidth - std::chrono::seconds{1}) /
+                     kBucketWidth};
+  const auto size{std::clamp<std::size_t>(
+    static_cast<std::size_t>(std::max<decltype(buckets)>(buckets, 0)),
+    1,
+    kBucketCount)};
+
+  return Periods{
+    .first = PassengerStatistics::GetPeriod(now) - (size - 1),
+    .size = size};
+}
+
+void SegmentLoadEstimator::distribute(
+  const StationIndex station,
+  const std::uint64_t period,
+  const std::int64_t passengers,
+  const bool in)
+{
+  // Passengers board routes that go on from the station and alight from
+  // routes that arrive at it.
+  const auto stops{m_pGraph->GetStationStops(station)};
+  const auto eligible{[this, in](const RouteStop &stop) {
+    return in ? stop.position + 1 < m_pGraph->GetRouteStops(stop.route).size()
+              : stop.position > 0;
+  }};
+
+  const auto routes{std::ranges::count_if(stops, eligible)};
+  if (routes == 0) {
+    return;
+  }
+
+  const auto share{(in ? 1 : -1) * passengers * kPassenger / routes};
+  for (const auto &stop : stops) {
+    if (!eligible(stop)) {
+      continue;
+    }
+
+    auto &ring{
+      m_netFlows.Get(m_pGraph->GetFirstStop(stop.route) + stop.position)};
+    auto &bucket{ring[period % kBucketCount]};
+    auto value{bucket.load(std::memory_order_relaxed)};
+    std::uint64_t next{};
+    do {
+      // Distance from the bucket's period to the event's, modulo the tag
+      // range; events older than the bucket are dropped.
+      const auto age{(period - Tag(value)) & kTagMask};
+      if (value != 0 && age > kTagMask / 2) {
+        break;
+      }
+
+      next = Pack(period, (value != 0 && age == 0 ? Flow(value) : 0) + share);
+    } while (!bucket.compare_exchange_weak(
+      value,
+      next,
+      std::memory_order_relaxed));
+  }
+}
+
+auto SegmentLoadEstimator::netFlow(
+  const std::uint32_t stop,
+  const Periods periods) const -> std::int64_t
+{
+  const auto *pRing{m_netFlows.Find(stop)};
+  if (pRing == nullptr) {
+    return 0;
+  }
+
+  std::int64_t flow{0};
+  for (auto period{periods.first}; period < periods.first + periods.size;
+       ++period) {
+    const auto value{
+      (*pRing)[period % kBucketCount].load(std::memory_order_relaxed)};
+    if (value != 0 && Tag(value) == (period & kTagMask)) {
+      flow += Flow(value);
+    }
+  }
+
+  return flow;
+}
+
+} // namespace Structures::TransportNetwork
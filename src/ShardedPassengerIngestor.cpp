@@ -0,0 +1,234 @@
+#include <TransportNetwork/ShardedPassengerIngestor.h>
+
+#include <algorithm>
+#include <cassert>
+
+namespace Structures::TransportNetwork {
+
+ShardedPassengerIngestor::Shard::Shard(const std::size_t queueCapacity)
+    : queue(queueCapacity)
+{
+}
+
+ShardedPassengerIngestor::ShardedPassengerIngestor(
+  const TransportNetwork &network,
+  const std::size_t shardCount,
+  const std::size_t queueCapacity)
+    : m_network(network)
+{
+  const auto shards{std::max<std::size_t>(shardCount, 1)};
+  m_shards.reserve(shards);
+  for (std::size_t i{0}; i < shards; ++i) {
+    m_shards.push_back(std::make_unique<Shard>(queueCapacity));
+  }
+
+  m_workers.reserve(shards);
+  for (auto &pShard : m_shards) {
+    m_workers.emplace_back(
+      [this, &shard = *pShard](const std::stop_token &stopToken) {
+        work(shard, stopToken);
+      });
+  }
+}
+
+ShardedPassengerIngestor::~ShardedPassengerIngestor()
+{
+  Drain();
+
+  // A worker only wakes up once the count it waits on changes.
+  for (std::size_t i{0}; i < m_shards.size(); ++i) {
+    m_workers[i].request_stop();
+    m_shards[i]->tickets.fetch_add(1);
+    m_shards[i]->tickets.notify_one();
+  }
+}
+
+auto ShardedPassengerIngestor::GetShardCount() const -> std::size_t
+{
+  return m_shards.size();
+}
+
+auto ShardedPassengerIngestor::GetShard(const StationIndex station) const
+  -> std::size_t
+{
+  // Dense indices of neighbouring stations would otherwise fill the shards
+  // in turn with stations of the same lines.
+  const auto hash{
+    (static_cast<std::uint64_t>(station) * 0x9E3779B97F4A7C15ULL) >> 32};
+  return hash % m_shards.size();
+}
+
+auto ShardedPassengerIngestor::Record(const PassengerEvent &event) -> bool
+{
+  return Record(
+    m_network.GetStationIndex(event.m_stationId),
+    event.m_type,
+    event.m_timestamp);
+}
+
+auto ShardedPassengerIngestor::Record(
+  const StationIndex station,
+  const PassengerEvent::Type type,
+  const PassengerTimestamp timestamp) -> bool
+{
+  QueuedEvent event{};
+  if (!resolve(station, type, timestamp, event)) {
+    return false;
+  }
+
+  push(*m_shards[GetShard(station)], std::span{&event, 1});
+  return true;
+}
+
+auto ShardedPassengerIngestor::Record(
+  const std::span<const PassengerEvent> events) -> std::size_t
+{
+  // Events of the batch grouped by shard, reused across calls on the same
+  // thread, so that each shard is ticketed and woken once per batch.
+  thread_local std::vector<std::vector<QueuedEvent>> tShardEvents;
+  tShardEvents.resize(std::max(tShardEvents.size(), m_shards.size()));
+
+  std::size_t queued{0};
+  for (const auto &event : events) {
+    const auto station{m_network.GetStationIndex(event.m_stationId)};
+    QueuedEvent resolved{};
+    if (resolve(station, event.m_type, event.m_timestamp, resolved)) {
+      tShardEvents[GetShard(station)].push_back(resolved);
+      queued++;
+    }
+  }
+
+  for (std::size_t i{0}; i < m_shards.size(); ++i) {
+    if (!tShardEvents[i].empty()) {
+      push(*m_shards[i], tShardEvents[i]);
+      tShardEvents[i].clear();
+    }
+  }
+
+  return queued;
+}
+
+void ShardedPassengerIngestor::Drain()
+{
+  // Every event queued before the call holds a ticket below the snapshot,
+  // and so does every event ahead of it in the queue, so once as many
+  // events have been applied the queued ones are among them.
+  for (const auto &pShard : m_shards) {
+    const auto tickets{pShard->tickets.load()};
+    for (auto applied{pShard->applied.load(std::memory_order_acquire)};
+         applied < tickets;
+         applied = pShard->applied.load(std::memory_order_acquire)) {
+      pShard->applied.wait(applied, std::memory_order_acquire);
+    }
+  }
+}
+
+auto ShardedPassengerIngestor::GetPassengerCount(
+  const StationIndex station) const -> std::size_t
+{
+  return m_network.GetPassengerCount(station);
+}
+
+auto ShardedPassengerIngestor::GetStats() const -> IngestionStats
+{
+  IngestionStats stats{};
+  for (const auto &pShard : m_shards) {
+    stats.accepted += pShard->accepted.load(std::memory_order_relaxed);
+    stats.rejected += pShard->rejected.load(std::memory_order_relaxed);
+  }
+
+  return stats;
+}
+
+auto ShardedPassengerIngestor::resolve(
+  const StationIndex station,
+  const PassengerEvent::Type type,
+  const PassengerTimestamp timestamp,
+  QueuedEvent &event) const -> bool
+{
+  if (m_network.FindStation(station) == nullptr ||
+      (type != PassengerEvent::Type::kIn &&
+       type != PassengerEvent::Type::kOut)) {
+    return false;
+  }
+
+  event = QueuedEvent{
+    .station = station,
+    .type = type,
+    .timestamp =
+      timestamp == PassengerTimestamp{} ? PassengerClock::now() : timestamp};
+  return true;
+}
+
+void ShardedPassengerIngestor::push(
+  Shard &shard,
+  const std::span<const QueuedEvent> events)
+{
+  // Ticketed before pushing, so that Drain() never waits for fewer events
+  // than the queue holds ahead of its own.
+  shard.tickets.fetch_add(events.size());
+
+  // Only a worker that has gone to sleep needs waking up, and it rereads
+  // the tickets after saying so. Woken before pushing, as the events may not
+  // fit the queue until it drains.
+  if (shard.sleeping.load()) {
+    shard.tickets.notify_one();
+  }
+
+  for (const auto &event : events) {
+    while (!shard.queue.bounded_push(event)) {
+      std::this_thread::yield();
+    }
+  }
+}
+
+void ShardedPassengerIngestor::work(
+  Shard &shard,
+  const std::stop_token &stopToken)
+{
+  std::uint64_t applied{0};
+  std::size_t accepted{0};
+  std::size_t rejected{0};
+  const auto apply{[this, &accepted, &rejected](const QueuedEvent &event) {
+    if (m_network.RecordPassengerEvent(
+          event.station,
+          event.type,
+          event.timestamp)) {
+      accepted++;
+    }
+    else {
+      rejected++;
+    }
+  }};
+
+  while (true) {
+    const auto count{shard.queue.consume_all(apply)};
+    if (count != 0) {
+      applied += count;
+      shard.accepted.store(accepted, std::memory_order_relaxed);
+      shard.rejected.store(rejected, std::memory_order_relaxed);
+      shard.applied.store(applied, std::memory_order_release);
+      shard.applied.notify_all();
+      continue;
+    }
+
+    if (stopToken.stop_requested()) {
+      return;
+    }
+
+    if (applied < shard.tickets.load()) {
+      // A producer holds a ticket and is about to push.
+      std::this_thread::yield();
+      continue;
+    }
+
+    shard.sleeping.store(true);
+    if (const auto tickets{shard.tickets.load()}; tickets == applied) {
+      shard.tickets.wait(tickets);
+    }
+
+    shard.sleeping.store(false);
+  }
+}
+
+} // namespace Structures::TransportNetwork
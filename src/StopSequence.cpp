@@ -0,0 +1,154 @@
+#include <TransportNetwork/MemoryUsage.h>
+#include <TransportNetwork/StopSequence.h>
+
+#include <algorithm>
+#include <cassert>
+#include <utility>
+
+#include <boost/container_hash/hash.hpp>
+
+namespace Structures::TransportNetwork {
+
+StopSequence::StopSequence(const std::initializer_list<StationId> stops)
+    : StopSequence(Stops(stops))
+{
+}
+
+StopSequence::StopSequence(Stops stops)
+    : m_pStops(
+        stops.empty() ? nullptr
+                      : std::make_shared<const Stops>(std::move(stops)))
+{
+}
+
+StopSequence::StopSequence(
+  std::shared_ptr<const Stops> pStops,
+  const bool reversed)
+    : m_pStops(std::move(pStops)),
+      m_reversed(reversed)
+{
+}
+
+auto StopSequence::size() const -> std::size_t
+{
+  return m_pStops ? m_pStops->size() : 0;
+}
+
+auto StopSequence::empty() const -> bool
+{
+  return size() == 0;
+}
+
+auto StopSequence::begin() const -> Iterator
+{
+  return {this, 0};
+}
+
+auto StopSequence::end() const -> Iterator
+{
+  return {this, static_cast<Iterator::difference_type>(size())};
+}
+
+auto StopSequence::front() const -> const StationId &
+{
+  return (*this)[0];
+}
+
+auto StopSequence::back() const -> const StationId &
+{
+  return (*this)[size() - 1];
+}
+
+auto StopSequence::operator[](const std::size_t position) const
+  -> const StationId &
+{
+  assert(position < size());
+
+  return (*m_pStops)[m_reversed ? m_pStops->size() - 1 - position : position];
+}
+
+auto StopSequence::Reversed() const -> StopSequence
+{
+  return {m_pStops, !m_reversed};
+}
+
+auto StopSequence::IsReversed() const -> bool
+{
+  return m_reversed;
+}
+
+auto StopSequence::SharesStopsWith(const StopSequence &other) const -> bool
+{
+  return m_pStops != nullptr && m_pStops == other.m_pStops;
+}
+
+auto StopSequence::GetStops() const -> const std::shared_ptr<const Stops> &
+{
+  return m_pStops;
+}
+
+auto StopSequence::GetMemoryUsage() const -> std::size_t
+{
+  if (!m_pStops) {
+    return 0;
+  }
+
+  auto bytes{SharedBytes(m_pStops) + HeapBytes(*m_pStops)};
+  for (const auto &stop : *m_pStops) {
+    bytes += HeapBytes(stop);
+  }
+
+  return bytes;
+}
+
+auto StopSequence::operator==(const StopSequence &other) const -> bool
+{
+  if (m_pStops == other.m_pStops && m_reversed == other.m_reversed) {
+    return true;
+  }
+
+  return std::ranges::equal(*this, other);
+}
+
+auto StopSequencePool::Intern(StopSequence::Stops stops) -> StopSequence
+{
+  if (stops.empty()) {
+    return {};
+  }
+
+  // Arrays are kept in whichever direction sorts first, so that a sequence
+  // and its reverse find the same one.
+  const auto reversed{std::ranges::lexicographical_compare(
+    stops.rbegin(),
+    stops.rend(),
+    stops.begin(),
+    stops.end())};
+  if (reversed) {
+    std::ranges::reverse(stops);
+  }
+
+  const auto [it, inserted]{m_sequences.insert(
+    std::make_shared<const StopSequence::Stops>(std::move(stops)))};
+  return {*it, reversed};
+}
+
+auto StopSequencePool::GetSequenceCount() const -> std::size_t
+{
+  return m_sequences.size();
+}
+
+auto StopSequencePool::StopsHash::operator()(
+  const std::shared_ptr<const StopSequence::Stops> &pStops) const
+  -> std::size_t
+{
+  return boost::hash_range(pStops->begin(), pStops->end());
+}
+
+auto StopSequencePool::StopsEqual::operator()(
+  const std::shared_ptr<const StopSequence::Stops> &lhs,
+  const std::shared_ptr<const StopSequence::Stops> &rhs) const -> bool
+{
+  return *lhs == *rhs;
+}
+
+} // namespace Structures::TransportNetwork
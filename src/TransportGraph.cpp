@@ -0,0 +1,214 @@
+#include <TransportNetwork/MemoryUsage.h>
+#include <TransportNetwork/TransportGraph.h>
+
+#include <algorithm>
+#include <cassert>
+
+namespace Structures::TransportNetwork {
+
+TransportGraph::TransportGraph(
+  const std::size_t stationCount,
+  const std::span<const GraphRoute> routes)
+    : m_edgeOffsets(stationCount + 1, 0),
+      m_stationStopOffsets(stationCount + 1, 0)
+{
+  std::size_t stopCount{0};
+  for (const auto &route : routes) {
+    assert(
+      route.stops.empty() ||
+      route.travelTimes.size() + 1 == route.stops.size());
+
+    stopCount += route.stops.size();
+    for (std::size_t i{0}; i < route.stops.size(); ++i) {
+      assert(route.stops[i] < stationCount);
+
+      m_stationStopOffsets[route.stops[i] + 1]++;
+      if (i + 1 < route.stops.size()) {
+        m_edgeOffsets[route.stops[i] + 1]++;
+      }
+    }
+  }
+
+  // Counting sort of edges and stops by their station.
+  for (std::size_t i{1}; i <= stationCount; ++i) {
+    m_edgeOffsets[i] += m_edgeOffsets[i - 1];
+    m_stationStopOffsets[i] += m_stationStopOffsets[i - 1];
+  }
+
+  m_edges.resize(m_edgeOffsets.back());
+  m_stationStops.resize(m_stationStopOffsets.back());
+  m_routeOffsets.reserve(routes.size() + 1);
+  m_routeStops.reserve(stopCount);
+  m_cumulativeTimes.reserve(stopCount);
+
+  std::vector<EdgeIndex> edgeCursors(
+    m_edgeOffsets.begin(),
+    m_edgeOffsets.end() - 1);
+  std::vector<std::uint32_t> stopCursors(
+    m_stationStopOffsets.begin(),
+    m_stationStopOffsets.end() - 1);
+  for (RouteIndex index{0}; index < routes.size(); ++index) {
+    const auto &route{routes[index]};
+
+    unsigned int cumulativeTime{0};
+    for (StopPosition i{0}; i < route.stops.size(); ++i) {
+      const auto station{route.stops[i]};
+      m_routeStops.push_back(station);
+      m_cumulativeTimes.push_back(cumulativeTime);
+      m_stationStops[stopCursors[station]++] =
+        RouteStop{.route = index, .position = i};
+
+      if (i + 1 < route.stops.size()) {
+        m_edges[edgeCursors[station]++] = GraphEdge{
+          .target = route.stops[i + 1],
+          .travelTime = route.travelTimes[i],
+          .line = route.line,
+          .route = index};
+        cumulativeTime += route.travelTimes[i];
+      }
+    }
+
+    m_routeOffsets.push_back(
+      static_cast<std::uint32_t>(m_routeStops.size()));
+  }
+}
+
+auto TransportGraph::GetStationCount() const -> std::size_t
+{
+  return m_edgeOffsets.size() - 1;
+}
+
+auto TransportGraph::GetEdgeCount() const -> std::size_t
+{
+  return m_edges.size();
+}
+
+auto TransportGraph::GetRouteCount() const -> std::size_t
+{
+  return m_routeOffsets.size() - 1;
+}
+
+auto TransportGraph::GetNeighbors(const StationIndex station) const
+  -> std::span<const GraphEdge>
+{
+  assert(station < GetStationCount());
+
+  return {
+    m_edges.data() + m_edgeOffsets[station],
+    m_edges.data() + m_edgeOffsets[station + 1]};
+}
+
+auto TransportGraph::GetFirstEdge(const StationIndex station) const
+  -> EdgeIndex
+{
+  assert(station < GetStationCount());
+
+  return m_edgeOffsets[station];
+}
+
+auto TransportGraph::GetEdge(const EdgeIndex edge) const -> const GraphEdge &
+{
+  assert(edge < m_edges.size());
+
+  return m_edges[edge];
+}
+
+auto TransportGraph::GetRouteStops(const RouteIndex route) const
+  -> std::span<const StationIndex>
+{
+  assert(route < GetRouteCount());
+
+  return {
+    m_routeStops.data() + m_routeOffsets[route],
+    m_routeStops.data() + m_routeOffsets[route + 1]};
+}
+
+auto TransportGraph::GetStopCount() const -> std::size_t
+{
+  return m_routeStops.size();
+}
+
+auto TransportGraph::GetFirstStop(const RouteIndex route) const
+  -> std::uint32_t
+{
+  assert(route < GetRouteCount());
+
+  return m_routeOffsets[route];
+}
+
+auto TransportGraph::GetStationStops(const StationIndex station) const
+  -> std::span<const RouteStop>
+{
+  assert(station < GetStationCount());
+
+  return {
+    m_stationStops.data() + m_stationStopOffsets[station],
+    m_stationStops.data() + m_stationStopOffsets[station + 1]};
+}
+
+auto TransportGraph::GetStopPosition(
+  const RouteIndex route,
+  const StationIndex station,
+  const StopPosition after) const -> StopPosition
+{
+  if (station >= GetStationCount()) {
+    return kInvalidId;
+  }
+
+  // Station stops are sorted by route, then position.
+  const auto stops{GetStationStops(station)};
+  const auto it{std::ranges::lower_bound(
+    stops,
+    RouteStop{.route = route, .position = after},
+    [](const RouteStop &lhs, const RouteStop &rhs) {
+      return lhs.route != rhs.route ? lhs.route < rhs.route
+                                    : lhs.position < rhs.position;
+    })};
+
+  return (it != stops.end() && it->route == route ? it->position : kInvalidId);
+}
+
+auto TransportGraph::GetSegmentTravelTime(
+  const RouteIndex route,
+  const StopPosition from,
+  const StopPosition to) const -> unsigned int
+{
+  assert(route < GetRouteCount());
+  assert(from <= to);
+  assert(m_routeOffsets[route] + to < m_routeOffsets[route + 1]);
+
+  const auto *pTimes{m_cumulativeTimes.data() + m_routeOffsets[route]};
+  return pTimes[to] - pTimes[from];
+}
+
+auto TransportGraph::GetRouteTravelTime(
+  const RouteIndex route,
+  const StationIndex start,
+  const StationIndex end) const -> unsigned int
+{
+  if (route >= GetRouteCount()) {
+    return 0;
+  }
+
+  const auto from{GetStopPosition(route, start)};
+  if (from == kInvalidId) {
+    return 0;
+  }
+
+  const auto to{GetStopPosition(route, end, from)};
+  if (to == kInvalidId) {
+    return 0;
+  }
+
+  return GetSegmentTravelTime(route, from, to);
+}
+
+auto TransportGraph::GetMemoryUsage() const -> std::size_t
+{
+  return HeapBytes(m_edgeOffsets) + HeapBytes(m_edges) +
+         HeapBytes(m_routeOffsets) + HeapBytes(m_routeStops) +
+         HeapBytes(m_cumulativeTimes) + HeapBytes(m_stationStopOffsets) +
+         HeapBytes(m_stationStops);
+}
+
+} // namespace Structures::TransportNetwork
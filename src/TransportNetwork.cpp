@@ -1,11 +1,19 @@
+#include <TransportNetwork/MemoryUsage.h>
+#include <TransportNetwork/NetworkLayout.h>
 #include <TransportNetwork/TransportNetwork.h>
 
+#include <algorithm>
+#include <cstdint>
 #include <bits/ranges_algobase.h>
 #include <bits/ranges_util.h>
+#include <limits>
 #include <memory>
 #include <numbers>
 #include <ranges>
 #include <stdexcept>
+#include <string_view>
+#include <unordered_set>
+#include <utility>
 
 namespace Structures::TransportNetwork {
 
@@ -31,16 +39,23 @@ Station::Station(StationId id, StationName name, std::size_t passengerCount)
 
 auto Station::RecordPassengerEvent(const PassengerEvent &event) -> bool
 {
-  switch (event.m_type) {
+  return RecordPassengerEvent(event.m_type, event.m_timestamp);
+}
+
+auto Station::RecordPassengerEvent(
+  const PassengerEvent::Type type,
+  const PassengerTimestamp timestamp) -> bool
+{
+  switch (type) {
     case PassengerEvent::Type::kIn:
-      m_passengerCount++;
+      m_passengerCount.Increment();
+      m_passengerStatistics.Record(timestamp, 1, 0);
       break;
     case PassengerEvent::Type::kOut:
-      if (m_passengerCount == 0) {
+      if (!m_passengerCount.TryDecrement()) {
         return false;
       }
-
-      m_passengerCount--;
+      m_passengerStatistics.Record(timestamp, 0, 1);
       break;
     default:
       return false;
@@ -51,7 +66,20 @@ auto Station::RecordPassengerEvent(const PassengerEvent &event) -> bool
 
 auto Station::GetPassengerCount() const -> std::size_t
 {
-  return m_passengerCount;
+  return m_passengerCount.Get();
+}
+
+auto Station::GetPassengerStatistics() const -> const PassengerStatistics &
+{
+  return m_passengerStatistics;
+}
+
+void Station::RecordPassengerStatistics(
+  const PassengerTimestamp timestamp,
+  const std::uint32_t in,
+  const std::uint32_t out)
+{
+  m_passengerStatistics.Record(timestamp, in, out);
 }
 
 auto Station::AddRoute(std::shared_ptr<Route> pRoute) -> bool
@@ -74,6 +102,12 @@ auto Station::GetRoutes() const -> std::vector<std::shared_ptr<Route>>
   return m_routes;
 }
 
+auto Station::GetRoutesView() const
+  -> std::span<const std::shared_ptr<Route>>
+{
+  return m_routes;
+}
+
 auto Line::operator==(const Line &line) const -> bool
 {
   return id == line.id && name == line.name && routes == line.routes;
@@ -84,17 +118,105 @@ auto Line::operator!=(const Line &line) const -> bool
   return !(*this == line);
 }
 
+namespace {
+
+auto SameLine(const Line &lhs, const Line &rhs) -> bool
+{
+  return lhs.name == rhs.name &&
+         std::ranges::equal(lhs.routes, rhs.routes, [](auto lhs, auto rhs) {
+           return *lhs == *rhs;
+         });
+}
+
+auto TravelTimeKey(const StationIndex start, const StationIndex end)
+  -> std::uint64_t
+{
+  return (static_cast<std::uint64_t>(start) << 32U) | end;
+}
+
+} // namespace
+
+auto LayoutDiff::Empty() const -> bool
+{
+  return addedStations == 0 && removedStations == 0 && modifiedStations == 0 &&
+         addedLines == 0 && removedLines == 0 && modifiedLines == 0 &&
+         addedTravelTimes == 0 && removedTravelTimes == 0 &&
+         modifiedTravelTimes == 0;
+}
+
+auto NetworkMemoryUsage::Total() const -> std::size_t
+{
+  return ids + stations + stationRoutes + lines + routes + passengerEvents +
+         travelTimes + graph + segmentLoads + travelTimeMatrix +
+         itineraryCache + forkedPassengerCounts;
+}
+
+TransportNetwork::TransportNetwork()
+    : TransportNetwork(nullptr)
+{
+}
+
+TransportNetwork::TransportNetwork(
+  std::shared_ptr<std::pmr::memory_resource> pMemoryResource)
+    : m_pMemoryResource(
+        pMemoryResource ? std::move(pMemoryResource)
+                        : std::make_shared<NetworkArena>()),
+      m_lineIds(IdInterner{allocator<std::byte>()}),
+      m_routeIds(IdInterner{allocator<std::byte>()}),
+      m_stationIds(IdInterner{allocator<std::byte>()}),
+      m_travelTimes(
+        TravelTimes{TravelTimes::ctor_args_list{}, allocator<TravelTime>()})
+{
+}
+
+auto TransportNetwork::Fork(
+  std::shared_ptr<std::pmr::memory_resource> pMemoryResource) const
+  -> TransportNetwork
+{
+  TransportNetwork fork{*this};
+  fork.m_pMemoryResource = pMemoryResource
+                             ? std::move(pMemoryResource)
+                             : std::make_shared<NetworkArena>();
+  fork.m_pForks = std::make_shared<ForkRegistry>();
+  fork.m_passengerCounts = std::make_shared<ForkedPassengerCounts>(
+    m_stations,
+    m_passengerCounts,
+    fork.m_pForks);
+  m_pForks->Register(fork.m_passengerCounts);
+  fork.m_segmentLoads =
+    m_graph ? std::make_shared<SegmentLoadEstimator>(m_graph) : nullptr;
+
+  return fork;
+}
+
 auto TransportNetwork::AddStation(Station station) -> bool
 {
   assert(!station.m_id.empty());
   assert(!station.m_name.empty());
 
-  auto stationId{station.m_id};
-  auto res{m_stations.emplace(
-    std::move(stationId),
-    std::make_shared<Station>(std::move(station)))};
+  if (FindStation(m_stationIds->Find(station.m_id)) != nullptr) {
+    return false;
+  }
 
-  return res.second;
+  const auto index{mutableIds(m_stationIds).Intern(station.m_id)};
+  if (m_passengerCounts && m_passengerCounts->Covers(index)) {
+    m_passengerCounts->Set(index, station.GetPassengerCount());
+  }
+
+  auto pStation{
+    std::allocate_shared<Station>(allocator<Station>(), std::move(station))};
+  track(index, *pStation);
+  auto &stations{m_stations.Mutable()};
+  if (index < stations.size()) {
+    // A removed station keeps its index and may come back.
+    stations[index] = std::move(pStation);
+  }
+  else {
+    stations.push_back(std::move(pStation));
+  }
+
+  resetGraph();
+  return true;
 }
 
 auto TransportNetwork::GetStation(const StationId &stationId) const
@@ -102,8 +224,60 @@ auto TransportNetwork::GetStation(const StationId &stationId) const
 {
   assert(!stationId.empty());
 
-  const auto cit = m_stations.find(stationId);
-  return (cit != m_stations.end() ? cit->second : nullptr);
+  return GetStation(m_stationIds->Find(stationId));
+}
+
+auto TransportNetwork::GetStation(const StationIndex station) const
+  -> std::shared_ptr<Station>
+{
+  if (station >= m_stations->size() || !(*m_stations)[station]) {
+    return nullptr;
+  }
+
+  const auto &pStation{(*m_stations)[station]};
+  if (!m_passengerCounts || !m_passengerCounts->Covers(station)) {
+    return pStation;
+  }
+
+  // The station may be shared with the origin, hand out the fork's own copy,
+  // which counts the fork's passengers from then on.
+  return m_passengerCounts->GetClone(station, [this, &pStation]() {
+    return std::allocate_shared<Station>(allocator<Station>(), *pStation);
+  });
+}
+
+auto TransportNetwork::GetStationIndex(const StationId &stationId) const
+  -> StationIndex
+{
+  return m_stationIds->Find(stationId);
+}
+
+auto TransportNetwork::GetStationId(const StationIndex station) const
+  -> const StationId &
+{
+  return m_stationIds->Resolve(station);
+}
+
+auto TransportNetwork::GetStationCount() const -> std::size_t
+{
+  return m_stations->size();
+}
+
+auto TransportNetwork::GetLineIndex(const LineId &lineId) const -> LineIndex
+{
+  return m_lineIds->Find(lineId);
+}
+
+auto TransportNetwork::GetRouteIndex(const RouteId &routeId) const
+  -> RouteIndex
+{
+  return m_routeIds->Find(routeId);
+}
+
+auto TransportNetwork::GetRouteId(const RouteIndex route) const
+  -> const RouteId &
+{
+  return m_routeIds->Resolve(route);
 }
 
 bool TransportNetwork::AddLine(Line line)
@@ -114,32 +288,431 @@ bool TransportNetwork::AddLine(Line line)
       "(TransportNetwork::AddLine): Line with empty routes are not supported!");
   }
 
-  // TODO: Move into function.
+  if (GetLine(line.id)) {
+    return false;
+  }
+
   // When inserting the line, network should already contain all its stations.
+  // Resolve everything up front so that a failure leaves the network intact.
+  std::vector<ArenaVector<StationIndex>> routeStops;
+  std::unordered_set<std::string_view> routeIds;
+  routeStops.reserve(line.routes.size());
   for (const auto &route : line.routes) {
+    if (FindRoute(m_routeIds->Find(route->routeId)) != nullptr ||
+        !routeIds.insert(route->routeId).second) {
+      throw std::logic_error(
+        "(TransportNetwork::AddLine): Network already contains route=" +
+        route->routeId);
+    }
+
+    auto &stops{routeStops.emplace_back(allocator<StationIndex>())};
+    stops.reserve(route->stops.size());
     for (const auto &stationId : route->stops) {
-      if (!GetStation(stationId)) {
+      const auto station{m_stationIds->Find(stationId)};
+      if (FindStation(station) == nullptr) {
         throw std::logic_error(
           "(TransportNetwork::AddLine): Network contains no station=" +
           stationId);
       }
+
+      stops.push_back(station);
     }
   }
 
-  // TODO: Move into function.
-  for (const auto &route : line.routes) {
-    for (const auto &stationId : route->stops) {
-      auto pStation{GetStation(stationId)};
-      pStation->AddRoute(route);
+  const auto lineIndex{mutableIds(m_lineIds).Intern(line.id)};
+  for (std::size_t i{0}; i < line.routes.size(); ++i) {
+    attachRoute(lineIndex, line.routes[i], std::move(routeStops[i]));
+  }
+
+  auto pLine{std::allocate_shared<Line>(allocator<Line>(), std::move(line))};
+  auto &lines{m_lines.Mutable()};
+  if (lineIndex < lines.size()) {
+    lines[lineIndex] = std::move(pLine);
+  }
+  else {
+    lines.push_back(std::move(pLine));
+  }
+
+  // New hops may shorten any itinerary.
+  clearItineraryCache();
+  resetGraph();
+  return true;
+}
+
+auto TransportNetwork::RemoveLine(const LineId &lineId) -> bool
+{
+  assert(!lineId.empty());
+
+  const auto line{m_lineIds->Find(lineId)};
+  if (!FindLine(lineId)) {
+    return false;
+  }
+
+  detachLine(line);
+  return true;
+}
+
+auto TransportNetwork::RemoveStation(const StationId &stationId) -> bool
+{
+  assert(!stationId.empty());
+
+  const auto station{m_stationIds->Find(stationId)};
+  const auto *pStation{FindStation(station)};
+  if (!pStation) {
+    return false;
+  }
+
+  if (!pStation->m_routes.empty()) {
+    throw std::logic_error(
+      "(TransportNetwork::RemoveStation): Routes still stop at station=" +
+      stationId);
+  }
+
+  eraseTravelTimes(station);
+  m_stations.Mutable()[station].reset();
+  resetGraph();
+  return true;
+}
+
+auto TransportNetwork::ApplyLayoutDiff(const NetworkLayout &layout)
+  -> LayoutDiff
+{
+  // Validate the whole layout before changing anything.
+  std::unordered_map<std::string_view, const Station *> layoutStations;
+  layoutStations.reserve(layout.stations.size());
+  for (const auto &station : layout.stations) {
+    layoutStations.emplace(station.m_id, &station);
+  }
+
+  const auto checkStation{[&layoutStations](const StationId &stationId) {
+    if (!layoutStations.contains(stationId)) {
+      throw std::logic_error(
+        "(TransportNetwork::ApplyLayoutDiff): Layout contains no station=" +
+        stationId);
+    }
+  }};
+
+  std::unordered_map<std::string_view, const Line *> layoutLines;
+  std::unordered_set<std::string_view> layoutRoutes;
+  for (const auto &line : layout.lines) {
+    if (line.routes.empty()) {
+      throw std::logic_error(
+        "(TransportNetwork::ApplyLayoutDiff): Line with empty routes are not "
+        "supported!");
+    }
+
+    if (!layoutLines.emplace(line.id, &line).second) {
+      continue;
+    }
+
+    for (const auto &route : line.routes) {
+      if (!layoutRoutes.insert(route->routeId).second) {
+        throw std::logic_error(
+          "(TransportNetwork::ApplyLayoutDiff): Layout contains duplicate "
+          "route=" +
+          route->routeId);
+      }
+
+      std::ranges::for_each(route->stops, checkStation);
     }
   }
 
-  auto lineId{line.id};
-  const auto res{m_lines.emplace(
-    std::move(lineId),
-    std::make_shared<Line>(std::move(line)))};
+  for (const auto &travelTime : layout.travelTimes) {
+    checkStation(travelTime.startStationId);
+    checkStation(travelTime.endStationId);
+  }
 
-  return res.second;
+  LayoutDiff diff{};
+
+  // Lines go first, so that stations no longer served can be removed.
+  std::unordered_set<std::string_view> modifiedLines;
+  for (LineIndex line{0}; line < m_lines->size(); ++line) {
+    if (!(*m_lines)[line]) {
+      continue;
+    }
+
+    const auto it{layoutLines.find((*m_lines)[line]->id)};
+    if (it == layoutLines.end()) {
+      detachLine(line);
+      diff.removedLines++;
+    }
+    else if (!SameLine(*(*m_lines)[line], *it->second)) {
+      modifiedLines.insert(it->first);
+      detachLine(line);
+      diff.modifiedLines++;
+    }
+  }
+
+  for (const auto &station : layout.stations) {
+    const auto index{m_stationIds->Find(station.m_id)};
+    if (!FindStation(index)) {
+      diff.addedStations += AddStation(station) ? 1 : 0;
+    }
+    else if ((*m_stations)[index]->m_name != station.m_name) {
+      mutableStation(index).m_name = station.m_name;
+      diff.modifiedStations++;
+    }
+  }
+
+  for (StationIndex station{0}; station < m_stations->size(); ++station) {
+    if ((*m_stations)[station] &&
+        !layoutStations.contains(m_stationIds->Resolve(station))) {
+      diff.removedTravelTimes += eraseTravelTimes(station);
+      m_stations.Mutable()[station].reset();
+      diff.removedStations++;
+    }
+  }
+
+  for (const auto &line : layout.lines) {
+    if (!FindLine(line.id)) {
+      AddLine(line);
+      if (!modifiedLines.contains(line.id)) {
+        diff.addedLines++;
+      }
+    }
+  }
+
+  std::unordered_set<std::uint64_t> layoutTravelTimes;
+  layoutTravelTimes.reserve(layout.travelTimes.size());
+  for (const auto &travelTime : layout.travelTimes) {
+    const TravelTime record{
+      .m_startStation = m_stationIds->Find(travelTime.startStationId),
+      .m_endStation = m_stationIds->Find(travelTime.endStationId),
+      .m_line = m_lineIds->Find(travelTime.lineId),
+      .m_route = m_routeIds->Find(travelTime.routeId),
+      .m_travelTime = travelTime.travelTime};
+    if (record.m_startStation == record.m_endStation ||
+        !layoutTravelTimes
+           .insert(TravelTimeKey(record.m_startStation, record.m_endStation))
+           .second) {
+      continue;
+    }
+
+    const auto start{record.m_startStation};
+    const auto end{record.m_endStation};
+    const auto forward{hopTime(start, end)};
+    const auto backward{hopTime(end, start)};
+    const auto it{m_travelTimes->find(boost::make_tuple(start, end))};
+    if (it == m_travelTimes->end()) {
+      mutableTravelTimes().insert(record);
+      diff.addedTravelTimes++;
+    }
+    else if (it->m_travelTime != record.m_travelTime) {
+      auto &travelTimes{mutableTravelTimes()};
+      travelTimes.replace(
+        travelTimes.find(boost::make_tuple(start, end)),
+        record);
+      diff.modifiedTravelTimes++;
+    }
+
+    invalidateHop(start, end, forward);
+    invalidateHop(end, start, backward);
+  }
+
+  auto &travelTimes{mutableTravelTimes()};
+  for (auto it{travelTimes.begin()}; it != travelTimes.end();) {
+    if (!layoutTravelTimes.contains(
+          TravelTimeKey(it->m_startStation, it->m_endStation))) {
+      const auto start{it->m_startStation};
+      const auto end{it->m_endStation};
+      const auto forward{hopTime(start, end)};
+      const auto backward{hopTime(end, start)};
+      it = travelTimes.erase(it);
+      diff.removedTravelTimes++;
+
+      invalidateHop(start, end, forward);
+      invalidateHop(end, start, backward);
+    }
+    else {
+      ++it;
+    }
+  }
+
+  if (!diff.Empty()) {
+    resetGraph();
+  }
+
+  return diff;
+}
+
+void TransportNetwork::detachLine(const LineIndex line)
+{
+  assert(line < m_lines->size() && (*m_lines)[line]);
+
+  auto *pItineraryCache{mutableItineraryCache()};
+  auto &routes{mutableRoutes()};
+  for (const auto &pRoute : (*m_lines)[line]->routes) {
+    auto &record{routes[m_routeIds->Find(pRoute->routeId)]};
+    for (const auto station : record.stops) {
+      std::erase(mutableStation(station).m_routes, pRoute);
+    }
+
+    // Fewer hops only make the itineraries that ride them stale.
+    for (std::size_t i{1}; pItineraryCache && i < record.stops.size(); ++i) {
+      pItineraryCache->InvalidateHop(record.stops[i - 1], record.stops[i]);
+    }
+
+    // The route keeps its index, should it be added again.
+    record = RouteRecord{};
+  }
+
+  m_lines.Mutable()[line].reset();
+  resetGraph();
+}
+
+auto TransportNetwork::eraseTravelTimes(const StationIndex station)
+  -> std::size_t
+{
+  // No route stops at the station anymore, so no cached itinerary rides the
+  // travel times erased.
+  assert(!(*m_stations)[station] || (*m_stations)[station]->m_routes.empty());
+
+  std::size_t erased{0};
+  auto &travelTimes{mutableTravelTimes()};
+  for (auto it{travelTimes.begin()}; it != travelTimes.end();) {
+    if (it->m_startStation == station || it->m_endStation == station) {
+      it = travelTimes.erase(it);
+      erased++;
+    }
+    else {
+      ++it;
+    }
+  }
+
+  return erased;
+}
+
+void TransportNetwork::resetGraph()
+{
+  m_graph.reset();
+  m_segmentLoads.reset();
+  m_travelTimeMatrix.reset();
+}
+
+auto TransportNetwork::mutableItineraryCache() -> ItineraryCache *
+{
+  if (m_copyToken.use_count() > 1 && m_itineraryCache.use_count() > 1) {
+    m_itineraryCache = std::make_shared<ItineraryCache>(*m_itineraryCache);
+  }
+
+  return m_itineraryCache.get();
+}
+
+void TransportNetwork::invalidateHop(
+  const StationIndex start,
+  const StationIndex end,
+  const unsigned int before)
+{
+  const auto after{hopTime(start, end)};
+  if (after < before) {
+    clearItineraryCache();
+  }
+  else if (after != before) {
+    if (auto *pItineraryCache{mutableItineraryCache()}) {
+      pItineraryCache->InvalidateHop(start, end);
+    }
+  }
+}
+
+void TransportNetwork::clearItineraryCache()
+{
+  if (auto *pItineraryCache{mutableItineraryCache()}) {
+    pItineraryCache->Clear();
+  }
+}
+
+auto TransportNetwork::mutableStation(const StationIndex station) -> Station &
+{
+  assert(station < m_stations->size());
+
+  auto &pStation{m_stations.Mutable()[station]};
+  assert(pStation);
+  if (m_copyToken.use_count() > 1 && pStation.use_count() > 1) {
+    pStation = std::allocate_shared<Station>(allocator<Station>(), *pStation);
+    track(station, *pStation);
+  }
+
+  return *pStation;
+}
+
+auto TransportNetwork::mutableIds(CopyOnWrite<IdInterner> &ids)
+  -> IdInterner &
+{
+  return ids.Mutable([this](const IdInterner &shared) {
+    return IdInterner{shared, allocator<std::byte>()};
+  });
+}
+
+auto TransportNetwork::mutableRoutes() -> std::vector<RouteRecord> &
+{
+  return m_routes.Mutable([this](const std::vector<RouteRecord> &shared) {
+    std::vector<RouteRecord> routes;
+    routes.reserve(shared.size());
+    for (const auto &record : shared) {
+      routes.push_back(RouteRecord{
+        .line = record.line,
+        .stops{record.stops, allocator<StationIndex>()},
+        .route = record.route});
+    }
+
+    return routes;
+  });
+}
+
+auto TransportNetwork::mutableTravelTimes() -> TravelTimes &
+{
+  return m_travelTimes.Mutable([this](const TravelTimes &shared) {
+    return TravelTimes{
+      shared.begin(),
+      shared.end(),
+      TravelTimes::ctor_args_list{},
+      allocator<TravelTime>()};
+  });
+}
+
+void TransportNetwork::track(const StationIndex index, Station &station) const
+{
+  station.m_passengerCount.Track(m_pForks, index);
+}
+
+auto TransportNetwork::passengerCount(
+  const StationIndex index,
+  const Station &station) const -> std::size_t
+{
+  if (m_passengerCounts && m_passengerCounts->Covers(index)) {
+    return m_passengerCounts->Get(index);
+  }
+
+  return station.GetPassengerCount();
+}
+
+void TransportNetwork::attachRoute(
+  const LineIndex line,
+  const std::shared_ptr<Route> &pRoute,
+  ArenaVector<StationIndex> stops)
+{
+  const auto route{mutableIds(m_routeIds).Intern(pRoute->routeId)};
+
+  // The route is new to the network, so it can only already be listed on a
+  // station if it visits that station twice, in which case it was the last
+  // route added there. This avoids the deep search of Station::AddRoute.
+  for (const auto station : stops) {
+    auto &routes{mutableStation(station).m_routes};
+    if (routes.empty() || routes.back() != pRoute) {
+      routes.push_back(pRoute);
+    }
+  }
+
+  RouteRecord record{.line = line, .stops = std::move(stops), .route = pRoute};
+  auto &routes{mutableRoutes()};
+  if (route < routes.size()) {
+    assert(!routes[route].route);
+    routes[route] = std::move(record);
+  }
+  else {
+    assert(route == routes.size());
+    routes.push_back(std::move(record));
+  }
 }
 
 auto TransportNetwork::GetLine(const LineId &lineId) const
@@ -147,8 +720,8 @@ auto TransportNetwork::GetLine(const LineId &lineId) const
 {
   assert(!lineId.empty());
 
-  const auto cit{m_lines.find(lineId)};
-  return (cit != m_lines.end() ? cit->second : nullptr);
+  const auto index{m_lineIds->Find(lineId)};
+  return (index < m_lines->size() ? (*m_lines)[index] : nullptr);
 }
 
 auto TransportNetwork::RecordPassengerEvent(const PassengerEvent &event) const -> bool
@@ -159,12 +732,162 @@ auto TransportNetwork::RecordPassengerEvent(const PassengerEvent &event) const -
   //   event.m_type == PassengerEvent::Type::kIn ||
   //   event.m_type == PassengerEvent::Type::kOut);
 
-  auto pStation{GetStation(event.m_stationId)};
-  if (pStation) {
-    return pStation->RecordPassengerEvent(event);
+  return RecordPassengerEvent(
+    m_stationIds->Find(event.m_stationId),
+    event.m_type,
+    event.m_timestamp);
+}
+
+auto TransportNetwork::RecordPassengerEvent(
+  const StationIndex station,
+  const PassengerEvent::Type type,
+  const PassengerTimestamp timestamp) const -> bool
+{
+  const auto *pStation{FindStation(station)};
+  if (pStation == nullptr) {
+    return false;
+  }
+
+  if (m_passengerCounts && m_passengerCounts->Covers(station)) {
+    // The station may be shared with the origin, whose statistics it keeps.
+    const auto in{type == PassengerEvent::Type::kIn};
+    auto accepted{false};
+    m_passengerCounts->Update(
+      station,
+      [type, in, &accepted](const std::size_t count) {
+        accepted = in || (type == PassengerEvent::Type::kOut && count != 0);
+        return accepted ? (in ? count + 1 : count - 1) : count;
+      });
+    if (!accepted) {
+      return false;
+    }
+  }
+  else if (!(*m_stations)[station]->RecordPassengerEvent(type, timestamp)) {
+    return false;
+  }
+
+  if (m_segmentLoads) {
+    const auto in{type == PassengerEvent::Type::kIn};
+    m_segmentLoads->Record(station, timestamp, in ? 1 : 0, in ? 0 : 1);
+  }
+
+  return true;
+}
+
+auto TransportNetwork::RecordPassengerEvents(
+  const std::span<const PassengerEvent> events) const
+  -> PassengerEventRejections
+{
+  PassengerEventRejections rejections(events.size());
+
+  // (station, position in the batch) of every acceptable event, reused across
+  // calls on the same thread.
+  thread_local std::vector<std::pair<StationIndex, std::uint32_t>> tResolved;
+  tResolved.clear();
+  tResolved.reserve(events.size());
+
+  const StationId *pLastId{nullptr};
+  auto lastStation{kInvalidId};
+  for (std::uint32_t i{0}; i < events.size(); ++i) {
+    const auto &event{events[i]};
+    // Bursts tend to repeat stations, skip hashing the same id twice in a row.
+    if (pLastId == nullptr || event.m_stationId != *pLastId) {
+      pLastId = &event.m_stationId;
+      lastStation = m_stationIds->Find(event.m_stationId);
+    }
+
+    if (lastStation >= m_stations->size() || !(*m_stations)[lastStation] ||
+        (event.m_type != PassengerEvent::Type::kIn &&
+         event.m_type != PassengerEvent::Type::kOut)) {
+      rejections.set(i);
+      continue;
+    }
+
+    tResolved.emplace_back(lastStation, i);
+  }
+
+  std::ranges::sort(tResolved);
+
+  for (auto first{tResolved.begin()}; first != tResolved.end();) {
+    const auto station{first->first};
+    const auto last{std::find_if(first, tResolved.end(), [station](auto e) {
+      return e.first != station;
+    })};
+
+    // Replay the station's events on top of its current count and publish the
+    // net result at once.
+    const auto replay{[&events, &rejections, first, last](std::size_t count) {
+      for (auto it{first}; it != last; ++it) {
+        const auto position{it->second};
+        const auto rejected{
+          events[position].m_type == PassengerEvent::Type::kOut &&
+          count == 0};
+
+        rejections.set(position, rejected);
+        if (!rejected) {
+          events[position].m_type == PassengerEvent::Type::kIn ? ++count
+                                                               : --count;
+        }
+      }
+
+      return count;
+    }};
+
+    auto &pStation{(*m_stations)[station]};
+    const auto forked{m_passengerCounts && m_passengerCounts->Covers(station)};
+    if (forked) {
+      m_passengerCounts->Update(station, replay);
+    }
+    else {
+      pStation->UpdatePassengerCount(replay);
+    }
+
+    // Accepted events go to the statistics, except in a fork, and to the
+    // segment loads once per bucket period they span.
+    std::uint32_t in{0};
+    std::uint32_t out{0};
+    PassengerTimestamp timestamp{};
+    const auto flush{[&]() {
+      if (!forked) {
+        pStation->RecordPassengerStatistics(timestamp, in, out);
+      }
+
+      if (m_segmentLoads) {
+        m_segmentLoads->Record(station, timestamp, in, out);
+      }
+
+      in = 0;
+      out = 0;
+    }};
+
+    auto period{std::numeric_limits<std::uint64_t>::max()};
+    for (auto it{first}; it != last; ++it) {
+      const auto &event{events[it->second]};
+      if (rejections.test(it->second)) {
+        continue;
+      }
+
+      const auto time{
+        event.m_timestamp == PassengerTimestamp{} ? PassengerClock::now()
+                                                  : event.m_timestamp};
+      const auto eventPeriod{PassengerStatistics::GetPeriod(time)};
+      if (eventPeriod != period && (in != 0 || out != 0)) {
+        flush();
+      }
+
+      period = eventPeriod;
+      timestamp = time;
+      event.m_type == PassengerEvent::Type::kIn ? ++in : ++out;
+    }
+
+    if (in != 0 || out != 0) {
+      flush();
+    }
+
+    first = last;
   }
 
-  return false;
+  return rejections;
 }
 
 auto
@@ -172,27 +895,140 @@ TransportNetwork::GetPassengerCount(const StationId &stationId) const -> std::si
 {
   assert(!stationId.empty());
 
-  auto pStation{GetStation(stationId)};
-  if (pStation) {
-    return pStation->GetPassengerCount();
+  return GetPassengerCount(m_stationIds->Find(stationId));
+}
+
+auto TransportNetwork::GetPassengerCount(const StationIndex station) const
+  -> std::size_t
+{
+  if (const auto *pStation{FindStation(station)}) {
+    return passengerCount(station, *pStation);
   }
 
   return 0;
 }
 
+auto TransportNetwork::GetPassengerRates(
+  const StationId &stationId,
+  const std::chrono::seconds window,
+  const PassengerTimestamp now) const -> PassengerRates
+{
+  assert(!stationId.empty());
+
+  return GetPassengerRates(m_stationIds->Find(stationId), window, now);
+}
+
+auto TransportNetwork::GetPassengerRates(
+  const StationIndex station,
+  const std::chrono::seconds window,
+  const PassengerTimestamp now) const -> PassengerRates
+{
+  if (const auto *pStation{FindStation(station)}) {
+    return pStation->GetPassengerStatistics().GetRates(window, now);
+  }
+
+  return {};
+}
+
+auto TransportNetwork::GetPassengerRatePercentiles(
+  const StationId &stationId,
+  const std::chrono::seconds window,
+  const double percentile,
+  const PassengerTimestamp now) const -> PassengerRates
+{
+  assert(!stationId.empty());
+
+  return GetPassengerRatePercentiles(
+    m_stationIds->Find(stationId),
+    window,
+    percentile,
+    now);
+}
+
+auto TransportNetwork::GetPassengerRatePercentiles(
+  const StationIndex station,
+  const std::chrono::seconds window,
+  const double percentile,
+  const PassengerTimestamp now) const -> PassengerRates
+{
+  if (const auto *pStation{FindStation(station)}) {
+    return pStation->GetPassengerStatistics().GetRatePercentiles(
+      window,
+      percentile,
+      now);
+  }
+
+  return {};
+}
+
 auto
 TransportNetwork::GetRoutesServingStation(const StationId &stationId) const -> std::vector<std::shared_ptr<Route>>
 {
   assert(!stationId.empty());
 
-  const auto pStation{GetStation(stationId)};
-  if (pStation) {
+  if (const auto *pStation{FindStation(stationId)}) {
     return pStation->GetRoutes();
   }
 
   return {};
 }
 
+auto TransportNetwork::FindStation(const StationId &stationId) const
+  -> const Station *
+{
+  assert(!stationId.empty());
+
+  return FindStation(m_stationIds->Find(stationId));
+}
+
+auto TransportNetwork::FindStation(const StationIndex station) const
+  -> const Station *
+{
+  const auto &stations{*m_stations};
+  return (station < stations.size() ? stations[station].get() : nullptr);
+}
+
+auto TransportNetwork::FindLine(const LineId &lineId) const -> const Line *
+{
+  assert(!lineId.empty());
+
+  const auto index{m_lineIds->Find(lineId)};
+  return (index < m_lines->size() ? (*m_lines)[index].get() : nullptr);
+}
+
+auto TransportNetwork::FindRoute(const RouteIndex route) const -> const Route *
+{
+  return (route < m_routes->size() ? (*m_routes)[route].route.get() : nullptr);
+}
+
+auto TransportNetwork::GetRouteStopsView(const RouteIndex route) const
+  -> std::span<const StationIndex>
+{
+  if (route < m_routes->size()) {
+    return (*m_routes)[route].stops;
+  }
+
+  return {};
+}
+
+auto TransportNetwork::GetRoutesServingStationView(
+  const StationId &stationId) const -> std::span<const std::shared_ptr<Route>>
+{
+  assert(!stationId.empty());
+
+  return GetRoutesServingStationView(m_stationIds->Find(stationId));
+}
+
+auto TransportNetwork::GetRoutesServingStationView(
+  const StationIndex station) const -> std::span<const std::shared_ptr<Route>>
+{
+  if (const auto *pStation{FindStation(station)}) {
+    return pStation->GetRoutesView();
+  }
+
+  return {};
+}
+
 auto TransportNetwork::SetTravelTime(
   const StationId &start,
   const StationId &end,
@@ -201,14 +1037,32 @@ auto TransportNetwork::SetTravelTime(
   assert(!start.empty());
   assert(!end.empty());
 
-  if (start == end) {
+  return SetTravelTime(
+    m_stationIds->Find(start),
+    m_stationIds->Find(end),
+    travelTime);
+}
+
+auto TransportNetwork::SetTravelTime(
+  const StationIndex start,
+  const StationIndex end,
+  const unsigned int travelTime) -> bool
+{
+  if (start == end || !FindStation(start) || !FindStation(end)) {
     return false;
   }
 
-  const auto res{m_travelTimes.insert(TravelTime{
-    .m_startStationId{start},
-    .m_endStationId{end},
+  const auto forward{hopTime(start, end)};
+  const auto backward{hopTime(end, start)};
+  const auto res{mutableTravelTimes().insert(TravelTime{
+    .m_startStation = start,
+    .m_endStation = end,
     .m_travelTime = travelTime})};
+  if (res.second) {
+    invalidateHop(start, end, forward);
+    invalidateHop(end, start, backward);
+    resetGraph();
+  }
 
   return res.second;
 }
@@ -220,14 +1074,356 @@ auto TransportNetwork::GetTravelTime(
   assert(!start.empty());
   assert(!end.empty());
 
-  const auto res{m_travelTimes.find(boost::make_tuple(start, end))};
-  if (res != m_travelTimes.end()) {
+  return GetTravelTime(m_stationIds->Find(start), m_stationIds->Find(end));
+}
+
+auto TransportNetwork::GetTravelTime(
+  const StationIndex start,
+  const StationIndex end) const -> unsigned int
+{
+  return findTravelTime(start, end);
+}
+
+auto TransportNetwork::findTravelTime(
+  const StationIndex start,
+  const StationIndex end) const -> unsigned int
+{
+  const auto res{m_travelTimes->find(boost::make_tuple(start, end))};
+  if (res != m_travelTimes->end()) {
     return res->m_travelTime;
   }
 
   return 0;
 }
 
+auto TransportNetwork::hopTime(
+  const StationIndex start,
+  const StationIndex end) const -> unsigned int
+{
+  // Travel times are symmetric, layouts usually store one direction only.
+  const auto travelTime{findTravelTime(start, end)};
+  return travelTime != 0 ? travelTime : findTravelTime(end, start);
+}
+
+void TransportNetwork::BuildGraph()
+{
+  std::size_t hopCount{0};
+  for (const auto &record : *m_routes) {
+    hopCount += record.stops.empty() ? 0 : record.stops.size() - 1;
+  }
+
+  std::vector<unsigned int> travelTimes;
+  travelTimes.reserve(hopCount);
+  for (const auto &record : *m_routes) {
+    for (std::size_t i{1}; i < record.stops.size(); ++i) {
+      travelTimes.push_back(hopTime(record.stops[i - 1], record.stops[i]));
+    }
+  }
+
+  std::vector<GraphRoute> routes;
+  routes.reserve(m_routes->size());
+  std::span<const unsigned int> remainingTimes{travelTimes};
+  for (const auto &record : *m_routes) {
+    const auto hops{record.stops.empty() ? 0 : record.stops.size() - 1};
+    routes.push_back(GraphRoute{
+      .line = record.line,
+      .stops{record.stops},
+      .travelTimes{remainingTimes.first(hops)}});
+    remainingTimes = remainingTimes.subspan(hops);
+  }
+
+  resetGraph();
+  m_graph =
+    std::make_shared<const TransportGraph>(m_stations->size(), routes);
+  m_segmentLoads = std::make_shared<SegmentLoadEstimator>(m_graph);
+}
+
+auto TransportNetwork::GetGraph() const
+  -> std::shared_ptr<const TransportGraph>
+{
+  return m_graph;
+}
+
+void TransportNetwork::PrecomputeTravelTimes(
+  const ItineraryOptions &options,
+  const std::size_t threadCount)
+{
+  if (!m_graph) {
+    throw std::logic_error(
+      "(TransportNetwork::PrecomputeTravelTimes): Graph is not built!");
+  }
+
+  m_travelTimeMatrix =
+    std::make_shared<const TravelTimeMatrix>(*m_graph, options, threadCount);
+}
+
+auto TransportNetwork::GetTravelTimeMatrix() const
+  -> std::shared_ptr<const TravelTimeMatrix>
+{
+  return m_travelTimeMatrix;
+}
+
+auto TransportNetwork::GetShortestTravelTime(
+  const StationId &start,
+  const StationId &end) const -> unsigned int
+{
+  return GetShortestTravelTime(
+    m_stationIds->Find(start),
+    m_stationIds->Find(end));
+}
+
+auto TransportNetwork::GetShortestTravelTime(
+  const StationIndex start,
+  const StationIndex end) const -> unsigned int
+{
+  if (!m_travelTimeMatrix) {
+    throw std::logic_error(
+      "(TransportNetwork::GetShortestTravelTime): Travel times are not "
+      "precomputed!");
+  }
+
+  const auto time{m_travelTimeMatrix->Get(start, end)};
+  return (time != TravelTimeMatrix::kUnreachable ? time : 0);
+}
+
+auto TransportNetwork::GetTravelTime(
+  const RouteId &routeId,
+  const StationId &start,
+  const StationId &end) const -> unsigned int
+{
+  assert(!routeId.empty());
+  assert(!start.empty());
+  assert(!end.empty());
+
+  return GetTravelTime(
+    m_routeIds->Find(routeId),
+    m_stationIds->Find(start),
+    m_stationIds->Find(end));
+}
+
+auto TransportNetwork::GetTravelTime(
+  const RouteIndex route,
+  const StationIndex start,
+  const StationIndex end) const -> unsigned int
+{
+  if (!m_graph) {
+    throw std::logic_error(
+      "(TransportNetwork::GetTravelTime): Graph is not built!");
+  }
+
+  return m_graph->GetRouteTravelTime(route, start, end);
+}
+
+auto TransportNetwork::GetSegmentLoad(
+  const RouteIndex route,
+  const StopPosition position,
+  const std::chrono::seconds window,
+  const PassengerTimestamp now) const -> double
+{
+  if (!m_segmentLoads) {
+    throw std::logic_error(
+      "(TransportNetwork::GetSegmentLoad): Graph is not built!");
+  }
+
+  return m_segmentLoads->GetLoad(route, position, window, now);
+}
+
+auto TransportNetwork::GetMostCrowdedSegments(
+  const std::size_t count,
+  const std::chrono::seconds window,
+  const PassengerTimestamp now) const -> std::vector<SegmentLoad>
+{
+  if (!m_segmentLoads) {
+    throw std::logic_error(
+      "(TransportNetwork::GetMostCrowdedSegments): Graph is not built!");
+  }
+
+  return m_segmentLoads->GetMostCrowdedSegments(count, window, now);
+}
+
+auto TransportNetwork::GetFastestPath(
+  const StationId &start,
+  const StationId &end,
+  const ItineraryOptions &options) const -> Itinerary
+{
+  assert(!start.empty());
+  assert(!end.empty());
+
+  Itinerary itinerary{};
+  GetFastestPath(
+    m_stationIds->Find(start),
+    m_stationIds->Find(end),
+    itinerary,
+    options);
+
+  return itinerary;
+}
+
+auto TransportNetwork::GetFastestPath(
+  const StationIndex start,
+  const StationIndex end,
+  Itinerary &itinerary,
+  const ItineraryOptions &options) const -> bool
+{
+  if (!m_graph) {
+    throw std::logic_error(
+      "(TransportNetwork::GetFastestPath): Graph is not built!");
+  }
+
+  const auto stationCount{m_graph->GetStationCount()};
+  const auto cached{
+    m_itineraryCache && start != end && start < stationCount &&
+    end < stationCount};
+  if (cached && m_itineraryCache->Find(start, end, options, itinerary)) {
+    return !itinerary.Empty();
+  }
+
+  const auto found{FindFastestPath(*m_graph, start, end, options, itinerary)};
+  if (cached) {
+    m_itineraryCache->Insert(start, end, options, itinerary);
+  }
+
+  return found;
+}
+
+auto TransportNetwork::GetMemoryResource() const
+  -> const std::shared_ptr<std::pmr::memory_resource> &
+{
+  return m_pMemoryResource;
+}
+
+auto TransportNetwork::GetMemoryUsage() const -> NetworkMemoryUsage
+{
+  NetworkMemoryUsage usage{
+    .ids = m_lineIds->GetMemoryUsage() + m_routeIds->GetMemoryUsage() +
+           m_stationIds->GetMemoryUsage(),
+    .stations = HeapBytes(*m_stations),
+    .lines = HeapBytes(*m_lines),
+    .routes = HeapBytes(*m_routes),
+    .passengerEvents = HashTableBytes(m_passengerEvents),
+    .travelTimes = HashTableBytes(*m_travelTimes)};
+
+  for (const auto &pStation : *m_stations) {
+    if (pStation) {
+      usage.stations += SharedBytes(pStation) + HeapBytes(pStation->m_id) +
+                        HeapBytes(pStation->m_name);
+      usage.stationRoutes += HeapBytes(pStation->m_routes);
+    }
+  }
+
+  for (const auto &pLine : *m_lines) {
+    if (pLine) {
+      usage.lines += SharedBytes(pLine) + HeapBytes(pLine->id) +
+                     HeapBytes(pLine->name) + HeapBytes(pLine->routes);
+    }
+  }
+
+  std::unordered_set<const StopSequence::Stops *> stopArrays;
+  for (const auto &record : *m_routes) {
+    usage.routes += HeapBytes(record.stops);
+    if (const auto &pRoute{record.route}) {
+      usage.routes += SharedBytes(pRoute) + HeapBytes(pRoute->lineId) +
+                      HeapBytes(pRoute->routeId) +
+                      HeapBytes(pRoute->startStationId) +
+                      HeapBytes(pRoute->endStationId);
+      if (stopArrays.insert(pRoute->stops.GetStops().get()).second) {
+        usage.routes += pRoute->stops.GetMemoryUsage();
+      }
+    }
+  }
+
+  for (const auto &[stationId, count] : m_passengerEvents) {
+    usage.passengerEvents += HeapBytes(stationId);
+  }
+
+  if (m_graph) {
+    usage.graph = SharedBytes(m_graph) + m_graph->GetMemoryUsage();
+  }
+
+  if (m_segmentLoads) {
+    usage.segmentLoads =
+      SharedBytes(m_segmentLoads) + m_segmentLoads->GetMemoryUsage();
+  }
+
+  if (m_travelTimeMatrix) {
+    usage.travelTimeMatrix =
+      SharedBytes(m_travelTimeMatrix) + m_travelTimeMatrix->GetMemoryUsage();
+  }
+
+  if (m_passengerCounts) {
+    usage.forkedPassengerCounts = SharedBytes(m_passengerCounts) +
+                                  m_passengerCounts->GetMemoryUsage();
+  }
+
+  if (m_itineraryCache) {
+    usage.itineraryCache =
+      SharedBytes(m_itineraryCache) + m_itineraryCache->GetMemoryUsage();
+  }
+
+  if (const auto *pArena{
+        dynamic_cast<const NetworkArena *>(m_pMemoryResource.get())}) {
+    usage.arenaBytes = pArena->GetAllocatedBytes();
+  }
+
+  return usage;
+}
+
+void TransportNetwork::SetItineraryCacheCapacity(const std::size_t capacity)
+{
+  m_itineraryCache = std::make_shared<ItineraryCache>(capacity);
+}
+
+auto TransportNetwork::GetItineraryCacheStats() const -> ItineraryCacheStats
+{
+  return m_itineraryCache ? m_itineraryCache->GetStats()
+                          : ItineraryCacheStats{};
+}
+
+auto TransportNetwork::GetQuietItineraries(
+  const StationId &start,
+  const StationId &end,
+  const std::size_t count,
+  const QuietItineraryOptions &options) const -> std::vector<QuietItinerary>
+{
+  assert(!start.empty());
+  assert(!end.empty());
+
+  std::vector<QuietItinerary> itineraries{};
+  GetQuietItineraries(
+    m_stationIds->Find(start),
+    m_stationIds->Find(end),
+    count,
+    itineraries,
+    options);
+
+  return itineraries;
+}
+
+auto TransportNetwork::GetQuietItineraries(
+  const StationIndex start,
+  const StationIndex end,
+  const std::size_t count,
+  std::vector<QuietItinerary> &itineraries,
+  const QuietItineraryOptions &options) const -> bool
+{
+  if (!m_graph) {
+    throw std::logic_error(
+      "(TransportNetwork::GetQuietItineraries): Graph is not built!");
+  }
+
+  return FindQuietItineraries(
+    *m_graph,
+    start,
+    end,
+    count,
+    options,
+    [this](const StationIndex station) -> std::size_t {
+      const auto *pStation{FindStation(station)};
+      return pStation ? passengerCount(station, *pStation) : 0;
+    },
+    itineraries);
+}
+
 auto Station::operator==(const Station &rhs) const noexcept -> bool
 {
   return m_id == rhs.m_id && m_name == rhs.m_name;
@@ -0,0 +1,222 @@
+#include <TransportNetwork/TransportNetworkBuilder.h>
+
+#include <cassert>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_set>
+#include <utility>
+
+namespace Structures::TransportNetwork {
+
+namespace {
+
+auto Arena(const TransportNetwork &network) -> NetworkArena *
+{
+  return dynamic_cast<NetworkArena *>(network.GetMemoryResource().get());
+}
+
+} // namespace
+
+TransportNetworkBuilder::TransportNetworkBuilder()
+    : TransportNetworkBuilder(nullptr)
+{
+}
+
+TransportNetworkBuilder::TransportNetworkBuilder(
+  std::shared_ptr<std::pmr::memory_resource> pMemoryResource)
+    : m_pMemoryResource(std::move(pMemoryResource)),
+      m_network(m_pMemoryResource)
+{
+}
+
+auto TransportNetworkBuilder::operator=(TransportNetworkBuilder &&other)
+  -> TransportNetworkBuilder &
+{
+  m_pLoadingArena = std::move(other.m_pLoadingArena);
+  m_pMemoryResource = std::move(other.m_pMemoryResource);
+  m_network = std::move(other.m_network);
+  m_lines = std::move(other.m_lines);
+  m_travelTimes = std::move(other.m_travelTimes);
+  return *this;
+}
+
+void TransportNetworkBuilder::Reserve(
+  const std::size_t stationCount,
+  const std::size_t lineCount,
+  const std::size_t travelTimeCount)
+{
+  beginLoad();
+  m_network.mutableIds(m_network.m_stationIds).Reserve(stationCount);
+  m_network.m_stations.Mutable().reserve(stationCount);
+  m_network.mutableIds(m_network.m_lineIds).Reserve(lineCount);
+  m_lines.reserve(lineCount);
+  m_travelTimes.reserve(travelTimeCount);
+}
+
+auto TransportNetworkBuilder::AddStation(Station station) -> bool
+{
+  beginLoad();
+  return m_network.AddStation(std::move(station));
+}
+
+auto TransportNetworkBuilder::AddLine(Line line) -> bool
+{
+  if (line.routes.empty()) {
+    throw std::logic_error(
+      "(TransportNetworkBuilder::AddLine): Line with empty routes are not "
+      "supported!");
+  }
+
+  beginLoad();
+  if (m_network.m_lineIds->Find(line.id) != kInvalidId) {
+    return false;
+  }
+
+  std::unordered_set<std::string_view> routeIds;
+  for (const auto &route : line.routes) {
+    if (m_network.m_routeIds->Find(route->routeId) != kInvalidId ||
+        !routeIds.insert(route->routeId).second) {
+      throw std::logic_error(
+        "(TransportNetworkBuilder::AddLine): Network already contains route=" +
+        route->routeId);
+    }
+  }
+
+  // Route indices follow the order of m_lines, which is the order Build()
+  // attaches them in.
+  for (const auto &route : line.routes) {
+    m_network.mutableIds(m_network.m_routeIds).Intern(route->routeId);
+  }
+
+  m_network.mutableIds(m_network.m_lineIds).Intern(line.id);
+  m_lines.push_back(std::move(line));
+  return true;
+}
+
+void TransportNetworkBuilder::SetTravelTime(LayoutTravelTime travelTime)
+{
+  m_travelTimes.push_back(std::move(travelTime));
+}
+
+void TransportNetworkBuilder::AddLayout(NetworkLayout layout)
+{
+  Reserve(
+    m_network.m_stations->size() + layout.stations.size(),
+    m_lines.size() + layout.lines.size(),
+    m_travelTimes.size() + layout.travelTimes.size());
+
+  for (auto &station : layout.stations) {
+    AddStation(std::move(station));
+  }
+
+  for (auto &line : layout.lines) {
+    AddLine(std::move(line));
+  }
+
+  for (auto &travelTime : layout.travelTimes) {
+    SetTravelTime(std::move(travelTime));
+  }
+}
+
+auto TransportNetworkBuilder::Build() -> TransportNetwork
+{
+  beginLoad();
+  const auto &stationIds{*m_network.m_stationIds};
+  const auto stationCount{m_network.m_stations->size()};
+  const auto resolveStation{[&stationIds](const StationId &stationId) {
+    const auto station{stationIds.Find(stationId)};
+    if (station == kInvalidId) {
+      throw std::logic_error(
+        "(TransportNetworkBuilder::Build): Network contains no station=" +
+        stationId);
+    }
+
+    return station;
+  }};
+
+  // Resolve everything before touching the network, counting how many routes
+  // serve each station along the way.
+  std::vector<ArenaVector<StationIndex>> routeStops;
+  routeStops.reserve(m_network.m_routeIds->Size());
+  std::vector<std::uint32_t> routeCounts(stationCount, 0);
+  std::vector<RouteIndex> lastRoute(stationCount, kInvalidId);
+  for (const auto &line : m_lines) {
+    for (const auto &route : line.routes) {
+      const auto routeIndex{static_cast<RouteIndex>(routeStops.size())};
+      auto &stops{
+        routeStops.emplace_back(m_network.allocator<StationIndex>())};
+      stops.reserve(route->stops.size());
+      for (const auto &stationId : route->stops) {
+        const auto station{resolveStation(stationId)};
+        if (lastRoute[station] != routeIndex) {
+          lastRoute[station] = routeIndex;
+          routeCounts[station]++;
+        }
+
+        stops.push_back(station);
+      }
+    }
+  }
+
+  std::vector<TravelTime> travelTimes;
+  travelTimes.reserve(m_travelTimes.size());
+  for (const auto &travelTime : m_travelTimes) {
+    travelTimes.push_back(TravelTime{
+      .m_startStation = resolveStation(travelTime.startStationId),
+      .m_endStation = resolveStation(travelTime.endStationId),
+      .m_line = m_network.m_lineIds->Find(travelTime.lineId),
+      .m_route = m_network.m_routeIds->Find(travelTime.routeId),
+      .m_travelTime = travelTime.travelTime});
+  }
+
+  for (StationIndex station{0}; station < stationCount; ++station) {
+    (*m_network.m_stations)[station]->m_routes.reserve(routeCounts[station]);
+  }
+
+  auto &lines{m_network.m_lines.Mutable()};
+  lines.reserve(m_lines.size());
+  m_network.mutableRoutes().reserve(routeStops.size());
+
+  RouteIndex route{0};
+  for (LineIndex line{0}; line < m_lines.size(); ++line) {
+    for (const auto &pRoute : m_lines[line].routes) {
+      m_network.attachRoute(line, pRoute, std::move(routeStops[route++]));
+    }
+
+    lines.push_back(std::allocate_shared<Line>(
+      m_network.allocator<Line>(),
+      std::move(m_lines[line])));
+  }
+
+  auto &networkTravelTimes{m_network.mutableTravelTimes()};
+  for (const auto &travelTime : travelTimes) {
+    if (travelTime.m_startStation != travelTime.m_endStation) {
+      networkTravelTimes.insert(travelTime);
+    }
+  }
+
+  m_lines.clear();
+  m_travelTimes.clear();
+
+  // Whatever the network allocates from now on is a change to it.
+  m_pLoadingArena.reset();
+  return std::exchange(m_network, TransportNetwork{m_pMemoryResource});
+}
+
+void TransportNetworkBuilder::EndLoad::operator()(NetworkArena *pArena) const
+{
+  pArena->EndLoad();
+}
+
+void TransportNetworkBuilder::beginLoad()
+{
+  if (!m_pLoadingArena) {
+    if (auto *pArena{Arena(m_network)}) {
+      pArena->BeginLoad();
+      m_pLoadingArena.reset(pArena);
+    }
+  }
+}
+
+} // namespace Structures::TransportNetwork
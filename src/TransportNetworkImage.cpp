@@ -0,0 +1,778 @@
+#include <TransportNetwork/NetworkArena.h>
+#include <TransportNetwork/TransportNetworkImage.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <fstream>
+#include <numeric>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <boost/interprocess/exceptions.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace Structures::TransportNetwork {
+
+static_assert(std::is_trivially_copyable_v<ImageHeader>);
+static_assert(std::is_trivially_copyable_v<ImageStation>);
+static_assert(std::is_trivially_copyable_v<ImageLine>);
+static_assert(std::is_trivially_copyable_v<ImageRoute>);
+static_assert(std::is_trivially_copyable_v<ImageTravelTime>);
+static_assert(sizeof(ImageHeader) % 8 == 0);
+
+namespace {
+
+constexpr std::array<char, 8> kMagic{'L', 'T', 'N', 'S', 'I', 'M', 'G', '\0'};
+constexpr std::uint64_t kAlignment{8};
+
+auto AlignUp(const std::uint64_t offset) -> std::uint64_t
+{
+  return (offset + kAlignment - 1) & ~(kAlignment - 1);
+}
+
+auto Failed(const std::string &what, const std::filesystem::path &path)
+  -> std::runtime_error
+{
+  return std::runtime_error(
+    "(TransportNetworkImage::Write): Failed to " + what + " " + path.string() +
+    ": " + std::system_category().message(errno));
+}
+
+// Makes a file's contents, or with O_DIRECTORY a directory's entries, durable.
+void Sync(const std::filesystem::path &path, const int flags)
+{
+  const auto fd{::open(path.c_str(), flags | O_CLOEXEC)};
+  if (fd < 0) {
+    throw Failed("open", path);
+  }
+
+  if (::fsync(fd) != 0) {
+    // Built before close() can overwrite errno.
+    auto error{Failed("sync", path)};
+    ::close(fd);
+    throw error;
+  }
+
+  ::close(fd);
+}
+
+auto Corrupt(const std::string &what) -> std::runtime_error
+{
+  return std::runtime_error(
+    "(TransportNetworkImage::Load): Corrupt image, " + what);
+}
+
+// Concatenates strings into one blob, storing every distinct string once.
+// Keys point into the network being written.
+class StringTable {
+public:
+  auto Add(std::string_view string) -> ImageString
+  {
+    const auto [it, inserted]{m_strings.try_emplace(string)};
+    if (inserted) {
+      assert(m_data.size() + string.size() < kInvalidId);
+
+      it->second = ImageString{
+        .offset = static_cast<std::uint32_t>(m_data.size()),
+        .size = static_cast<std::uint32_t>(string.size())};
+      m_data.append(string);
+    }
+
+    return it->second;
+  }
+
+  [[nodiscard]] auto Data() const -> const std::string &
+  {
+    return m_data;
+  }
+
+private:
+  std::unordered_map<std::string_view, ImageString> m_strings{};
+  std::string m_data{};
+};
+
+template <typename TResolve>
+auto SortedById(const std::size_t count, TResolve &&resolve)
+  -> std::vector<std::uint32_t>
+{
+  std::vector<std::uint32_t> indices(count);
+  std::iota(indices.begin(), indices.end(), 0U);
+  std::erase_if(indices, [&resolve](const std::uint32_t index) {
+    return !resolve(index).has_value();
+  });
+  std::ranges::sort(indices, {}, [&resolve](const std::uint32_t index) {
+    return *resolve(index);
+  });
+
+  return indices;
+}
+
+template <typename TResolve>
+auto FindById(
+  const std::span<const std::uint32_t> indices,
+  const std::string_view id,
+  TResolve &&resolve) -> std::uint32_t
+{
+  const auto it{std::ranges::lower_bound(indices, id, {}, resolve)};
+  return (it != indices.end() && resolve(*it) == id ? *it : kInvalidId);
+}
+
+auto CurrentRange(const std::size_t first, const std::size_t end)
+  -> ImageRange
+{
+  return ImageRange{
+    .first = static_cast<std::uint32_t>(first),
+    .count = static_cast<std::uint32_t>(end - first)};
+}
+
+} // namespace
+
+void TransportNetworkImage::Write(
+  const TransportNetwork &network,
+  const std::filesystem::path &path,
+  const bool withPassengerCounts)
+{
+  StringTable strings{};
+
+  std::vector<ImageStation> stations;
+  std::vector<RouteIndex> stationRoutes;
+  std::vector<std::uint64_t> passengerCounts;
+  stations.reserve(network.m_stations->size());
+  passengerCounts.reserve(withPassengerCounts ? network.m_stations->size() : 0);
+  for (StationIndex station{0}; station < network.m_stations->size();
+       ++station) {
+    auto &record{stations.emplace_back()};
+    record.id = strings.Add(network.m_stationIds->Resolve(station));
+
+    const auto *pStation{(*network.m_stations)[station].get()};
+    if (withPassengerCounts) {
+      passengerCounts.push_back(
+        pStation ? network.passengerCount(station, *pStation) : 0);
+    }
+
+    if (!pStation) {
+      record.flags = kImageRemoved;
+      continue;
+    }
+
+    record.name = strings.Add(pStation->m_name);
+    const auto first{stationRoutes.size()};
+    for (const auto &pRoute : pStation->m_routes) {
+      stationRoutes.push_back(network.m_routeIds->Find(pRoute->routeId));
+    }
+    record.routes = CurrentRange(first, stationRoutes.size());
+  }
+
+  std::vector<ImageLine> lines;
+  std::vector<RouteIndex> lineRoutes;
+  lines.reserve(network.m_lines->size());
+  for (LineIndex line{0}; line < network.m_lines->size(); ++line) {
+    auto &record{lines.emplace_back()};
+    record.id = strings.Add(network.m_lineIds->Resolve(line));
+
+    const auto *pLine{(*network.m_lines)[line].get()};
+    if (!pLine) {
+      record.flags = kImageRemoved;
+      continue;
+    }
+
+    record.name = strings.Add(pLine->name);
+    const auto first{lineRoutes.size()};
+    for (const auto &pRoute : pLine->routes) {
+      lineRoutes.push_back(network.m_routeIds->Find(pRoute->routeId));
+    }
+    record.routes = CurrentRange(first, lineRoutes.size());
+  }
+
+  std::vector<ImageRoute> routes;
+  std::vector<StationIndex> stops;
+  routes.reserve(network.m_routes->size());
+  for (RouteIndex route{0}; route < network.m_routes->size(); ++route) {
+    const auto &source{(*network.m_routes)[route]};
+    auto &record{routes.emplace_back()};
+    record.id = strings.Add(network.m_routeIds->Resolve(route));
+    if (!source.route) {
+      record.flags = kImageRemoved;
+      continue;
+    }
+
+    record.startStationId = strings.Add(source.route->startStationId);
+    record.endStationId = strings.Add(source.route->endStationId);
+    record.line = source.line;
+    record.direction = static_cast<std::uint32_t>(source.route->direction);
+
+    const auto first{stops.size()};
+    stops.insert(stops.end(), source.stops.begin(), source.stops.end());
+    record.stops = CurrentRange(first, stops.size());
+  }
+
+  const auto stationsById{SortedById(
+    stations.size(),
+    [&](const StationIndex station) -> std::optional<std::string_view> {
+      if (!(*network.m_stations)[station]) {
+        return std::nullopt;
+      }
+      return network.m_stationIds->Resolve(station);
+    })};
+  const auto linesById{SortedById(
+    lines.size(),
+    [&](const LineIndex line) -> std::optional<std::string_view> {
+      if (!(*network.m_lines)[line]) {
+        return std::nullopt;
+      }
+      return network.m_lineIds->Resolve(line);
+    })};
+  const auto routesById{SortedById(
+    routes.size(),
+    [&](const RouteIndex route) -> std::optional<std::string_view> {
+      if (!(*network.m_routes)[route].route) {
+        return std::nullopt;
+      }
+      return network.m_routeIds->Resolve(route);
+    })};
+
+  std::vector<ImageTravelTime> travelTimes;
+  travelTimes.reserve(network.m_travelTimes->size());
+  for (const auto &travelTime : *network.m_travelTimes) {
+    travelTimes.push_back(ImageTravelTime{
+      .startStation = travelTime.m_startStation,
+      .endStation = travelTime.m_endStation,
+      .line = travelTime.m_line,
+      .route = travelTime.m_route,
+      .travelTime = travelTime.m_travelTime});
+  }
+  std::ranges::sort(travelTimes, {}, [](const ImageTravelTime &travelTime) {
+    return std::pair{travelTime.startStation, travelTime.endStation};
+  });
+
+  // Indexed by ImageSectionId.
+  const std::array<std::span<const std::byte>, kImageSectionCount> sections{
+    std::as_bytes(std::span{strings.Data()}),
+    std::as_bytes(std::span{stations}),
+    std::as_bytes(std::span{stationsById}),
+    std::as_bytes(std::span{stationRoutes}),
+    std::as_bytes(std::span{lines}),
+    std::as_bytes(std::span{linesById}),
+    std::as_bytes(std::span{lineRoutes}),
+    std::as_bytes(std::span{routes}),
+    std::as_bytes(std::span{routesById}),
+    std::as_bytes(std::span{stops}),
+    std::as_bytes(std::span{travelTimes}),
+    std::as_bytes(std::span{passengerCounts})};
+
+  ImageHeader header{
+    .magic = kMagic,
+    .version = kImageVersion,
+    .byteOrderMark = kImageByteOrderMark,
+    .flags = withPassengerCounts ? kImageHasPassengerCounts : 0U};
+  std::uint64_t offset{sizeof(ImageHeader)};
+  for (std::size_t i{0}; i < sections.size(); ++i) {
+    header.sections[i] =
+      ImageSection{.offset = offset, .size = sections[i].size()};
+    offset = AlignUp(offset + sections[i].size());
+  }
+  header.size = offset;
+
+  auto temporary{path};
+  temporary += ".tmp";
+  {
+    std::ofstream output{temporary, std::ios::binary | std::ios::trunc};
+    output.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    for (std::size_t i{0}; i < sections.size(); ++i) {
+      constexpr std::array<char, kAlignment> kPadding{};
+      output.write(
+        reinterpret_cast<const char *>(sections[i].data()),
+        static_cast<std::streamsize>(sections[i].size()));
+      output.write(
+        kPadding.data(),
+        static_cast<std::streamsize>(
+          AlignUp(sections[i].size()) - sections[i].size()));
+    }
+
+    output.flush();
+    if (!output) {
+      throw std::runtime_error(
+        "(TransportNetworkImage::Write): Failed to write " +
+        temporary.string());
+    }
+  }
+
+  // The image must be on disk before the rename can make it visible, and the
+  // rename must be before the image counts as written.
+  Sync(temporary, O_WRONLY);
+  std::filesystem::rename(temporary, path);
+  const auto directory{path.parent_path()};
+  Sync(directory.empty() ? "." : directory, O_RDONLY | O_DIRECTORY);
+}
+
+auto TransportNetworkImage::Load(const std::filesystem::path &path)
+  -> TransportNetworkImage
+{
+  namespace ipc = boost::interprocess;
+
+  try {
+    const ipc::file_mapping file{path.c_str(), ipc::read_only};
+    return TransportNetworkImage{ipc::mapped_region{file, ipc::read_only}};
+  }
+  catch (const ipc::interprocess_exception &e) {
+    throw std::runtime_error(
+      "(TransportNetworkImage::Load): Failed to map " + path.string() + ": " +
+      e.what());
+  }
+}
+
+TransportNetworkImage::TransportNetworkImage(
+  boost::interprocess::mapped_region region)
+    : m_region(std::move(region))
+{
+  if (m_region.get_size() < sizeof(ImageHeader)) {
+    throw Corrupt("file is too small");
+  }
+
+  const auto &header{
+    *static_cast<const ImageHeader *>(m_region.get_address())};
+  if (header.magic != kMagic) {
+    throw Corrupt("bad magic");
+  }
+
+  if (header.byteOrderMark != kImageByteOrderMark) {
+    throw Corrupt("byte order differs from this machine's");
+  }
+
+  if (header.version != kImageVersion) {
+    throw Corrupt(
+      "version=" + std::to_string(header.version) +
+      " differs from supported version=" + std::to_string(kImageVersion));
+  }
+
+  if (header.size != m_region.get_size()) {
+    throw Corrupt("file is truncated");
+  }
+
+  for (const auto &section : header.sections) {
+    if (section.offset % kAlignment != 0 || section.offset > header.size ||
+        section.size > header.size - section.offset) {
+      throw Corrupt("section out of bounds");
+    }
+  }
+
+  m_flags = header.flags;
+  const auto strings{section<char>(ImageSectionId::kStrings)};
+  m_strings = std::string_view{strings.data(), strings.size()};
+  m_stations = section<ImageStation>(ImageSectionId::kStations);
+  m_stationsById = section<StationIndex>(ImageSectionId::kStationsById);
+  m_stationRoutes = section<RouteIndex>(ImageSectionId::kStationRoutes);
+  m_lines = section<ImageLine>(ImageSectionId::kLines);
+  m_linesById = section<LineIndex>(ImageSectionId::kLinesById);
+  m_lineRoutes = section<RouteIndex>(ImageSectionId::kLineRoutes);
+  m_routes = section<ImageRoute>(ImageSectionId::kRoutes);
+  m_routesById = section<RouteIndex>(ImageSectionId::kRoutesById);
+  m_stops = section<StationIndex>(ImageSectionId::kStops);
+  m_travelTimes = section<ImageTravelTime>(ImageSectionId::kTravelTimes);
+  m_passengerCounts =
+    section<std::uint64_t>(ImageSectionId::kPassengerCounts);
+
+  validate();
+}
+
+auto TransportNetworkImage::HasPassengerCounts() const -> bool
+{
+  return (m_flags & kImageHasPassengerCounts) != 0;
+}
+
+auto TransportNetworkImage::GetStationCount() const -> std::size_t
+{
+  return m_stations.size();
+}
+
+auto TransportNetworkImage::GetStationIndex(
+  const std::string_view stationId) const -> StationIndex
+{
+  return FindById(m_stationsById, stationId, [this](StationIndex station) {
+    return string(m_stations[station].id);
+  });
+}
+
+auto TransportNetworkImage::IsStationRemoved(const StationIndex station) const
+  -> bool
+{
+  assert(station < m_stations.size());
+  return (m_stations[station].flags & kImageRemoved) != 0;
+}
+
+auto TransportNetworkImage::GetStationId(const StationIndex station) const
+  -> std::string_view
+{
+  assert(station < m_stations.size());
+  return string(m_stations[station].id);
+}
+
+auto TransportNetworkImage::GetStationName(const StationIndex station) const
+  -> std::string_view
+{
+  assert(station < m_stations.size());
+  return string(m_stations[station].name);
+}
+
+auto TransportNetworkImage::GetRoutesServingStation(
+  const StationIndex station) const -> std::span<const RouteIndex>
+{
+  assert(station < m_stations.size());
+
+  const auto routes{m_stations[station].routes};
+  return m_stationRoutes.subspan(routes.first, routes.count);
+}
+
+auto TransportNetworkImage::GetPassengerCount(const StationIndex station) const
+  -> std::size_t
+{
+  assert(station < m_stations.size());
+  return (m_passengerCounts.empty() ? 0 : m_passengerCounts[station]);
+}
+
+auto TransportNetworkImage::GetLineCount() const -> std::size_t
+{
+  return m_lines.size();
+}
+
+auto TransportNetworkImage::GetLineIndex(const std::string_view lineId) const
+  -> LineIndex
+{
+  return FindById(m_linesById, lineId, [this](LineIndex line) {
+    return string(m_lines[line].id);
+  });
+}
+
+auto TransportNetworkImage::IsLineRemoved(const LineIndex line) const -> bool
+{
+  assert(line < m_lines.size());
+  return (m_lines[line].flags & kImageRemoved) != 0;
+}
+
+auto TransportNetworkImage::GetLineId(const LineIndex line) const
+  -> std::string_view
+{
+  assert(line < m_lines.size());
+  return string(m_lines[line].id);
+}
+
+auto TransportNetworkImage::GetLineName(const LineIndex line) const
+  -> std::string_view
+{
+  assert(line < m_lines.size());
+  return string(m_lines[line].name);
+}
+
+auto TransportNetworkImage::GetLineRoutes(const LineIndex line) const
+  -> std::span<const RouteIndex>
+{
+  assert(line < m_lines.size());
+
+  const auto routes{m_lines[line].routes};
+  return m_lineRoutes.subspan(routes.first, routes.count);
+}
+
+auto TransportNetworkImage::GetRouteCount() const -> std::size_t
+{
+  return m_routes.size();
+}
+
+auto TransportNetworkImage::GetRouteIndex(const std::string_view routeId) const
+  -> RouteIndex
+{
+  return FindById(m_routesById, routeId, [this](RouteIndex route) {
+    return string(m_routes[route].id);
+  });
+}
+
+auto TransportNetworkImage::IsRouteRemoved(const RouteIndex route) const
+  -> bool
+{
+  assert(route < m_routes.size());
+  return (m_routes[route].flags & kImageRemoved) != 0;
+}
+
+auto TransportNetworkImage::GetRouteId(const RouteIndex route) const
+  -> std::string_view
+{
+  assert(route < m_routes.size());
+  return string(m_routes[route].id);
+}
+
+auto TransportNetworkImage::GetRouteLine(const RouteIndex route) const
+  -> LineIndex
+{
+  assert(route < m_routes.size());
+  return m_routes[route].line;
+}
+
+auto TransportNetworkImage::GetRouteDirection(const RouteIndex route) const
+  -> RouteDirection
+{
+  assert(route < m_routes.size());
+  return static_cast<RouteDirection>(m_routes[route].direction);
+}
+
+auto TransportNetworkImage::GetRouteStops(const RouteIndex route) const
+  -> std::span<const StationIndex>
+{
+  assert(route < m_routes.size());
+
+  const auto stops{m_routes[route].stops};
+  return m_stops.subspan(stops.first, stops.count);
+}
+
+auto TransportNetworkImage::GetTravelTimeCount() const -> std::size_t
+{
+  return m_travelTimes.size();
+}
+
+auto TransportNetworkImage::GetTravelTime(
+  const StationIndex start,
+  const StationIndex end) const -> unsigned int
+{
+  const auto key{[](const ImageTravelTime &travelTime) {
+    return std::pair{travelTime.startStation, travelTime.endStation};
+  }};
+  const auto it{std::ranges::lower_bound(
+    m_travelTimes,
+    std::pair{start, end},
+    {},
+    key)};
+
+  return (
+    it != m_travelTimes.end() && key(*it) == std::pair{start, end}
+      ? it->travelTime
+      : 0);
+}
+
+auto TransportNetworkImage::ToNetwork(
+  std::shared_ptr<std::pmr::memory_resource> pMemoryResource) const
+  -> TransportNetwork
+{
+  TransportNetwork network{std::move(pMemoryResource)};
+  auto *pArena{dynamic_cast<NetworkArena *>(network.m_pMemoryResource.get())};
+  if (pArena) {
+    pArena->BeginLoad();
+  }
+
+  // Ids are interned in index order, removed ones included, so that the
+  // indices the image refers to by are the network's as well.
+  auto &stationIds{network.mutableIds(network.m_stationIds)};
+  auto &stations{network.m_stations.Mutable()};
+  stationIds.Reserve(m_stations.size());
+  stations.reserve(m_stations.size());
+  for (StationIndex station{0}; station < m_stations.size(); ++station) {
+    StationId stationId{GetStationId(station)};
+    stationIds.Intern(stationId);
+    if (IsStationRemoved(station)) {
+      stations.emplace_back();
+      continue;
+    }
+
+    stations.push_back(std::allocate_shared<Station>(
+      network.allocator<Station>(),
+      std::move(stationId),
+      StationName{GetStationName(station)},
+      GetPassengerCount(station)));
+    network.track(station, *stations.back());
+  }
+
+  auto &lineIds{network.mutableIds(network.m_lineIds)};
+  lineIds.Reserve(m_lines.size());
+  for (LineIndex line{0}; line < m_lines.size(); ++line) {
+    lineIds.Intern(LineId{GetLineId(line)});
+  }
+
+  auto &routeIds{network.mutableIds(network.m_routeIds)};
+  auto &routes{network.mutableRoutes()};
+  routeIds.Reserve(m_routes.size());
+  routes.reserve(m_routes.size());
+  StopSequencePool stopSequences{};
+  for (RouteIndex route{0}; route < m_routes.size(); ++route) {
+    const auto &record{m_routes[route]};
+    RouteId routeId{string(record.id)};
+    routeIds.Intern(routeId);
+    if (IsRouteRemoved(route)) {
+      routes.emplace_back();
+      continue;
+    }
+
+    const auto stops{GetRouteStops(route)};
+    StopSequence::Stops stopIds;
+    stopIds.reserve(stops.size());
+    for (const auto station : stops) {
+      stopIds.emplace_back(GetStationId(station));
+    }
+
+    routes.push_back(RouteRecord{
+      .line = record.line,
+      .stops{stops.begin(), stops.end(), network.allocator<StationIndex>()},
+      .route = std::make_shared<Route>(Route{
+        .lineId = lineIds.Resolve(record.line),
+        .routeId = std::move(routeId),
+        .direction = GetRouteDirection(route),
+        .startStationId = StationId{string(record.startStationId)},
+        .endStationId = StationId{string(record.endStationId)},
+        .stops = stopSequences.Intern(std::move(stopIds))})});
+  }
+
+  const auto routesOf{[&routes](const std::span<const RouteIndex> indices) {
+    std::vector<std::shared_ptr<Route>> result;
+    result.reserve(indices.size());
+    for (const auto route : indices) {
+      result.push_back(routes[route].route);
+    }
+
+    return result;
+  }};
+
+  for (StationIndex station{0}; station < m_stations.size(); ++station) {
+    if (const auto &pStation{stations[station]}) {
+      pStation->m_routes = routesOf(GetRoutesServingStation(station));
+    }
+  }
+
+  auto &lines{network.m_lines.Mutable()};
+  lines.reserve(m_lines.size());
+  for (LineIndex line{0}; line < m_lines.size(); ++line) {
+    if (IsLineRemoved(line)) {
+      lines.emplace_back();
+      continue;
+    }
+
+    lines.push_back(std::allocate_shared<Line>(
+      network.allocator<Line>(),
+      Line{
+        .id = lineIds.Resolve(line),
+        .name = std::string{GetLineName(line)},
+        .routes = routesOf(GetLineRoutes(line))}));
+  }
+
+  auto &travelTimes{network.mutableTravelTimes()};
+  travelTimes.reserve(m_travelTimes.size());
+  for (const auto &travelTime : m_travelTimes) {
+    travelTimes.insert(TravelTime{
+      .m_startStation = travelTime.startStation,
+      .m_endStation = travelTime.endStation,
+      .m_line = travelTime.line,
+      .m_route = travelTime.route,
+      .m_travelTime = travelTime.travelTime});
+  }
+
+  if (pArena) {
+    pArena->EndLoad();
+  }
+
+  return network;
+}
+
+template <typename T>
+auto TransportNetworkImage::section(const ImageSectionId id) const
+  -> std::span<const T>
+{
+  const auto &header{
+    *static_cast<const ImageHeader *>(m_region.get_address())};
+  const auto &section{header.sections[static_cast<std::size_t>(id)]};
+  if (section.size % sizeof(T) != 0) {
+    throw Corrupt("section size is not a multiple of its records");
+  }
+
+  return {
+    reinterpret_cast<const T *>(
+      static_cast<const char *>(m_region.get_address()) + section.offset),
+    section.size / sizeof(T)};
+}
+
+auto TransportNetworkImage::string(const ImageString string) const
+  -> std::string_view
+{
+  return m_strings.substr(string.offset, string.size);
+}
+
+void TransportNetworkImage::validate() const
+{
+  const auto checkString{[this](const ImageString string) {
+    if (string.offset > m_strings.size() ||
+        string.size > m_strings.size() - string.offset) {
+      throw Corrupt("string out of bounds");
+    }
+  }};
+  const auto checkRange{[](const ImageRange range, const std::size_t size) {
+    if (range.first > size || range.count > size - range.first) {
+      throw Corrupt("range out of bounds");
+    }
+  }};
+  const auto checkIndices{[](const auto indices, const std::size_t size) {
+    if (!std::ranges::all_of(indices, [size](auto i) { return i < size; })) {
+      throw Corrupt("index out of bounds");
+    }
+  }};
+  const auto checkOptional{
+    [](const std::uint32_t index, const std::size_t size) {
+      if (index != kInvalidId && index >= size) {
+        throw Corrupt("index out of bounds");
+      }
+    }};
+
+  if (m_stations.size() >= kInvalidId || m_lines.size() >= kInvalidId ||
+      m_routes.size() >= kInvalidId) {
+    throw Corrupt("too many records");
+  }
+
+  if (m_passengerCounts.size() !=
+      (HasPassengerCounts() ? m_stations.size() : 0)) {
+    throw Corrupt("passenger counts do not match stations");
+  }
+
+  for (const auto &station : m_stations) {
+    checkString(station.id);
+    checkString(station.name);
+    checkRange(station.routes, m_stationRoutes.size());
+  }
+
+  for (const auto &line : m_lines) {
+    checkString(line.id);
+    checkString(line.name);
+    checkRange(line.routes, m_lineRoutes.size());
+  }
+
+  for (const auto &route : m_routes) {
+    checkString(route.id);
+    checkString(route.startStationId);
+    checkString(route.endStationId);
+    checkRange(route.stops, m_stops.size());
+    checkOptional(route.line, m_lines.size());
+    if (route.direction >=
+        static_cast<std::uint32_t>(RouteDirection::kSizeOfEnum)) {
+      throw Corrupt("unknown route direction");
+    }
+  }
+
+  for (const auto &travelTime : m_travelTimes) {
+    checkIndices(
+      std::array{travelTime.startStation, travelTime.endStation},
+      m_stations.size());
+    checkOptional(travelTime.line, m_lines.size());
+    checkOptional(travelTime.route, m_routes.size());
+  }
+
+  checkIndices(m_stationsById, m_stations.size());
+  checkIndices(m_stationRoutes, m_routes.size());
+  checkIndices(m_linesById, m_lines.size());
+  checkIndices(m_lineRoutes, m_routes.size());
+  checkIndices(m_routesById, m_routes.size());
+  checkIndices(m_stops, m_stations.size());
+}
+
+} // namespace Structures::TransportNetwork
@@ -1 +1,176 @@
 #include <TransportNetwork/TransportNetworkParser.h>
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+namespace Structures::TransportNetwork {
+
+namespace {
+
+using boost::property_tree::ptree;
+
+auto ParseDirection(const std::string &direction) -> RouteDirection
+{
+  if (direction == "inbound") {
+    return RouteDirection::kInbound;
+  }
+
+  if (direction == "outbound") {
+    return RouteDirection::kOutbound;
+  }
+
+  throw std::runtime_error(
+    "(TransportNetworkParser): Unknown route direction=" + direction);
+}
+
+auto ParseRoute(const ptree &node, StopSequencePool &stopSequences) -> Route
+{
+  Route route{
+    .lineId{node.get<LineId>("line_id")},
+    .routeId{node.get<RouteId>("route_id")},
+    .direction = ParseDirection(node.get<std::string>("direction")),
+    .startStationId{node.get<StationId>("start_station_id")},
+    .endStationId{node.get<StationId>("end_station_id")}};
+
+  const auto &stopNodes{node.get_child("route_stops")};
+  StopSequence::Stops stops;
+  stops.reserve(stopNodes.size());
+  for (const auto &[key, stop] : stopNodes) {
+    stops.push_back(stop.get_value<StationId>());
+  }
+
+  route.stops = stopSequences.Intern(std::move(stops));
+  return route;
+}
+
+auto ParsePassengerEventType(const std::string &type) -> PassengerEvent::Type
+{
+  if (type == "in") {
+    return PassengerEvent::Type::kIn;
+  }
+
+  if (type == "out") {
+    return PassengerEvent::Type::kOut;
+  }
+
+  throw std::runtime_error(
+    "(TransportNetworkParser): Unknown passenger event=" + type);
+}
+
+} // namespace
+
+auto TransportNetworkParser::Parse(std::istream &input) -> NetworkLayout
+{
+  ptree root;
+  try {
+    boost::property_tree::read_json(input, root);
+
+    NetworkLayout layout{};
+
+    const auto &stations{root.get_child("stations")};
+    layout.stations.reserve(stations.size());
+    for (const auto &[key, node] : stations) {
+      layout.stations.emplace_back(
+        node.get<StationId>("station_id"),
+        node.get<StationName>("name"));
+    }
+
+    // Both directions of a line usually stop at the same stations.
+    StopSequencePool stopSequences{};
+    const auto &lines{root.get_child("lines")};
+    layout.lines.reserve(lines.size());
+    for (const auto &[key, node] : lines) {
+      auto &line{layout.lines.emplace_back(Line{
+        .id{node.get<LineId>("line_id")},
+        .name{node.get<std::string>("name")}})};
+
+      for (const auto &[routeKey, routeNode] : node.get_child("routes")) {
+        line.routes.push_back(
+          std::make_shared<Route>(ParseRoute(routeNode, stopSequences)));
+      }
+    }
+
+    const auto &travelTimes{root.get_child("travel_times")};
+    layout.travelTimes.reserve(travelTimes.size());
+    for (const auto &[key, node] : travelTimes) {
+      layout.travelTimes.push_back(LayoutTravelTime{
+        .startStationId{node.get<StationId>("start_station_id")},
+        .endStationId{node.get<StationId>("end_station_id")},
+        .lineId{node.get<LineId>("line_id", "")},
+        .routeId{node.get<RouteId>("route_id", "")},
+        .travelTime = node.get<unsigned int>("travel_time")});
+    }
+
+    return layout;
+  }
+  catch (const boost::property_tree::ptree_error &error) {
+    throw std::runtime_error(
+      std::string{"(TransportNetworkParser::Parse): "} + error.what());
+  }
+}
+
+auto TransportNetworkParser::ParseFile(const std::string &path)
+  -> NetworkLayout
+{
+  std::ifstream input{path};
+  if (!input) {
+    throw std::runtime_error(
+      "(TransportNetworkParser::ParseFile): Unable to open " + path);
+  }
+
+  return Parse(input);
+}
+
+auto TransportNetworkParser::ParsePassengerEvents(std::istream &input)
+  -> std::vector<PassengerEvent>
+{
+  std::vector<PassengerEvent> events{};
+  std::string line{};
+  try {
+    while (std::getline(input, line)) {
+      if (line.find_first_not_of(" \t\r") == std::string::npos) {
+        continue;
+      }
+
+      ptree node;
+      std::istringstream lineInput{line};
+      boost::property_tree::read_json(lineInput, node);
+
+      events.push_back(PassengerEvent{
+        .m_stationId{node.get<StationId>("station_id")},
+        .m_type =
+          ParsePassengerEventType(node.get<std::string>("passenger_event")),
+        .m_timestamp = PassengerTimestamp{std::chrono::microseconds{
+          node.get<std::int64_t>("timestamp", 0)}}});
+    }
+  }
+  catch (const boost::property_tree::ptree_error &error) {
+    throw std::runtime_error(
+      std::string{"(TransportNetworkParser::ParsePassengerEvents): "} +
+      error.what());
+  }
+
+  return events;
+}
+
+auto TransportNetworkParser::ParsePassengerEventsFile(const std::string &path)
+  -> std::vector<PassengerEvent>
+{
+  std::ifstream input{path};
+  if (!input) {
+    throw std::runtime_error(
+      "(TransportNetworkParser::ParsePassengerEventsFile): Unable to open " +
+      path);
+  }
+
+  return ParsePassengerEvents(input);
+}
+
+} // namespace Structures::TransportNetwork
@@ -0,0 +1,43 @@
+#include <TransportNetwork/TransportNetworkSnapshots.h>
+
+#include <utility>
+
+namespace Structures::TransportNetwork {
+
+TransportNetworkSnapshots::TransportNetworkSnapshots(TransportNetwork network)
+    : m_current{std::make_shared<const TransportNetwork>(std::move(network))}
+{
+}
+
+auto TransportNetworkSnapshots::Acquire() const -> Snapshot
+{
+  return m_current.load(std::memory_order_acquire);
+}
+
+auto TransportNetworkSnapshots::GetVersion() const -> std::uint64_t
+{
+  return m_version.load(std::memory_order_acquire);
+}
+
+void TransportNetworkSnapshots::Publish(TransportNetwork network)
+{
+  auto next{std::make_shared<const TransportNetwork>(std::move(network))};
+
+  const std::scoped_lock lock{m_writerMutex};
+  m_current.store(std::move(next), std::memory_order_release);
+  m_version.fetch_add(1, std::memory_order_acq_rel);
+}
+
+void TransportNetworkSnapshots::Update(
+  const std::function<void(TransportNetwork &)> &update)
+{
+  const std::scoped_lock lock{m_writerMutex};
+
+  auto next{std::make_shared<TransportNetwork>(*Acquire())};
+  update(*next);
+
+  m_current.store(std::move(next), std::memory_order_release);
+  m_version.fetch_add(1, std::memory_order_acq_rel);
+}
+
+} // namespace Structures::TransportNetwork
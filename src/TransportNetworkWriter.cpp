@@ -0,0 +1,229 @@
+#include <TransportNetwork/TransportNetworkWriter.h>
+
+#include <chrono>
+#include <fstream>
+#include <ios>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+namespace Structures::TransportNetwork {
+
+namespace {
+
+void WriteString(std::ostream &output, const std::string_view string)
+{
+  constexpr std::string_view kHexDigits{"0123456789abcdef"};
+
+  output << '"';
+  for (const auto character : string) {
+    const auto code{static_cast<unsigned char>(character)};
+    if (character == '"' || character == '\\') {
+      output << '\\' << character;
+    }
+    else if (code < 0x20) {
+      output << "\\u00" << kHexDigits[code >> 4U] << kHexDigits[code & 0xFU];
+    }
+    else {
+      output << character;
+    }
+  }
+
+  output << '"';
+}
+
+// Writes "key": "value", indented by depth levels of four spaces.
+void WriteField(
+  std::ostream &output,
+  const std::size_t depth,
+  const std::string_view key,
+  const std::string_view value,
+  const bool last = false)
+{
+  output << std::string(4 * depth, ' ');
+  WriteString(output, key);
+  output << ": ";
+  WriteString(output, value);
+  output << (last ? "\n" : ",\n");
+}
+
+template <typename TRange>
+void WriteStrings(
+  std::ostream &output,
+  const std::size_t depth,
+  const std::string_view key,
+  const TRange &strings,
+  const bool last = false)
+{
+  const std::string indent(4 * depth, ' ');
+  output << indent;
+  WriteString(output, key);
+  output << ": [";
+
+  auto first{true};
+  for (const auto &string : strings) {
+    output << (first ? "\n" : ",\n") << indent << "    ";
+    WriteString(output, string);
+    first = false;
+  }
+
+  output << (first ? "" : "\n" + indent) << (last ? "]\n" : "],\n");
+}
+
+void WriteRoute(std::ostream &output, const Route &route)
+{
+  WriteField(output, 5, "line_id", route.lineId);
+  WriteField(output, 5, "route_id", route.routeId);
+  WriteField(
+    output,
+    5,
+    "direction",
+    route.direction == RouteDirection::kInbound ? "inbound" : "outbound");
+  WriteField(output, 5, "start_station_id", route.startStationId);
+  WriteField(output, 5, "end_station_id", route.endStationId);
+  WriteStrings(output, 5, "route_stops", route.stops, true);
+}
+
+void WriteLine(std::ostream &output, const Line &line)
+{
+  WriteField(output, 3, "line_id", line.id);
+  WriteField(output, 3, "name", line.name);
+
+  output << "            \"routes\": [";
+  std::vector<StationId> stations{};
+  std::unordered_set<StationId> seen{};
+  for (std::size_t i{0}; i < line.routes.size(); ++i) {
+    output << (i == 0 ? "\n" : ",\n") << "                {\n";
+    WriteRoute(output, *line.routes[i]);
+    output << "                }";
+
+    for (const auto &stop : line.routes[i]->stops) {
+      if (seen.insert(stop).second) {
+        stations.push_back(stop);
+      }
+    }
+  }
+
+  output << (line.routes.empty() ? "],\n" : "\n            ],\n");
+
+  // Every station the line stops at, in the order its routes reach them.
+  WriteStrings(output, 3, "stations", stations, true);
+}
+
+void WriteTravelTime(std::ostream &output, const LayoutTravelTime &travelTime)
+{
+  WriteField(output, 3, "start_station_id", travelTime.startStationId);
+  WriteField(output, 3, "end_station_id", travelTime.endStationId);
+  if (!travelTime.lineId.empty()) {
+    WriteField(output, 3, "line_id", travelTime.lineId);
+  }
+
+  if (!travelTime.routeId.empty()) {
+    WriteField(output, 3, "route_id", travelTime.routeId);
+  }
+
+  output << "            \"travel_time\": " << travelTime.travelTime << '\n';
+}
+
+// Writes the objects of an array keyed by key, each by writeObject.
+template <typename TRange, typename TWriteObject>
+void WriteObjects(
+  std::ostream &output,
+  const std::string_view key,
+  const TRange &objects,
+  TWriteObject &&writeObject,
+  const bool last = false)
+{
+  output << "    ";
+  WriteString(output, key);
+  output << ": [";
+
+  auto first{true};
+  for (const auto &object : objects) {
+    output << (first ? "\n" : ",\n") << "        {\n";
+    writeObject(output, object);
+    output << "        }";
+    first = false;
+  }
+
+  output << (first ? "" : "\n    ") << (last ? "]\n" : "],\n");
+}
+
+template <typename TWrite>
+void WriteToFile(const std::string &path, TWrite &&write)
+{
+  std::ofstream output{path, std::ios::binary};
+  if (output) {
+    write(output);
+    output.flush();
+  }
+
+  if (!output) {
+    throw std::runtime_error(
+      "(TransportNetworkWriter): Unable to write " + path);
+  }
+}
+
+} // namespace
+
+void TransportNetworkWriter::Write(
+  const NetworkLayout &layout,
+  std::ostream &output)
+{
+  output << "{\n";
+  WriteObjects(output, "lines", layout.lines, WriteLine);
+  WriteObjects(
+    output,
+    "stations",
+    layout.stations,
+    [](std::ostream &stream, const Station &station) {
+      WriteField(stream, 3, "station_id", station.m_id);
+      WriteField(stream, 3, "name", station.m_name, true);
+    });
+  WriteObjects(
+    output,
+    "travel_times",
+    layout.travelTimes,
+    WriteTravelTime,
+    true);
+  output << "}\n";
+}
+
+void TransportNetworkWriter::WriteFile(
+  const NetworkLayout &layout,
+  const std::string &path)
+{
+  WriteToFile(path, [&layout](std::ostream &output) {
+    Write(layout, output);
+  });
+}
+
+void TransportNetworkWriter::WritePassengerEvents(
+  const std::span<const PassengerEvent> events,
+  std::ostream &output)
+{
+  for (const auto &event : events) {
+    output << "{\"station_id\": ";
+    WriteString(output, event.m_stationId);
+    output << ", \"passenger_event\": \""
+           << (event.m_type == PassengerEvent::Type::kIn ? "in" : "out")
+           << "\", \"timestamp\": "
+           << std::chrono::duration_cast<std::chrono::microseconds>(
+                event.m_timestamp.time_since_epoch())
+                .count()
+           << "}\n";
+  }
+}
+
+void TransportNetworkWriter::WritePassengerEventsFile(
+  const std::span<const PassengerEvent> events,
+  const std::string &path)
+{
+  WriteToFile(path, [events](std::ostream &output) {
+    WritePassengerEvents(events, output);
+  });
+}
+
+} // namespace Structures::TransportNetwork
@@ -0,0 +1,80 @@
+#include <TransportNetwork/MemoryUsage.h>
+#include <TransportNetwork/TravelTimeMatrix.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <thread>
+
+namespace Structures::TransportNetwork {
+
+TravelTimeMatrix::TravelTimeMatrix(
+  const TransportGraph &graph,
+  const ItineraryOptions &options,
+  const std::size_t threadCount)
+    : m_stationCount(graph.GetStationCount()),
+      m_times(m_stationCount * m_stationCount, kUnreachable)
+{
+  // Threads claim start stations one at a time; searches vary too much in
+  // cost for a static split to balance.
+  std::atomic<StationIndex> nextStart{0};
+  const auto work{[this, &graph, &options, &nextStart]() {
+    thread_local std::vector<unsigned int> tTimes;
+    tTimes.resize(m_stationCount);
+
+    for (auto start{nextStart.fetch_add(1, std::memory_order_relaxed)};
+         start < m_stationCount;
+         start = nextStart.fetch_add(1, std::memory_order_relaxed)) {
+      FindTravelTimes(graph, start, options, tTimes);
+      std::ranges::transform(
+        tTimes,
+        m_times.begin() + static_cast<std::ptrdiff_t>(start * m_stationCount),
+        [](const unsigned int time) {
+          return time == kUnreachableTime
+                   ? kUnreachable
+                   : static_cast<Time>(std::min<unsigned int>(time, kMaxTime));
+        });
+    }
+  }};
+
+  const auto workers{std::max<std::size_t>(
+    std::min(threadCount, m_stationCount),
+    1)};
+  std::vector<std::jthread> threads;
+  threads.reserve(workers - 1);
+  for (std::size_t i{1}; i < workers; ++i) {
+    threads.emplace_back(work);
+  }
+
+  work();
+}
+
+auto TravelTimeMatrix::GetStationCount() const -> std::size_t
+{
+  return m_stationCount;
+}
+
+auto TravelTimeMatrix::Get(const StationIndex start, const StationIndex end)
+  const -> Time
+{
+  if (start >= m_stationCount || end >= m_stationCount) {
+    return kUnreachable;
+  }
+
+  return m_times[start * m_stationCount + end];
+}
+
+auto TravelTimeMatrix::GetRow(const StationIndex start) const
+  -> std::span<const Time>
+{
+  assert(start < m_stationCount);
+
+  return {m_times.data() + start * m_stationCount, m_stationCount};
+}
+
+auto TravelTimeMatrix::GetMemoryUsage() const -> std::size_t
+{
+  return HeapBytes(m_times);
+}
+
+} // namespace Structures::TransportNetwork
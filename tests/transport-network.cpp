@@ -1,11 +1,31 @@
+#include <Structures/TransportNetwork/LayoutGenerator.h>
+#include <Structures/TransportNetwork/PassengerEventJournal.h>
+#include <Structures/TransportNetwork/PassengerEventReplay.h>
+#include <Structures/TransportNetwork/ShardedPassengerIngestor.h>
 #include <Structures/TransportNetwork/TransportNetwork.h>
+#include <Structures/TransportNetwork/TransportNetworkBuilder.h>
+#include <Structures/TransportNetwork/TransportNetworkImage.h>
 #include <Structures/TransportNetwork/TransportNetworkParser.h>
+#include <Structures/TransportNetwork/TransportNetworkSnapshots.h>
+#include <Structures/TransportNetwork/TransportNetworkWriter.h>
 
 #include <boost/mpl/begin_end.hpp>
 #include <boost/test/tools/old/interface.hpp>
 #include <boost/test/unit_test.hpp>
 #include <boost/test/unit_test_suite.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <memory_resource>
+#include <optional>
+#include <random>
+#include <ranges>
+#include <sstream>
 #include <stdexcept>
+#include <thread>
+#include <unordered_map>
 
 using namespace Structures::TransportNetwork;
 
@@ -413,4 +433,2052 @@ BOOST_AUTO_TEST_CASE(RecordPassengerEventWithWrongType)
   BOOST_CHECK_EQUAL(tn.GetPassengerCount(endStationId), 0);
 }
 
+BOOST_AUTO_TEST_CASE(StationIndicesAreDense)
+{
+  TransportNetwork tn{};
+
+  const Station st1("station_001", "Bagramyan");
+  const Station st2("station_002", "Yeritasardakan");
+
+  BOOST_CHECK(tn.AddStation(st1));
+  BOOST_CHECK(tn.AddStation(st2));
+  BOOST_CHECK(!tn.AddStation(st1));
+
+  BOOST_CHECK_EQUAL(tn.GetStationCount(), 2);
+  BOOST_CHECK_EQUAL(tn.GetStationIndex(st1.m_id), 0);
+  BOOST_CHECK_EQUAL(tn.GetStationIndex(st2.m_id), 1);
+  BOOST_CHECK_EQUAL(tn.GetStationIndex("station_003"), kInvalidId);
+  BOOST_CHECK_EQUAL(tn.GetStationId(1), st2.m_id);
+  BOOST_CHECK(*tn.GetStation(StationIndex{1}) == st2);
+  BOOST_CHECK(tn.GetStation(StationIndex{2}) == nullptr);
+
+  BOOST_CHECK(tn.RecordPassengerEvent(0, PassengerEvent::Type::kIn));
+  BOOST_CHECK_EQUAL(tn.GetPassengerCount(st1.m_id), 1);
+  BOOST_CHECK(!tn.RecordPassengerEvent(kInvalidId, PassengerEvent::Type::kIn));
+
+  BOOST_CHECK(tn.SetTravelTime(0, 1, 7));
+  BOOST_CHECK_EQUAL(tn.GetTravelTime(st1.m_id, st2.m_id), 7);
+  BOOST_CHECK(!tn.SetTravelTime(st1.m_id, "station_003", 7));
+  BOOST_CHECK_EQUAL(tn.GetTravelTime(st1.m_id, "station_003"), 0);
+}
+
+BOOST_AUTO_TEST_CASE(AddLineWithDuplicateRouteId)
+{
+  TransportNetwork tn{};
+
+  const StationId startStationId{"station_001"};
+  const StationId endStationId{"station_002"};
+  const Route rt1{
+    .lineId{"line_001"},
+    .routeId{"route_001"},
+    .direction = RouteDirection::kInbound,
+    .startStationId{startStationId},
+    .endStationId{endStationId},
+    .stops{startStationId, endStationId}};
+  Route rt2{rt1};
+  rt2.lineId = "line_002";
+  const Line ln1{
+    .id{"line_001"},
+    .name{"bagyer"},
+    .routes{std::make_shared<Route>(rt1)}};
+  const Line ln2{
+    .id{"line_002"},
+    .name{"yerbag"},
+    .routes{std::make_shared<Route>(rt2)}};
+
+  BOOST_CHECK(tn.AddStation(Station(startStationId, "Bagramyan")));
+  BOOST_CHECK(tn.AddStation(Station(endStationId, "Yeritasardakan")));
+  BOOST_CHECK(tn.AddLine(ln1));
+  BOOST_CHECK(!tn.AddLine(ln1));
+  BOOST_CHECK_THROW(tn.AddLine(ln2), std::logic_error);
+  BOOST_CHECK(tn.GetLine("line_002") == nullptr);
+  BOOST_CHECK_EQUAL(tn.GetRoutesServingStation(startStationId).size(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(BuildGraphFromRoutes)
+{
+  TransportNetwork tn{};
+
+  const LineId lineId{"line_001"};
+  const StationId st1Id{"station_001"};
+  const StationId st2Id{"station_002"};
+  const StationId st3Id{"station_003"};
+  const Route inbound{
+    .lineId{lineId},
+    .routeId{"route_001"},
+    .direction = RouteDirection::kInbound,
+    .startStationId{st1Id},
+    .endStationId{st3Id},
+    .stops{st1Id, st2Id, st3Id}};
+  const Route outbound{
+    .lineId{lineId},
+    .routeId{"route_002"},
+    .direction = RouteDirection::kOutbound,
+    .startStationId{st3Id},
+    .endStationId{st1Id},
+    .stops{st3Id, st2Id, st1Id}};
+  const Line ln1{
+    .id{lineId},
+    .name{"bagyer"},
+    .routes{
+      std::make_shared<Route>(inbound),
+      std::make_shared<Route>(outbound)}};
+
+  BOOST_CHECK(tn.AddStation(Station(st1Id, "Bagramyan")));
+  BOOST_CHECK(tn.AddStation(Station(st2Id, "Yeritasardakan")));
+  BOOST_CHECK(tn.AddStation(Station(st3Id, "SasuntsiDavid")));
+  BOOST_CHECK(tn.AddLine(ln1));
+  BOOST_CHECK(tn.SetTravelTime(st1Id, st2Id, 3));
+  BOOST_CHECK(tn.SetTravelTime(st2Id, st3Id, 4));
+  BOOST_CHECK(tn.GetGraph() == nullptr);
+
+  tn.BuildGraph();
+  const auto pGraph{tn.GetGraph()};
+  BOOST_REQUIRE(pGraph != nullptr);
+  BOOST_CHECK_EQUAL(pGraph->GetStationCount(), 3);
+  BOOST_CHECK_EQUAL(pGraph->GetEdgeCount(), 4);
+
+  const auto st2{tn.GetStationIndex(st2Id)};
+  const auto neighbors{pGraph->GetNeighbors(st2)};
+  BOOST_REQUIRE_EQUAL(neighbors.size(), 2);
+  BOOST_CHECK_EQUAL(neighbors[0].target, tn.GetStationIndex(st3Id));
+  BOOST_CHECK_EQUAL(neighbors[0].travelTime, 4);
+  BOOST_CHECK_EQUAL(neighbors[0].route, tn.GetRouteIndex("route_001"));
+  BOOST_CHECK_EQUAL(neighbors[1].target, tn.GetStationIndex(st1Id));
+  BOOST_CHECK_EQUAL(neighbors[1].travelTime, 3);
+  BOOST_CHECK_EQUAL(neighbors[1].line, tn.GetLineIndex(lineId));
+  BOOST_CHECK_EQUAL(neighbors[1].route, tn.GetRouteIndex("route_002"));
+  BOOST_CHECK_EQUAL(
+    &pGraph->GetEdge(pGraph->GetFirstEdge(st2)),
+    neighbors.data());
+
+  BOOST_CHECK(tn.SetTravelTime(st3Id, st1Id, 9));
+  BOOST_CHECK(tn.GetGraph() == nullptr);
+}
+
+namespace {
+
+auto MakeLine(
+  const LineId &lineId,
+  const RouteId &routeId,
+  std::vector<StationId> stops) -> Line
+{
+  const Route route{
+    .lineId{lineId},
+    .routeId{routeId},
+    .direction = RouteDirection::kInbound,
+    .startStationId{stops.front()},
+    .endStationId{stops.back()},
+    .stops{std::move(stops)}};
+  return Line{
+    .id{lineId},
+    .name{lineId},
+    .routes{std::make_shared<Route>(route)}};
+}
+
+// Line A runs s1-s2-s3-s4 taking 2 minutes per hop, line B offers a shortcut
+// s2-s5-s4 taking 1 minute per hop.
+auto MakeShortcutNetwork() -> TransportNetwork
+{
+  TransportNetwork tn{};
+
+  for (const auto &id : {"s1", "s2", "s3", "s4", "s5"}) {
+    BOOST_REQUIRE(tn.AddStation(Station(id, std::string{"Station "} + id)));
+  }
+
+  BOOST_REQUIRE(
+    tn.AddLine(MakeLine("line_a", "route_a", {"s1", "s2", "s3", "s4"})));
+  BOOST_REQUIRE(tn.AddLine(MakeLine("line_b", "route_b", {"s2", "s5", "s4"})));
+  BOOST_REQUIRE(tn.SetTravelTime("s1", "s2", 2));
+  BOOST_REQUIRE(tn.SetTravelTime("s2", "s3", 2));
+  BOOST_REQUIRE(tn.SetTravelTime("s3", "s4", 2));
+  BOOST_REQUIRE(tn.SetTravelTime("s2", "s5", 1));
+  BOOST_REQUIRE(tn.SetTravelTime("s5", "s4", 1));
+
+  return tn;
+}
+
+// Unique to the test run, and removed however the test ends.
+class TemporaryDirectory {
+public:
+  explicit TemporaryDirectory(const std::string &prefix)
+      : m_path(
+          std::filesystem::temp_directory_path() /
+          (prefix + std::to_string(std::random_device{}()) + "-" +
+           std::to_string(
+             std::chrono::steady_clock::now().time_since_epoch().count())))
+  {
+  }
+
+  TemporaryDirectory(const TemporaryDirectory &) = delete;
+  auto operator=(const TemporaryDirectory &) -> TemporaryDirectory & = delete;
+
+  ~TemporaryDirectory()
+  {
+    std::error_code error;
+    std::filesystem::remove_all(m_path, error);
+  }
+
+  [[nodiscard]] auto Path() const -> const std::filesystem::path &
+  {
+    return m_path;
+  }
+
+private:
+  std::filesystem::path m_path;
+};
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(GetFastestPathRequiresGraph)
+{
+  const auto tn{MakeShortcutNetwork()};
+
+  BOOST_CHECK_THROW(tn.GetFastestPath("s1", "s4"), std::logic_error);
+}
+
+BOOST_AUTO_TEST_CASE(GetFastestPathWithLineChangePenalty)
+{
+  auto tn{MakeShortcutNetwork()};
+  tn.BuildGraph();
+
+  const auto direct{tn.GetFastestPath("s1", "s4")};
+  BOOST_REQUIRE_EQUAL(direct.steps.size(), 4);
+  BOOST_CHECK_EQUAL(direct.travelTime, 6);
+  BOOST_CHECK_EQUAL(direct.totalTime, 6);
+  BOOST_CHECK_EQUAL(tn.GetStationId(direct.steps[0].station), "s1");
+  BOOST_CHECK_EQUAL(direct.steps[0].route, kInvalidId);
+  BOOST_CHECK_EQUAL(tn.GetStationId(direct.steps[3].station), "s4");
+  BOOST_CHECK_EQUAL(tn.GetRouteId(direct.steps[3].route), "route_a");
+
+  const auto shortcut{
+    tn.GetFastestPath("s1", "s4", ItineraryOptions{.lineChangePenalty = 1})};
+  BOOST_REQUIRE_EQUAL(shortcut.steps.size(), 4);
+  BOOST_CHECK_EQUAL(shortcut.travelTime, 4);
+  BOOST_CHECK_EQUAL(shortcut.totalTime, 5);
+  BOOST_CHECK_EQUAL(tn.GetStationId(shortcut.steps[2].station), "s5");
+  BOOST_CHECK_EQUAL(tn.GetRouteId(shortcut.steps[1].route), "route_a");
+  BOOST_CHECK_EQUAL(tn.GetRouteId(shortcut.steps[2].route), "route_b");
+}
+
+BOOST_AUTO_TEST_CASE(GetFastestPathUnreachable)
+{
+  auto tn{MakeShortcutNetwork()};
+  tn.BuildGraph();
+
+  // Routes are directed, so there is no way back to s1.
+  BOOST_CHECK(tn.GetFastestPath("s4", "s1").Empty());
+  BOOST_CHECK(tn.GetFastestPath("s1", "unknown").Empty());
+
+  Itinerary itinerary{};
+  BOOST_CHECK(tn.GetFastestPath(
+    tn.GetStationIndex("s3"),
+    tn.GetStationIndex("s3"),
+    itinerary));
+  BOOST_CHECK_EQUAL(itinerary.steps.size(), 1);
+  BOOST_CHECK_EQUAL(itinerary.totalTime, 0);
+}
+
+BOOST_AUTO_TEST_CASE(RecordPassengerEventsConcurrently)
+{
+  TransportNetwork tn{};
+
+  const StationId st1Id{"station_001"};
+  const StationId st2Id{"station_002"};
+  BOOST_CHECK(tn.AddStation(Station(st1Id, "Bagramyan")));
+  BOOST_CHECK(tn.AddStation(Station(st2Id, "Yeritasardakan", 1000)));
+
+  constexpr std::size_t kThreadCount{4};
+  constexpr std::size_t kEventCount{1000};
+  std::vector<std::size_t> accepted(kThreadCount, 0);
+  {
+    std::vector<std::jthread> threads;
+    for (std::size_t i{0}; i < kThreadCount; ++i) {
+      threads.emplace_back([&tn, &accepted, &st1Id, &st2Id, i]() {
+        for (std::size_t j{0}; j < kEventCount; ++j) {
+          tn.RecordPassengerEvent(PassengerEvent{
+            .m_stationId{st1Id},
+            .m_type = PassengerEvent::Type::kIn});
+          accepted[i] += tn.RecordPassengerEvent(PassengerEvent{
+                           .m_stationId{st2Id},
+                           .m_type = PassengerEvent::Type::kOut})
+                           ? 1
+                           : 0;
+        }
+      });
+    }
+  }
+
+  BOOST_CHECK_EQUAL(tn.GetPassengerCount(st1Id), kThreadCount * kEventCount);
+
+  // Station two only had 1000 passengers to let out.
+  std::size_t totalAccepted{0};
+  for (const auto count : accepted) {
+    totalAccepted += count;
+  }
+  BOOST_CHECK_EQUAL(totalAccepted, 1000);
+  BOOST_CHECK_EQUAL(tn.GetPassengerCount(st2Id), 0);
+}
+
+BOOST_AUTO_TEST_CASE(RecordPassengerEventsBatch)
+{
+  TransportNetwork tn{};
+
+  const StationId st1Id{"station_001"};
+  const StationId st2Id{"station_002"};
+  BOOST_CHECK(tn.AddStation(Station(st1Id, "Bagramyan")));
+  BOOST_CHECK(tn.AddStation(Station(st2Id, "Yeritasardakan", 1)));
+
+  using Type = PassengerEvent::Type;
+  const std::vector<PassengerEvent> events{
+    {.m_stationId{st1Id}, .m_type = Type::kOut},
+    {.m_stationId{st1Id}, .m_type = Type::kIn},
+    {.m_stationId{st2Id}, .m_type = Type::kOut},
+    {.m_stationId{"station_003"}, .m_type = Type::kIn},
+    {.m_stationId{st2Id}, .m_type = Type::kOut},
+    {.m_stationId{st1Id}, .m_type = Type::kIn},
+    {.m_stationId{st1Id}, .m_type = Type::kOut},
+    {.m_stationId{st2Id}, .m_type = Type::kSizeOfEnum},
+    {.m_stationId{st2Id}, .m_type = Type::kIn}};
+
+  const auto rejections{tn.RecordPassengerEvents(events)};
+  BOOST_REQUIRE_EQUAL(rejections.size(), events.size());
+
+  const std::vector<bool> expected{
+    true, false, false, true, true, false, false, true, false};
+  for (std::size_t i{0}; i < events.size(); ++i) {
+    BOOST_CHECK_EQUAL(rejections.test(i), expected[i]);
+  }
+
+  BOOST_CHECK_EQUAL(tn.GetPassengerCount(st1Id), 1);
+  BOOST_CHECK_EQUAL(tn.GetPassengerCount(st2Id), 1);
+  BOOST_CHECK(tn.RecordPassengerEvents({}).empty());
+}
+
+BOOST_AUTO_TEST_CASE(NonOwningAccessors)
+{
+  auto tn{MakeShortcutNetwork()};
+
+  const auto *pStation{tn.FindStation("s2")};
+  BOOST_REQUIRE(pStation != nullptr);
+  BOOST_CHECK(pStation == tn.GetStation("s2").get());
+  BOOST_CHECK(tn.FindStation("unknown") == nullptr);
+  BOOST_CHECK(tn.FindStation(kInvalidId) == nullptr);
+
+  const auto routes{tn.GetRoutesServingStationView("s2")};
+  BOOST_REQUIRE_EQUAL(routes.size(), 2);
+  BOOST_CHECK_EQUAL(routes[0]->routeId, "route_a");
+  BOOST_CHECK_EQUAL(routes[1]->routeId, "route_b");
+  BOOST_CHECK(tn.GetRoutesServingStationView("unknown").empty());
+
+  const auto *pLine{tn.FindLine("line_b")};
+  BOOST_REQUIRE(pLine != nullptr);
+  BOOST_CHECK(*pLine == *tn.GetLine("line_b"));
+  BOOST_CHECK(tn.FindLine("line_c") == nullptr);
+
+  const auto routeB{tn.GetRouteIndex("route_b")};
+  BOOST_CHECK(tn.FindRoute(routeB) == routes[1].get());
+  const auto stops{tn.GetRouteStopsView(routeB)};
+  BOOST_REQUIRE_EQUAL(stops.size(), 3);
+  BOOST_CHECK_EQUAL(tn.GetStationId(stops[1]), "s5");
+  BOOST_CHECK(tn.GetRouteStopsView(kInvalidId).empty());
+}
+
+BOOST_AUTO_TEST_CASE(BuildNetworkFromLayoutFile)
+{
+  TransportNetworkBuilder builder{};
+  builder.AddLayout(
+    TransportNetworkParser::ParseFile(TESTS_NETWORK_LAYOUT_PATH));
+  auto tn{builder.Build()};
+
+  BOOST_CHECK_EQUAL(tn.GetStationCount(), 426);
+  BOOST_CHECK(tn.GetLine("line_000") != nullptr);
+  BOOST_CHECK_EQUAL(tn.GetLine("line_000")->name, "Bakerloo");
+  BOOST_CHECK_EQUAL(tn.GetTravelTime("station_000", "station_001"), 2);
+
+  // Both directions of the Bakerloo line stop at its first station.
+  const auto routes{tn.GetRoutesServingStationView("station_000")};
+  BOOST_REQUIRE_EQUAL(routes.size(), 2);
+  BOOST_CHECK_EQUAL(routes[0]->routeId, "route_000");
+  BOOST_CHECK_EQUAL(routes[1]->routeId, "route_001");
+
+  tn.BuildGraph();
+  const auto itinerary{tn.GetFastestPath("station_000", "station_024")};
+  BOOST_CHECK(!itinerary.Empty());
+  BOOST_CHECK_GT(itinerary.travelTime, 0);
+
+  // The builder is empty again.
+  BOOST_CHECK_EQUAL(builder.Build().GetStationCount(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(BuilderResolvesStopsAtBuildTime)
+{
+  const StationId st1Id{"station_001"};
+  const StationId st2Id{"station_002"};
+  const Route rt1{
+    .lineId{"line_001"},
+    .routeId{"route_001"},
+    .direction = RouteDirection::kInbound,
+    .startStationId{st1Id},
+    .endStationId{st2Id},
+    .stops{st1Id, st2Id, st1Id}};
+  const Line ln1{
+    .id{"line_001"},
+    .name{"bagyer"},
+    .routes{std::make_shared<Route>(rt1)}};
+
+  TransportNetworkBuilder builder{};
+  BOOST_CHECK(builder.AddLine(ln1));
+  BOOST_CHECK(!builder.AddLine(ln1));
+  builder.SetTravelTime(
+    LayoutTravelTime{
+      .startStationId{st1Id},
+      .endStationId{st2Id},
+      .travelTime = 3});
+  BOOST_CHECK(builder.AddStation(Station(st1Id, "Bagramyan")));
+  BOOST_CHECK(builder.AddStation(Station(st2Id, "Yeritasardakan")));
+
+  const auto tn{builder.Build()};
+  BOOST_CHECK(*tn.GetLine("line_001") == ln1);
+  BOOST_CHECK_EQUAL(tn.GetRoutesServingStation(st1Id).size(), 1);
+  BOOST_CHECK_EQUAL(tn.GetTravelTime(st1Id, st2Id), 3);
+
+  TransportNetworkBuilder missingStation{};
+  BOOST_CHECK(missingStation.AddStation(Station(st1Id, "Bagramyan")));
+  BOOST_CHECK(missingStation.AddLine(ln1));
+  BOOST_CHECK_THROW(missingStation.Build(), std::logic_error);
+}
+
+BOOST_AUTO_TEST_CASE(GetTravelTimeAlongRoute)
+{
+  auto tn{MakeShortcutNetwork()};
+  BOOST_CHECK_THROW(tn.GetTravelTime("route_a", "s1", "s4"), std::logic_error);
+
+  tn.BuildGraph();
+  BOOST_CHECK_EQUAL(tn.GetTravelTime("route_a", "s1", "s4"), 6);
+  BOOST_CHECK_EQUAL(tn.GetTravelTime("route_a", "s2", "s3"), 2);
+  BOOST_CHECK_EQUAL(tn.GetTravelTime("route_a", "s3", "s3"), 0);
+  BOOST_CHECK_EQUAL(tn.GetTravelTime("route_b", "s2", "s4"), 2);
+
+  // Against the direction of the route, off the route or unknown ids.
+  BOOST_CHECK_EQUAL(tn.GetTravelTime("route_a", "s4", "s1"), 0);
+  BOOST_CHECK_EQUAL(tn.GetTravelTime("route_b", "s1", "s4"), 0);
+  BOOST_CHECK_EQUAL(tn.GetTravelTime("route_c", "s1", "s4"), 0);
+  BOOST_CHECK_EQUAL(tn.GetTravelTime("route_a", "s1", "unknown"), 0);
+
+  const auto pGraph{tn.GetGraph()};
+  const auto routeA{tn.GetRouteIndex("route_a")};
+  BOOST_CHECK_EQUAL(pGraph->GetRouteStops(routeA).size(), 4);
+  BOOST_CHECK_EQUAL(pGraph->GetSegmentTravelTime(routeA, 1, 3), 4);
+  BOOST_CHECK_EQUAL(
+    pGraph->GetStopPosition(routeA, tn.GetStationIndex("s3")),
+    2);
+  BOOST_CHECK_EQUAL(
+    pGraph->GetStationStops(tn.GetStationIndex("s4")).size(),
+    2);
+}
+
+BOOST_AUTO_TEST_CASE(CopiesDoNotShareLayoutChanges)
+{
+  const auto original{MakeShortcutNetwork()};
+  auto copy{original};
+
+  const Route route{
+    .lineId{"line_c"},
+    .routeId{"route_c"},
+    .direction = RouteDirection::kInbound,
+    .startStationId{"s1"},
+    .endStationId{"s5"},
+    .stops{"s1", "s5"}};
+  BOOST_CHECK(copy.AddLine(Line{
+    .id{"line_c"},
+    .name{"line_c"},
+    .routes{std::make_shared<Route>(route)}}));
+
+  BOOST_CHECK_EQUAL(copy.GetRoutesServingStation("s1").size(), 2);
+  BOOST_CHECK_EQUAL(original.GetRoutesServingStation("s1").size(), 1);
+  BOOST_CHECK(original.GetLine("line_c") == nullptr);
+
+  // Untouched stations are still shared, touched ones were cloned.
+  BOOST_CHECK(copy.FindStation("s2") == original.FindStation("s2"));
+  BOOST_CHECK(copy.FindStation("s1") != original.FindStation("s1"));
+}
+
+BOOST_AUTO_TEST_CASE(SnapshotsPublishNewVersions)
+{
+  TransportNetworkSnapshots snapshots{MakeShortcutNetwork()};
+  BOOST_CHECK_EQUAL(snapshots.GetVersion(), 0);
+
+  const auto first{snapshots.Acquire()};
+  BOOST_CHECK(first->RecordPassengerEvent(
+    PassengerEvent{.m_stationId{"s2"}, .m_type = PassengerEvent::Type::kIn}));
+
+  snapshots.Update([](TransportNetwork &network) {
+    BOOST_CHECK(network.AddStation(Station("s6", "Station s6")));
+    BOOST_CHECK(network.SetTravelTime("s5", "s6", 3));
+    network.BuildGraph();
+  });
+  BOOST_CHECK_EQUAL(snapshots.GetVersion(), 1);
+
+  // Readers of the old version are unaffected.
+  const auto second{snapshots.Acquire()};
+  BOOST_CHECK_EQUAL(first->GetStationCount(), 5);
+  BOOST_CHECK(first->GetGraph() == nullptr);
+  BOOST_CHECK_EQUAL(second->GetStationCount(), 6);
+  BOOST_CHECK_EQUAL(second->GetTravelTime("s5", "s6"), 3);
+
+  // Passenger counts carry over through shared stations.
+  BOOST_CHECK_EQUAL(second->GetPassengerCount("s2"), 1);
+
+  // A failed update publishes nothing.
+  BOOST_CHECK_THROW(
+    snapshots.Update([](TransportNetwork &network) {
+      network.AddLine(Line{.id{"empty"}});
+    }),
+    std::logic_error);
+  BOOST_CHECK_EQUAL(snapshots.GetVersion(), 1);
+  BOOST_CHECK(snapshots.Acquire() == second);
+
+  snapshots.Publish(TransportNetwork{});
+  BOOST_CHECK_EQUAL(snapshots.Acquire()->GetStationCount(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(SnapshotsConcurrentReadersAndWriter)
+{
+  TransportNetworkSnapshots snapshots{MakeShortcutNetwork()};
+  snapshots.Update([](TransportNetwork &network) { network.BuildGraph(); });
+
+  // Boost.Test assertions are not thread-safe, readers only count.
+  std::atomic<bool> done{false};
+  std::atomic<std::size_t> queries{0};
+  std::atomic<std::size_t> failures{0};
+  {
+    std::vector<std::jthread> readers;
+    for (std::size_t i{0}; i < 3; ++i) {
+      readers.emplace_back([&snapshots, &done, &queries, &failures]() {
+        Itinerary itinerary{};
+        while (!done.load()) {
+          const auto network{snapshots.Acquire()};
+          if (!network->GetFastestPath(
+                network->GetStationIndex("s1"),
+                network->GetStationIndex("s4"),
+                itinerary) ||
+              itinerary.totalTime != 6) {
+            failures++;
+          }
+          queries++;
+        }
+      });
+    }
+
+    for (unsigned int i{1}; i <= 50; ++i) {
+      snapshots.Update([i](TransportNetwork &network) {
+        network.AddStation(Station("extra_" + std::to_string(i), "Extra"));
+        network.BuildGraph();
+      });
+    }
+
+    while (queries.load() == 0) {
+      std::this_thread::yield();
+    }
+    done = true;
+  }
+
+  BOOST_CHECK_EQUAL(failures.load(), 0);
+  BOOST_CHECK_EQUAL(snapshots.Acquire()->GetStationCount(), 55);
+}
+
+BOOST_AUTO_TEST_CASE(RemoveStationAndLine)
+{
+  auto tn{MakeShortcutNetwork()};
+
+  BOOST_CHECK_THROW(tn.RemoveStation("s5"), std::logic_error);
+  BOOST_CHECK(tn.RemoveLine("line_b"));
+  BOOST_CHECK(!tn.RemoveLine("line_b"));
+  BOOST_CHECK(tn.GetRoutesServingStation("s5").empty());
+  BOOST_CHECK_EQUAL(tn.GetRoutesServingStation("s2").size(), 1);
+
+  const auto s5{tn.GetStationIndex("s5")};
+  BOOST_CHECK(tn.RemoveStation("s5"));
+  BOOST_CHECK(!tn.RemoveStation("s5"));
+  BOOST_CHECK(tn.FindStation("s5") == nullptr);
+  BOOST_CHECK(!tn.RecordPassengerEvent({"s5", PassengerEvent::Type::kIn}));
+  BOOST_CHECK_EQUAL(tn.GetTravelTime("s2", "s5"), 0);
+
+  // Removed ids keep their index and may be added again.
+  BOOST_CHECK(tn.AddStation(Station("s5", "Station s5")));
+  BOOST_CHECK_EQUAL(tn.GetStationIndex("s5"), s5);
+  BOOST_CHECK(tn.AddLine(MakeLine("line_b", "route_b", {"s2", "s5", "s4"})));
+  BOOST_CHECK_EQUAL(tn.GetRoutesServingStation("s5").size(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(ApplyLayoutDiff)
+{
+  auto tn{MakeShortcutNetwork()};
+  BOOST_REQUIRE(tn.RecordPassengerEvent({"s1", PassengerEvent::Type::kIn}));
+  BOOST_REQUIRE(tn.RecordPassengerEvent({"s2", PassengerEvent::Type::kIn}));
+  tn.BuildGraph();
+
+  NetworkLayout layout{};
+  for (const auto &id : {"s1", "s2", "s3", "s4", "s6"}) {
+    layout.stations.emplace_back(id, std::string{"Station "} + id);
+  }
+  layout.stations[2].m_name = "Renamed s3";
+  layout.lines.push_back(
+    MakeLine("line_a", "route_a", {"s1", "s2", "s3", "s4"}));
+  layout.lines.push_back(MakeLine("line_c", "route_c", {"s2", "s6", "s4"}));
+  layout.travelTimes = {
+    {"s1", "s2", "line_a", "route_a", 3},
+    {"s2", "s3", "line_a", "route_a", 2},
+    {"s3", "s4", "line_a", "route_a", 2},
+    {"s2", "s6", "line_c", "route_c", 1},
+    {"s6", "s4", "line_c", "route_c", 1}};
+
+  const auto diff{tn.ApplyLayoutDiff(layout)};
+  BOOST_CHECK_EQUAL(diff.addedStations, 1);
+  BOOST_CHECK_EQUAL(diff.removedStations, 1);
+  BOOST_CHECK_EQUAL(diff.modifiedStations, 1);
+  BOOST_CHECK_EQUAL(diff.addedLines, 1);
+  BOOST_CHECK_EQUAL(diff.removedLines, 1);
+  BOOST_CHECK_EQUAL(diff.modifiedLines, 0);
+  BOOST_CHECK_EQUAL(diff.addedTravelTimes, 2);
+  BOOST_CHECK_EQUAL(diff.removedTravelTimes, 2);
+  BOOST_CHECK_EQUAL(diff.modifiedTravelTimes, 1);
+  BOOST_CHECK(!tn.GetGraph());
+
+  BOOST_CHECK_EQUAL(tn.GetPassengerCount("s1"), 1);
+  BOOST_CHECK_EQUAL(tn.GetPassengerCount("s2"), 1);
+  BOOST_CHECK(tn.FindStation("s5") == nullptr);
+  BOOST_CHECK_EQUAL(tn.FindStation("s3")->m_name, "Renamed s3");
+  BOOST_CHECK(tn.FindLine("line_b") == nullptr);
+  BOOST_CHECK_EQUAL(tn.GetRoutesServingStation("s6").size(), 1);
+  BOOST_CHECK_EQUAL(tn.GetTravelTime("s1", "s2"), 3);
+
+  tn.BuildGraph();
+  BOOST_CHECK_EQUAL(tn.GetFastestPath("s1", "s4").totalTime, 7);
+
+  // Applying the same layout again changes nothing.
+  BOOST_CHECK(tn.ApplyLayoutDiff(layout).Empty());
+  BOOST_CHECK(tn.GetGraph());
+
+  // Invalid layouts are rejected before anything changes.
+  layout.lines.push_back(MakeLine("line_d", "route_d", {"s1", "s7"}));
+  BOOST_CHECK_THROW(tn.ApplyLayoutDiff(layout), std::logic_error);
+  BOOST_CHECK(tn.GetGraph());
+}
+
+BOOST_AUTO_TEST_CASE(WriteAndLoadImage)
+{
+  const auto path{
+    std::filesystem::temp_directory_path() / "transport-network-image.bin"};
+
+  auto tn{MakeShortcutNetwork()};
+  BOOST_REQUIRE(tn.RecordPassengerEvent({"s2", PassengerEvent::Type::kIn}));
+  BOOST_REQUIRE(tn.RecordPassengerEvent({"s2", PassengerEvent::Type::kIn}));
+  BOOST_REQUIRE(tn.AddLine(MakeLine("line_c", "route_c", {"s5", "s1"})));
+  BOOST_REQUIRE(tn.RemoveLine("line_c"));
+  TransportNetworkImage::Write(tn, path, true);
+
+  {
+    const auto image{TransportNetworkImage::Load(path)};
+    BOOST_CHECK(image.HasPassengerCounts());
+    BOOST_CHECK_EQUAL(image.GetStationCount(), 5);
+    BOOST_CHECK_EQUAL(image.GetLineCount(), 3);
+    BOOST_CHECK_EQUAL(image.GetRouteCount(), 3);
+    BOOST_CHECK_EQUAL(image.GetTravelTimeCount(), 5);
+
+    const auto s2{image.GetStationIndex("s2")};
+    BOOST_REQUIRE_EQUAL(s2, tn.GetStationIndex("s2"));
+    BOOST_CHECK_EQUAL(image.GetStationId(s2), "s2");
+    BOOST_CHECK_EQUAL(image.GetStationName(s2), "Station s2");
+    BOOST_CHECK_EQUAL(image.GetPassengerCount(s2), 2);
+    BOOST_CHECK_EQUAL(image.GetRoutesServingStation(s2).size(), 2);
+    BOOST_CHECK_EQUAL(image.GetStationIndex("s9"), kInvalidId);
+
+    BOOST_CHECK_EQUAL(image.GetLineIndex("line_c"), kInvalidId);
+    BOOST_CHECK(image.IsLineRemoved(tn.GetLineIndex("line_c")));
+    BOOST_CHECK(image.IsRouteRemoved(tn.GetRouteIndex("route_c")));
+
+    const auto routeB{image.GetRouteIndex("route_b")};
+    BOOST_REQUIRE_NE(routeB, kInvalidId);
+    BOOST_CHECK_EQUAL(image.GetRouteId(routeB), "route_b");
+    BOOST_CHECK_EQUAL(image.GetLineId(image.GetRouteLine(routeB)), "line_b");
+    const auto stops{image.GetRouteStops(routeB)};
+    BOOST_REQUIRE_EQUAL(stops.size(), 3);
+    BOOST_CHECK_EQUAL(image.GetStationId(stops[1]), "s5");
+    BOOST_CHECK_EQUAL(
+      image.GetTravelTime(
+        image.GetStationIndex("s5"),
+        image.GetStationIndex("s4")),
+      1);
+    BOOST_CHECK_EQUAL(image.GetTravelTime(s2, s2), 0);
+
+    auto copy{image.ToNetwork()};
+    BOOST_CHECK_EQUAL(copy.GetStationIndex("s2"), s2);
+    BOOST_CHECK_EQUAL(copy.GetRouteIndex("route_b"), routeB);
+    BOOST_CHECK_EQUAL(copy.GetPassengerCount("s2"), 2);
+    BOOST_CHECK(copy.FindLine("line_c") == nullptr);
+    BOOST_CHECK_EQUAL(copy.GetRoutesServingStation("s5").size(), 1);
+    BOOST_CHECK_EQUAL(copy.GetTravelTime("s5", "s4"), 1);
+    copy.BuildGraph();
+    BOOST_CHECK_EQUAL(copy.GetFastestPath("s1", "s4").totalTime, 6);
+
+    BOOST_REQUIRE(copy.AddLine(MakeLine("line_c", "route_c", {"s5", "s1"})));
+    BOOST_CHECK_EQUAL(copy.GetLineIndex("line_c"), tn.GetLineIndex("line_c"));
+    BOOST_CHECK_EQUAL(copy.GetRoutesServingStation("s5").size(), 2);
+  }
+
+  std::filesystem::remove(path);
+}
+
+BOOST_AUTO_TEST_CASE(LoadImageRejectsInvalidFiles)
+{
+  const auto path{
+    std::filesystem::temp_directory_path() / "transport-network-invalid.bin"};
+
+  BOOST_CHECK_THROW(TransportNetworkImage::Load(path), std::runtime_error);
+
+  TransportNetworkImage::Write(MakeShortcutNetwork(), path);
+  BOOST_CHECK(!TransportNetworkImage::Load(path).HasPassengerCounts());
+
+  std::filesystem::resize_file(path, std::filesystem::file_size(path) - 8);
+  BOOST_CHECK_THROW(TransportNetworkImage::Load(path), std::runtime_error);
+
+  std::ofstream{path, std::ios::binary | std::ios::trunc}
+    << "{\"stations\": []}";
+  BOOST_CHECK_THROW(TransportNetworkImage::Load(path), std::runtime_error);
+
+  std::filesystem::remove(path);
+}
+
+BOOST_AUTO_TEST_CASE(LoadImageOfLayoutFile)
+{
+  const auto path{
+    std::filesystem::temp_directory_path() / "transport-network-layout.bin"};
+
+  TransportNetworkBuilder builder{};
+  builder.AddLayout(
+    TransportNetworkParser::ParseFile(TESTS_NETWORK_LAYOUT_PATH));
+  const auto tn{builder.Build()};
+  TransportNetworkImage::Write(tn, path);
+
+  {
+    const auto image{TransportNetworkImage::Load(path)};
+    BOOST_REQUIRE_EQUAL(image.GetStationCount(), tn.GetStationCount());
+    for (StationIndex station{0}; station < tn.GetStationCount(); ++station) {
+      BOOST_CHECK_EQUAL(image.GetStationId(station), tn.GetStationId(station));
+      BOOST_CHECK_EQUAL(
+        image.GetStationIndex(tn.GetStationId(station)),
+        station);
+    }
+
+    BOOST_CHECK_EQUAL(
+      image.GetLineName(image.GetLineIndex("line_000")),
+      "Bakerloo");
+    BOOST_CHECK_EQUAL(
+      image.GetTravelTime(
+        image.GetStationIndex("station_000"),
+        image.GetStationIndex("station_001")),
+      2);
+
+    auto copy{image.ToNetwork()};
+    copy.BuildGraph();
+    BOOST_CHECK(!copy.GetFastestPath("station_000", "station_024").Empty());
+  }
+
+  std::filesystem::remove(path);
+}
+
+BOOST_AUTO_TEST_CASE(PassengerRatesOverWindows)
+{
+  using namespace std::chrono_literals;
+
+  auto tn{MakeShortcutNetwork()};
+  const PassengerTimestamp start{std::chrono::hours{24 * 365 * 50}};
+
+  // Three entries in the first minute, one entry and one exit in the second.
+  for (int i{0}; i < 3; ++i) {
+    BOOST_REQUIRE(tn.RecordPassengerEvent(
+      {"s1", PassengerEvent::Type::kIn, start + std::chrono::seconds{i}}));
+  }
+  BOOST_REQUIRE(
+    tn.RecordPassengerEvent({"s1", PassengerEvent::Type::kIn, start + 70s}));
+  BOOST_REQUIRE(
+    tn.RecordPassengerEvent({"s1", PassengerEvent::Type::kOut, start + 80s}));
+
+  // Rejected events are not counted.
+  BOOST_REQUIRE(
+    !tn.RecordPassengerEvent({"s2", PassengerEvent::Type::kOut, start}));
+
+  const auto now{start + 90s};
+  const auto rates{tn.GetPassengerRates("s1", 2min, now)};
+  BOOST_CHECK_CLOSE(rates.in, 2.0, 1e-9);
+  BOOST_CHECK_CLOSE(rates.out, 0.5, 1e-9);
+
+  const auto lastMinute{tn.GetPassengerRates("s1", 1min, now)};
+  BOOST_CHECK_CLOSE(lastMinute.in, 1.0, 1e-9);
+
+  const auto peak{tn.GetPassengerRatePercentiles("s1", 2min, 100.0, now)};
+  BOOST_CHECK_CLOSE(peak.in, 3.0, 1e-9);
+  BOOST_CHECK_CLOSE(peak.out, 1.0, 1e-9);
+  const auto median{tn.GetPassengerRatePercentiles("s1", 2min, 50.0, now)};
+  BOOST_CHECK_CLOSE(median.in, 1.0, 1e-9);
+
+  BOOST_CHECK_EQUAL(tn.GetPassengerRates("s2", 2min, now).out, 0.0);
+  BOOST_CHECK_EQUAL(tn.GetPassengerRates("s9", 2min, now).in, 0.0);
+
+  // Once the ring has wrapped around, old buckets no longer count and events
+  // for them are dropped.
+  const auto later{start + PassengerStatistics::kBucketCount * 1min};
+  BOOST_REQUIRE(
+    tn.RecordPassengerEvent({"s1", PassengerEvent::Type::kIn, later}));
+  BOOST_REQUIRE(
+    tn.RecordPassengerEvent({"s1", PassengerEvent::Type::kIn, start}));
+  BOOST_CHECK_CLOSE(tn.GetPassengerRates("s1", 1min, later).in, 1.0, 1e-9);
+  BOOST_CHECK_EQUAL(tn.GetPassengerRates("s1", 1min, start).in, 0.0);
+}
+
+BOOST_AUTO_TEST_CASE(PassengerRatesFromBatches)
+{
+  using namespace std::chrono_literals;
+
+  auto tn{MakeShortcutNetwork()};
+  const PassengerTimestamp start{std::chrono::hours{24 * 365 * 50}};
+
+  const std::vector<PassengerEvent> events{
+    {"s1", PassengerEvent::Type::kIn, start},
+    {"s1", PassengerEvent::Type::kOut, start + 10s},
+    {"s1", PassengerEvent::Type::kOut, start + 20s},
+    {"s2", PassengerEvent::Type::kIn, start + 30s},
+    {"s1", PassengerEvent::Type::kIn, start + 60s},
+    {"s1", PassengerEvent::Type::kIn, start + 70s}};
+  const auto rejections{tn.RecordPassengerEvents(events)};
+  BOOST_CHECK_EQUAL(rejections.count(), 1);
+
+  const auto rates{tn.GetPassengerRates("s1", 2min, start + 90s)};
+  BOOST_CHECK_CLOSE(rates.in, 1.5, 1e-9);
+  BOOST_CHECK_CLOSE(rates.out, 0.5, 1e-9);
+  BOOST_CHECK_CLOSE(
+    tn.GetPassengerRatePercentiles("s1", 2min, 100.0, start + 90s).in,
+    2.0,
+    1e-9);
+  BOOST_CHECK_CLOSE(tn.GetPassengerRates("s2", 1min, start).in, 1.0, 1e-9);
+
+  // Events without a timestamp count as happening now.
+  BOOST_REQUIRE(tn.RecordPassengerEvent({"s3", PassengerEvent::Type::kIn}));
+  BOOST_CHECK_CLOSE(tn.GetPassengerRates("s3", 1min).in, 1.0, 1e-9);
+}
+
+BOOST_AUTO_TEST_CASE(SegmentLoads)
+{
+  auto tn{MakeShortcutNetwork()};
+  BOOST_CHECK_THROW(
+    static_cast<void>(tn.GetMostCrowdedSegments(1)),
+    std::logic_error);
+
+  // Events recorded before the graph is built are not part of the estimate.
+  BOOST_REQUIRE(tn.RecordPassengerEvent({"s3", PassengerEvent::Type::kIn}));
+  BOOST_REQUIRE(tn.RecordPassengerEvent({"s4", PassengerEvent::Type::kIn}));
+  tn.BuildGraph();
+
+  const auto routeA{tn.GetRouteIndex("route_a")};
+  const auto routeB{tn.GetRouteIndex("route_b")};
+
+  // s1 is served by route_a only, s2 is left by both routes.
+  BOOST_REQUIRE(tn.RecordPassengerEvent({"s1", PassengerEvent::Type::kIn}));
+  const std::vector<PassengerEvent> events{
+    {"s1", PassengerEvent::Type::kIn},
+    {"s2", PassengerEvent::Type::kIn},
+    {"s3", PassengerEvent::Type::kOut},
+    {"s4", PassengerEvent::Type::kOut}};
+  BOOST_REQUIRE(tn.RecordPassengerEvents(events).none());
+
+  BOOST_CHECK_CLOSE(tn.GetSegmentLoad(routeA, 0), 2.0, 1e-9);
+  BOOST_CHECK_CLOSE(tn.GetSegmentLoad(routeA, 1), 2.5, 1e-9);
+  BOOST_CHECK_CLOSE(tn.GetSegmentLoad(routeA, 2), 1.5, 1e-9);
+  BOOST_CHECK_CLOSE(tn.GetSegmentLoad(routeB, 0), 0.5, 1e-9);
+  BOOST_CHECK_EQUAL(tn.GetSegmentLoad(routeA, 3), 0.0);
+
+  const auto crowded{tn.GetMostCrowdedSegments(2)};
+  BOOST_REQUIRE_EQUAL(crowded.size(), 2);
+  BOOST_CHECK_EQUAL(crowded[0].route, routeA);
+  BOOST_CHECK_EQUAL(crowded[0].position, 1);
+  BOOST_CHECK_CLOSE(crowded[0].load, 2.5, 1e-9);
+  BOOST_CHECK_EQUAL(crowded[1].position, 0);
+  BOOST_CHECK_EQUAL(tn.GetMostCrowdedSegments(100).size(), 5);
+
+  // Passengers count towards the buckets they boarded and alighted in, and
+  // leave the estimate with them, alighting at the terminus or not. Nobody
+  // boards at a terminus.
+  using namespace std::chrono_literals;
+  const PassengerTimestamp start{std::chrono::seconds{1704067200}};
+  BOOST_REQUIRE(tn.RecordPassengerEvent(
+    {"s1", PassengerEvent::Type::kIn, start}));
+  BOOST_REQUIRE(tn.RecordPassengerEvent(
+    {"s4", PassengerEvent::Type::kIn, start}));
+  BOOST_REQUIRE(tn.RecordPassengerEvent(
+    {"s4", PassengerEvent::Type::kOut, start + 5min}));
+  BOOST_CHECK_CLOSE(tn.GetSegmentLoad(routeA, 2, 1min, start), 1.0, 1e-9);
+  BOOST_CHECK_CLOSE(
+    tn.GetSegmentLoad(routeA, 2, 6min, start + 5min),
+    1.0,
+    1e-9);
+  BOOST_CHECK_EQUAL(tn.GetSegmentLoad(routeA, 2, 1min, start + 5min), 0.0);
+  BOOST_CHECK_EQUAL(
+    tn.GetSegmentLoad(routeA, 2, SegmentLoadEstimator::kWindow, start + 1h),
+    0.0);
+  BOOST_CHECK(
+    tn.GetMostCrowdedSegments(100, SegmentLoadEstimator::kWindow, start + 1h)
+      .empty());
+
+  // Estimates start over with the next graph.
+  BOOST_REQUIRE(tn.AddStation(Station("s6", "Station s6")));
+  BOOST_CHECK_THROW(
+    static_cast<void>(tn.GetSegmentLoad(routeA, 0)),
+    std::logic_error);
+  tn.BuildGraph();
+  BOOST_CHECK(tn.GetMostCrowdedSegments(1).empty());
+}
+
+BOOST_AUTO_TEST_CASE(GetQuietItineraries)
+{
+  auto tn{MakeShortcutNetwork()};
+  BOOST_CHECK_THROW(tn.GetQuietItineraries("s1", "s4", 2), std::logic_error);
+  tn.BuildGraph();
+
+  const auto routeA{tn.GetRouteIndex("route_a")};
+  const auto routeB{tn.GetRouteIndex("route_b")};
+
+  // Without crowding the direct ride comes first.
+  const auto quiet{tn.GetQuietItineraries("s1", "s4", 5)};
+  BOOST_REQUIRE_EQUAL(quiet.size(), 2);
+  BOOST_CHECK_EQUAL(quiet[0].itinerary.totalTime, 6);
+  BOOST_CHECK_EQUAL(quiet[0].score, 6);
+  BOOST_CHECK_EQUAL(quiet[0].itinerary.steps.back().route, routeA);
+  BOOST_CHECK_EQUAL(quiet[1].itinerary.travelTime, 4);
+  BOOST_CHECK_EQUAL(quiet[1].itinerary.totalTime, 9);
+  BOOST_CHECK_EQUAL(quiet[1].itinerary.steps.back().route, routeB);
+
+  // A crowded s3 makes the change at s2 worth it.
+  for (int i{0}; i < 500; ++i) {
+    BOOST_REQUIRE(tn.RecordPassengerEvent({"s3", PassengerEvent::Type::kIn}));
+  }
+
+  std::vector<QuietItinerary> itineraries{};
+  BOOST_REQUIRE(tn.GetQuietItineraries(
+    tn.GetStationIndex("s1"),
+    tn.GetStationIndex("s4"),
+    2,
+    itineraries));
+  BOOST_REQUIRE_EQUAL(itineraries.size(), 2);
+  BOOST_CHECK_EQUAL(itineraries[0].itinerary.steps.back().route, routeB);
+  BOOST_CHECK_EQUAL(itineraries[0].crowding, 0);
+  BOOST_CHECK_EQUAL(itineraries[0].score, 9);
+  BOOST_CHECK_EQUAL(itineraries[1].crowding, 500);
+  BOOST_CHECK_EQUAL(itineraries[1].score, 16);
+
+  // The fastest path does not care about crowding.
+  BOOST_CHECK_EQUAL(tn.GetFastestPath("s1", "s4").totalTime, 6);
+
+  BOOST_REQUIRE(tn.GetQuietItineraries(
+    tn.GetStationIndex("s1"),
+    tn.GetStationIndex("s4"),
+    1,
+    itineraries));
+  BOOST_CHECK_EQUAL(itineraries.size(), 1);
+  BOOST_CHECK(!tn.GetQuietItineraries(
+    tn.GetStationIndex("s4"),
+    tn.GetStationIndex("s1"),
+    3,
+    itineraries));
+  BOOST_CHECK(itineraries.empty());
+}
+
+BOOST_AUTO_TEST_CASE(PrecomputeTravelTimes)
+{
+  auto tn{MakeShortcutNetwork()};
+  BOOST_CHECK_THROW(tn.PrecomputeTravelTimes(), std::logic_error);
+  BOOST_CHECK_THROW(
+    static_cast<void>(tn.GetShortestTravelTime("s1", "s4")),
+    std::logic_error);
+
+  // Stored travel times, which precomputing must leave as they are.
+  const std::vector<std::pair<StationId, StationId>> pairs{
+    {"s1", "s2"},
+    {"s2", "s1"},
+    {"s2", "s3"},
+    {"s2", "s5"},
+    {"s1", "s4"}};
+  std::vector<unsigned int> stored;
+  for (const auto &[start, end] : pairs) {
+    stored.push_back(tn.GetTravelTime(start, end));
+  }
+
+  tn.BuildGraph();
+  tn.PrecomputeTravelTimes({}, 2);
+
+  const auto matrix{tn.GetTravelTimeMatrix()};
+  BOOST_REQUIRE(matrix);
+  BOOST_CHECK_EQUAL(matrix->GetStationCount(), 5);
+  for (std::size_t i{0}; i < pairs.size(); ++i) {
+    BOOST_CHECK_EQUAL(
+      tn.GetTravelTime(pairs[i].first, pairs[i].second),
+      stored[i]);
+  }
+
+  // Any pair of stations is served, not only the adjacent ones.
+  BOOST_CHECK_EQUAL(tn.GetTravelTime("s1", "s4"), 0);
+  BOOST_CHECK_EQUAL(tn.GetShortestTravelTime("s1", "s4"), 6);
+  BOOST_CHECK_EQUAL(tn.GetShortestTravelTime("s1", "s5"), 8);
+  BOOST_CHECK_EQUAL(tn.GetShortestTravelTime("s1", "s2"), 2);
+  BOOST_CHECK_EQUAL(tn.GetShortestTravelTime("s4", "s1"), 0);
+  BOOST_CHECK_EQUAL(
+    matrix->Get(tn.GetStationIndex("s4"), tn.GetStationIndex("s1")),
+    TravelTimeMatrix::kUnreachable);
+  BOOST_CHECK_EQUAL(
+    matrix->GetRow(tn.GetStationIndex("s3"))[tn.GetStationIndex("s3")],
+    0);
+
+  // Layout changes drop the matrix along with the graph.
+  BOOST_REQUIRE(tn.SetTravelTime("s1", "s3", 3));
+  BOOST_CHECK(!tn.GetTravelTimeMatrix());
+  BOOST_CHECK_THROW(
+    static_cast<void>(tn.GetShortestTravelTime("s1", "s4")),
+    std::logic_error);
+  BOOST_CHECK_EQUAL(tn.GetTravelTime("s1", "s3"), 3);
+}
+
+BOOST_AUTO_TEST_CASE(PrecomputeTravelTimesOfLayoutFile)
+{
+  TransportNetworkBuilder builder{};
+  builder.AddLayout(
+    TransportNetworkParser::ParseFile(TESTS_NETWORK_LAYOUT_PATH));
+  auto tn{builder.Build()};
+  tn.BuildGraph();
+
+  const ItineraryOptions options{.lineChangePenalty = 3};
+  tn.PrecomputeTravelTimes(options, 4);
+  const auto matrix{tn.GetTravelTimeMatrix()};
+  BOOST_REQUIRE(matrix);
+
+  const auto stationCount{tn.GetStationCount()};
+  for (StationIndex start{0}; start < stationCount; start += 3) {
+    for (StationIndex end{0}; end < stationCount; end += 5) {
+      const auto itinerary{tn.GetFastestPath(
+        tn.GetStationId(start),
+        tn.GetStationId(end),
+        options)};
+      if (itinerary.Empty()) {
+        BOOST_CHECK_EQUAL(
+          matrix->Get(start, end),
+          TravelTimeMatrix::kUnreachable);
+      }
+      else {
+        BOOST_CHECK_EQUAL(matrix->Get(start, end), itinerary.totalTime);
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(StopSequencesAreShared)
+{
+  StopSequencePool pool{};
+  const auto forward{pool.Intern({"s1", "s2", "s3"})};
+  const auto backward{pool.Intern({"s3", "s2", "s1"})};
+  BOOST_CHECK_EQUAL(pool.GetSequenceCount(), 1);
+  BOOST_CHECK(forward.SharesStopsWith(backward));
+  BOOST_CHECK(forward.IsReversed() != backward.IsReversed());
+  BOOST_CHECK(forward == backward.Reversed());
+  BOOST_CHECK(forward != backward);
+  BOOST_CHECK(forward == StopSequence({"s1", "s2", "s3"}));
+  BOOST_CHECK_EQUAL(forward.front(), "s1");
+  BOOST_CHECK_EQUAL(backward.front(), "s3");
+  BOOST_CHECK_EQUAL(backward[1], "s2");
+  BOOST_CHECK_EQUAL(backward.back(), "s1");
+  BOOST_CHECK(std::ranges::equal(
+    backward,
+    std::vector<StationId>{"s3", "s2", "s1"}));
+  BOOST_CHECK(std::ranges::equal(
+    std::ranges::reverse_view(backward),
+    forward));
+
+  BOOST_CHECK(pool.Intern({}).empty());
+  BOOST_CHECK(!pool.Intern({"s1", "s2"}).SharesStopsWith(forward));
+  BOOST_CHECK_EQUAL(pool.GetSequenceCount(), 2);
+
+  // The two directions of a line in the layout file share their stops.
+  const auto layout{
+    TransportNetworkParser::ParseFile(TESTS_NETWORK_LAYOUT_PATH)};
+  const auto &routes{layout.lines.front().routes};
+  BOOST_REQUIRE_EQUAL(routes.size(), 2);
+  BOOST_CHECK(routes[0]->stops.SharesStopsWith(routes[1]->stops));
+  BOOST_CHECK(routes[0]->stops == routes[1]->stops.Reversed());
+  BOOST_CHECK_EQUAL(routes[0]->stops.front(), routes[0]->startStationId);
+  BOOST_CHECK_EQUAL(routes[1]->stops.front(), routes[1]->startStationId);
+}
+
+BOOST_AUTO_TEST_CASE(ItineraryCache)
+{
+  // Slots are only allocated as itineraries are cached.
+  BOOST_CHECK_LT(TransportNetwork{}.GetMemoryUsage().itineraryCache, 1024);
+
+  auto tn{MakeShortcutNetwork()};
+  BOOST_REQUIRE(tn.AddLine(MakeLine("line_c", "route_c", {"s3", "s5"})));
+  tn.BuildGraph();
+
+  const auto s1{tn.GetStationIndex("s1")};
+  const auto s3{tn.GetStationIndex("s3")};
+  const auto s4{tn.GetStationIndex("s4")};
+  const auto s5{tn.GetStationIndex("s5")};
+  const ItineraryOptions shortcut{.lineChangePenalty = 1};
+
+  Itinerary itinerary{};
+  BOOST_CHECK(tn.GetFastestPath(s1, s4, itinerary));
+  BOOST_CHECK(tn.GetFastestPath(s1, s4, itinerary));
+  BOOST_CHECK_EQUAL(itinerary.steps.size(), 4);
+  BOOST_CHECK_EQUAL(itinerary.totalTime, 6);
+  BOOST_CHECK_EQUAL(tn.GetItineraryCacheStats().hits, 1);
+  BOOST_CHECK_EQUAL(tn.GetItineraryCacheStats().misses, 1);
+
+  // Options are part of the key, and unreachable stations are cached too.
+  BOOST_CHECK_EQUAL(tn.GetFastestPath("s1", "s4", shortcut).totalTime, 5);
+  BOOST_CHECK(!tn.GetFastestPath(s4, s1, itinerary));
+  BOOST_CHECK(!tn.GetFastestPath(s4, s1, itinerary));
+  BOOST_CHECK(itinerary.Empty());
+  BOOST_CHECK(tn.GetFastestPath(s3, s5, itinerary));
+  BOOST_CHECK_EQUAL(itinerary.totalTime, 0);
+
+  auto stats{tn.GetItineraryCacheStats()};
+  BOOST_CHECK_EQUAL(stats.hits, 2);
+  BOOST_CHECK_EQUAL(stats.entries, 4);
+
+  // Timing the hop from s3 to s5 only drops the itinerary riding it.
+  const auto copy{tn};
+  BOOST_REQUIRE(tn.SetTravelTime("s3", "s5", 4));
+  stats = tn.GetItineraryCacheStats();
+  BOOST_CHECK_EQUAL(stats.invalidations, 1);
+  BOOST_CHECK_EQUAL(stats.entries, 3);
+  BOOST_CHECK_EQUAL(copy.GetItineraryCacheStats().entries, 4);
+
+  tn.BuildGraph();
+  BOOST_CHECK(tn.GetFastestPath(s3, s5, itinerary));
+  BOOST_CHECK_EQUAL(itinerary.totalTime, 4);
+  BOOST_CHECK(tn.GetFastestPath(s1, s4, itinerary));
+  BOOST_CHECK_EQUAL(tn.GetItineraryCacheStats().hits, 3);
+
+  // Removing a line only drops the itineraries that ride it.
+  BOOST_REQUIRE(tn.RemoveLine("line_b"));
+  stats = tn.GetItineraryCacheStats();
+  BOOST_CHECK_EQUAL(stats.entries, 3);
+  tn.BuildGraph();
+  const auto direct{tn.GetFastestPath("s1", "s4", shortcut)};
+  BOOST_CHECK_EQUAL(direct.totalTime, 6);
+  BOOST_CHECK_EQUAL(tn.GetRouteId(direct.steps.back().route), "route_a");
+  BOOST_CHECK(tn.GetFastestPath(s1, s4, itinerary));
+  BOOST_CHECK_EQUAL(tn.GetItineraryCacheStats().hits, 4);
+
+  // Adding a line may shorten any itinerary.
+  BOOST_REQUIRE(tn.AddLine(MakeLine("line_d", "route_d", {"s1", "s4"})));
+  BOOST_CHECK_EQUAL(tn.GetItineraryCacheStats().entries, 0);
+
+  tn.SetItineraryCacheCapacity(1);
+  tn.BuildGraph();
+  BOOST_CHECK(tn.GetFastestPath(s1, s4, itinerary));
+  BOOST_CHECK(tn.GetFastestPath(s3, s4, itinerary));
+  BOOST_CHECK(tn.GetFastestPath(s3, s4, itinerary));
+  stats = tn.GetItineraryCacheStats();
+  BOOST_CHECK_EQUAL(stats.entries, 1);
+  BOOST_CHECK_EQUAL(stats.evictions, 1);
+  BOOST_CHECK_EQUAL(stats.hits, 1);
+}
+
+BOOST_AUTO_TEST_CASE(ShardedIngestion)
+{
+  auto tn{MakeShortcutNetwork()};
+  tn.BuildGraph();
+
+  constexpr int kThreads{4};
+  constexpr int kEventsPerThread{2000};
+  const std::vector<StationId> stationIds{"s1", "s2", "s3", "s4", "s5"};
+
+  {
+    ShardedPassengerIngestor ingestor{tn, 3, 64};
+    BOOST_CHECK_EQUAL(ingestor.GetShardCount(), 3);
+    BOOST_CHECK(!ingestor.Record({"unknown", PassengerEvent::Type::kIn}));
+    BOOST_CHECK(!ingestor.Record(
+      tn.GetStationIndex("s1"),
+      PassengerEvent::Type::kSizeOfEnum));
+
+    // The queues are far smaller than the events, so producers wait on the
+    // workers too.
+    std::vector<std::size_t> queued(kThreads, 0);
+    {
+      std::vector<std::jthread> producers;
+      for (int thread{0}; thread < kThreads; ++thread) {
+        producers.emplace_back([&ingestor, &stationIds, &queued, thread]() {
+          for (int i{0}; i < kEventsPerThread; ++i) {
+            const auto &stationId{
+              stationIds[(thread + i) % stationIds.size()]};
+            queued[thread] +=
+              ingestor.Record({stationId, PassengerEvent::Type::kIn}) ? 1 : 0;
+          }
+        });
+      }
+    }
+
+    for (const auto count : queued) {
+      BOOST_CHECK_EQUAL(count, kEventsPerThread);
+    }
+
+    ingestor.Drain();
+
+    std::size_t total{0};
+    for (const auto &stationId : stationIds) {
+      total += ingestor.GetPassengerCount(tn.GetStationIndex(stationId));
+    }
+    BOOST_CHECK_EQUAL(total, kThreads * kEventsPerThread);
+    BOOST_CHECK_EQUAL(ingestor.GetStats().accepted, total);
+
+    // Rejections only show once the events are applied.
+    const std::vector<PassengerEvent> out(
+      total + 1,
+      PassengerEvent{"s1", PassengerEvent::Type::kOut});
+    BOOST_CHECK_EQUAL(ingestor.Record(out), out.size());
+    ingestor.Drain();
+    BOOST_CHECK_EQUAL(tn.GetPassengerCount("s1"), 0);
+    BOOST_CHECK_EQUAL(
+      ingestor.GetStats().rejected,
+      out.size() - kThreads * kEventsPerThread / stationIds.size());
+
+    // Drain() covers a producer's events even while others keep queueing
+    // onto the same shards.
+    std::atomic<int> drainFailures{0};
+    {
+      std::vector<std::jthread> producers;
+      for (int thread{0}; thread < kThreads; ++thread) {
+        producers.emplace_back([&, thread]() {
+          const auto station{tn.GetStationIndex(stationIds[thread])};
+          const auto before{ingestor.GetPassengerCount(station)};
+          for (int i{0}; i < kEventsPerThread; ++i) {
+            ingestor.Record(station, PassengerEvent::Type::kIn);
+            if (i % 100 == 99) {
+              ingestor.Drain();
+              if (ingestor.GetPassengerCount(station) != before + i + 1) {
+                drainFailures++;
+              }
+            }
+          }
+
+          for (int i{0}; i < kEventsPerThread; ++i) {
+            ingestor.Record(station, PassengerEvent::Type::kOut);
+          }
+        });
+      }
+    }
+    BOOST_CHECK_EQUAL(drainFailures.load(), 0);
+    ingestor.Drain();
+
+    BOOST_CHECK(ingestor.Record({"s2", PassengerEvent::Type::kIn}));
+  }
+
+  // Destroying the ingestor applies what is still queued.
+  BOOST_CHECK_EQUAL(
+    tn.GetPassengerCount("s2"),
+    kThreads * kEventsPerThread / stationIds.size() + 1);
+  BOOST_CHECK_GT(tn.GetSegmentLoad(tn.GetRouteIndex("route_a"), 1), 0.0);
+}
+
+BOOST_AUTO_TEST_CASE(GetMemoryUsage)
+{
+  TransportNetworkBuilder builder{};
+  builder.AddLayout(
+    TransportNetworkParser::ParseFile(TESTS_NETWORK_LAYOUT_PATH));
+  auto tn{builder.Build()};
+
+  const auto before{tn.GetMemoryUsage()};
+  BOOST_CHECK_GT(before.ids, 0);
+  BOOST_CHECK_GE(before.stations, tn.GetStationCount() * sizeof(Station));
+  BOOST_CHECK_GT(before.stationRoutes, 0);
+  BOOST_CHECK_GT(before.lines, 0);
+  BOOST_CHECK_GT(before.routes, 0);
+  BOOST_CHECK_GT(before.travelTimes, 0);
+  BOOST_CHECK_EQUAL(before.graph, 0);
+  BOOST_CHECK_EQUAL(before.segmentLoads, 0);
+  BOOST_CHECK_EQUAL(before.travelTimeMatrix, 0);
+  BOOST_CHECK_EQUAL(
+    before.Total(),
+    before.ids + before.stations + before.stationRoutes + before.lines +
+      before.routes + before.passengerEvents + before.travelTimes +
+      before.itineraryCache);
+
+  tn.BuildGraph();
+  tn.PrecomputeTravelTimes({}, 2);
+  BOOST_CHECK(!tn.GetFastestPath("station_000", "station_024").Empty());
+
+  const auto after{tn.GetMemoryUsage()};
+  BOOST_CHECK_GT(after.graph, 0);
+  BOOST_CHECK_GT(after.segmentLoads, 0);
+  BOOST_CHECK_GE(
+    after.travelTimeMatrix,
+    tn.GetStationCount() * tn.GetStationCount() *
+      sizeof(TravelTimeMatrix::Time));
+  BOOST_CHECK_GT(after.itineraryCache, before.itineraryCache);
+  BOOST_CHECK_EQUAL(after.stations, before.stations);
+  BOOST_CHECK_GT(after.Total(), before.Total());
+
+  // Both directions of a line share their stops, which count once however
+  // many routes, or holders outside the network, share them.
+  const auto layout{
+    TransportNetworkParser::ParseFile(TESTS_NETWORK_LAYOUT_PATH)};
+  const auto &routes{layout.lines.front().routes};
+  BOOST_REQUIRE(routes[0]->stops.SharesStopsWith(routes[1]->stops));
+  BOOST_CHECK_GE(
+    routes[0]->stops.GetMemoryUsage(),
+    routes[0]->stops.size() * sizeof(StationId));
+
+  TransportNetworkBuilder sharedBuilder{};
+  sharedBuilder.AddLayout(layout);
+  const auto shared{sharedBuilder.Build()};
+  const auto routesBytes{shared.GetMemoryUsage().routes};
+  const std::vector<StopSequence> held(8, routes[0]->stops);
+  BOOST_CHECK_EQUAL(shared.GetMemoryUsage().routes, routesBytes);
+}
+
+BOOST_AUTO_TEST_CASE(GenerateLayout)
+{
+  const LayoutGeneratorOptions options{
+    .stationCount = 2000,
+    .lineCount = 40,
+    .routeLength = 60,
+    .interchangeDensity = 0.3,
+    .seed = 7};
+  const auto layout{LayoutGenerator::Generate(options)};
+  BOOST_CHECK_EQUAL(layout.stations.size(), options.stationCount);
+  BOOST_REQUIRE_EQUAL(layout.lines.size(), options.lineCount);
+
+  std::unordered_map<StationId, std::size_t> linesPerStation{};
+  for (const auto &line : layout.lines) {
+    BOOST_REQUIRE_EQUAL(line.routes.size(), 2);
+    const auto &inbound{*line.routes[0]};
+    const auto &outbound{*line.routes[1]};
+    BOOST_CHECK_EQUAL(inbound.stops.size(), options.routeLength);
+    BOOST_CHECK(inbound.direction == RouteDirection::kInbound);
+    BOOST_CHECK(outbound.direction == RouteDirection::kOutbound);
+    BOOST_CHECK(outbound.stops == inbound.stops.Reversed());
+    BOOST_CHECK(outbound.stops.SharesStopsWith(inbound.stops));
+    BOOST_CHECK_EQUAL(inbound.startStationId, inbound.stops.front());
+    BOOST_CHECK_EQUAL(outbound.startStationId, inbound.stops.back());
+
+    for (const auto &stop : inbound.stops) {
+      linesPerStation[stop]++;
+    }
+
+    std::vector<StationId> stops(inbound.stops.begin(), inbound.stops.end());
+    std::ranges::sort(stops);
+    BOOST_CHECK(std::ranges::adjacent_find(stops) == stops.end());
+  }
+
+  const auto interchanges{std::ranges::count_if(
+    linesPerStation,
+    [](const auto &entry) { return entry.second > 1; })};
+  BOOST_CHECK_GT(interchanges, 0);
+
+  // Same seed, same layout; the stream decides every stop.
+  const auto again{LayoutGenerator::Generate(options)};
+  BOOST_CHECK(again.stations == layout.stations);
+  for (std::size_t i{0}; i < layout.lines.size(); ++i) {
+    BOOST_CHECK(*again.lines[i].routes[0] == *layout.lines[i].routes[0]);
+  }
+
+  BOOST_REQUIRE_EQUAL(again.travelTimes.size(), layout.travelTimes.size());
+  for (std::size_t i{0}; i < layout.travelTimes.size(); ++i) {
+    BOOST_CHECK_EQUAL(
+      again.travelTimes[i].travelTime,
+      layout.travelTimes[i].travelTime);
+  }
+
+  auto reseeded{options};
+  reseeded.seed = 8;
+  BOOST_CHECK(
+    *LayoutGenerator::Generate(reseeded).lines.back().routes[0] !=
+    *layout.lines.back().routes[0]);
+
+  // Every line reaches an earlier one through an interchange.
+  TransportNetworkBuilder builder{};
+  builder.AddLayout(layout);
+  auto tn{builder.Build()};
+  tn.BuildGraph();
+  BOOST_CHECK_EQUAL(tn.GetStationCount(), options.stationCount);
+  for (const auto &line : layout.lines) {
+    BOOST_CHECK(
+      !tn.GetFastestPath(
+           layout.lines.front().routes[0]->startStationId,
+           line.routes[0]->endStationId)
+         .Empty());
+  }
+
+  BOOST_CHECK_THROW(
+    LayoutGenerator::Generate({.stationCount = 10, .routeLength = 11}),
+    std::invalid_argument);
+  BOOST_CHECK_THROW(
+    LayoutGenerator::Generate({.interchangeDensity = 1.5}),
+    std::invalid_argument);
+  BOOST_CHECK_THROW(
+    LayoutGenerator::Generate({.minTravelTime = 0}),
+    std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(WriteGeneratedLayout)
+{
+  const auto layout{LayoutGenerator::Generate(
+    {.stationCount = 300, .lineCount = 8, .routeLength = 40, .seed = 3})};
+
+  std::stringstream output{};
+  TransportNetworkWriter::Write(layout, output);
+  const auto parsed{TransportNetworkParser::Parse(output)};
+
+  BOOST_CHECK(parsed.stations == layout.stations);
+  BOOST_REQUIRE_EQUAL(parsed.lines.size(), layout.lines.size());
+  for (std::size_t i{0}; i < layout.lines.size(); ++i) {
+    BOOST_CHECK(std::ranges::equal(
+      parsed.lines[i].routes,
+      layout.lines[i].routes,
+      [](const auto &lhs, const auto &rhs) { return *lhs == *rhs; }));
+  }
+
+  BOOST_REQUIRE_EQUAL(parsed.travelTimes.size(), layout.travelTimes.size());
+  for (std::size_t i{0}; i < layout.travelTimes.size(); ++i) {
+    const auto &lhs{parsed.travelTimes[i]};
+    const auto &rhs{layout.travelTimes[i]};
+    BOOST_CHECK_EQUAL(lhs.startStationId, rhs.startStationId);
+    BOOST_CHECK_EQUAL(lhs.endStationId, rhs.endStationId);
+    BOOST_CHECK_EQUAL(lhs.routeId, rhs.routeId);
+    BOOST_CHECK_EQUAL(lhs.travelTime, rhs.travelTime);
+  }
+
+  // The layout file survives a round trip too.
+  const auto original{
+    TransportNetworkParser::ParseFile(TESTS_NETWORK_LAYOUT_PATH)};
+  std::stringstream rewritten{};
+  TransportNetworkWriter::Write(original, rewritten);
+  const auto reparsed{TransportNetworkParser::Parse(rewritten)};
+  BOOST_CHECK(reparsed.stations == original.stations);
+  BOOST_CHECK_EQUAL(reparsed.travelTimes.size(), original.travelTimes.size());
+  BOOST_CHECK(
+    *reparsed.lines.back().routes.back() ==
+    *original.lines.back().routes.back());
+}
+
+BOOST_AUTO_TEST_CASE(GeneratePassengerEvents)
+{
+  const auto layout{LayoutGenerator::Generate(
+    {.stationCount = 500, .lineCount = 10, .routeLength = 50, .seed = 5})};
+  const PassengerEventOptions options{.eventCount = 20000, .seed = 11};
+  const auto events{LayoutGenerator::GeneratePassengerEvents(layout, options)};
+  BOOST_REQUIRE_EQUAL(events.size(), options.eventCount);
+  BOOST_CHECK(std::ranges::is_sorted(events, {}, &PassengerEvent::m_timestamp));
+  BOOST_CHECK(events.front().m_timestamp >= options.start);
+
+  const auto outs{std::ranges::count(
+    events,
+    PassengerEvent::Type::kOut,
+    &PassengerEvent::m_type)};
+  BOOST_CHECK_GT(outs, 0);
+  BOOST_CHECK_LE(static_cast<std::size_t>(outs), events.size() / 2);
+
+  // Nobody leaves a station they did not enter, so nothing is rejected.
+  TransportNetworkBuilder builder{};
+  builder.AddLayout(layout);
+  const auto tn{builder.Build()};
+  BOOST_CHECK(tn.RecordPassengerEvents(events).none());
+
+  const auto again{LayoutGenerator::GeneratePassengerEvents(layout, options)};
+  BOOST_CHECK(std::ranges::equal(
+    events,
+    again,
+    [](const auto &lhs, const auto &rhs) {
+      return lhs.m_stationId == rhs.m_stationId && lhs.m_type == rhs.m_type &&
+             lhs.m_timestamp == rhs.m_timestamp;
+    }));
+
+  std::stringstream output{};
+  TransportNetworkWriter::WritePassengerEvents(events, output);
+  const auto parsed{TransportNetworkParser::ParsePassengerEvents(output)};
+  BOOST_CHECK(std::ranges::equal(
+    events,
+    parsed,
+    [](const auto &lhs, const auto &rhs) {
+      return lhs.m_stationId == rhs.m_stationId && lhs.m_type == rhs.m_type &&
+             lhs.m_timestamp == rhs.m_timestamp;
+    }));
+
+  std::istringstream malformed{R"({"station_id": "station_000"})"};
+  BOOST_CHECK_THROW(
+    TransportNetworkParser::ParsePassengerEvents(malformed),
+    std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(MemoryResource)
+{
+  // Passes allocations on to the heap, counting those still held.
+  class CountingResource : public std::pmr::memory_resource {
+  public:
+    std::size_t allocations{0};
+    std::size_t outstanding{0};
+
+  private:
+    auto do_allocate(std::size_t bytes, std::size_t alignment)
+      -> void * override
+    {
+      allocations++;
+      outstanding++;
+      return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void *p, std::size_t bytes, std::size_t alignment)
+      override
+    {
+      outstanding--;
+      std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+
+    auto do_is_equal(const std::pmr::memory_resource &other) const noexcept
+      -> bool override
+    {
+      return this == &other;
+    }
+  };
+
+  const auto layout{
+    TransportNetworkParser::ParseFile(TESTS_NETWORK_LAYOUT_PATH)};
+  auto pResource{std::make_shared<CountingResource>()};
+  {
+    TransportNetworkBuilder builder{pResource};
+    builder.AddLayout(layout);
+    auto tn{builder.Build()};
+    BOOST_CHECK(tn.GetMemoryResource() == pResource);
+    BOOST_CHECK_GT(pResource->allocations, tn.GetStationCount());
+
+    // Copies allocate from the same resource, and keep it alive along with
+    // every station handed out.
+    auto copy{tn};
+    const auto before{pResource->allocations};
+    BOOST_CHECK(copy.AddStation(Station{"station_new", "New"}));
+    BOOST_CHECK_GT(pResource->allocations, before);
+
+    const auto pStation{tn.GetStation("station_000")};
+    tn = TransportNetwork{};
+    copy = TransportNetwork{};
+    BOOST_CHECK_EQUAL(pStation->m_id, "station_000");
+    BOOST_CHECK_GT(pResource.use_count(), 1);
+  }
+
+  BOOST_CHECK_EQUAL(pResource->outstanding, 0);
+  BOOST_CHECK_EQUAL(pResource.use_count(), 1);
+
+  // By default every network gets an arena of its own.
+  std::weak_ptr<std::pmr::memory_resource> pArena{};
+  std::weak_ptr<std::pmr::memory_resource> pOtherArena{};
+  std::shared_ptr<Station> pStation{};
+  {
+    TransportNetworkBuilder builder{};
+    builder.AddLayout(layout);
+    auto tn{builder.Build()};
+    const auto *pNetworkArena{
+      dynamic_cast<const NetworkArena *>(tn.GetMemoryResource().get())};
+    BOOST_REQUIRE(pNetworkArena != nullptr);
+    BOOST_CHECK_GT(
+      pNetworkArena->GetAllocatedBytes(),
+      tn.GetStationCount() * sizeof(Station));
+    BOOST_CHECK_EQUAL(
+      tn.GetMemoryUsage().arenaBytes,
+      pNetworkArena->GetAllocatedBytes());
+
+    // Changes after the load reuse the memory they free.
+    BOOST_REQUIRE(tn.AddStation(Station{"station_tmp", "Temporary"}));
+    BOOST_REQUIRE(tn.RemoveStation("station_tmp"));
+    const auto loaded{pNetworkArena->GetAllocatedBytes()};
+    for (std::size_t i{0}; i < 1000; ++i) {
+      BOOST_REQUIRE(tn.AddStation(Station{"station_tmp", "Temporary"}));
+      BOOST_REQUIRE(tn.RemoveStation("station_tmp"));
+    }
+    BOOST_CHECK_EQUAL(pNetworkArena->GetAllocatedBytes(), loaded);
+    pArena = tn.GetMemoryResource();
+    pStation = tn.GetStation("station_000");
+
+    // Assignment hands the arena over together with what lives in it.
+    TransportNetwork other{};
+    pOtherArena = other.GetMemoryResource();
+    other = std::move(tn);
+    BOOST_CHECK(other.GetMemoryResource() == pArena.lock());
+    other.BuildGraph();
+    BOOST_CHECK(!other.GetFastestPath("station_000", "station_024").Empty());
+    BOOST_CHECK(other.AddStation(Station{"station_new", "New"}));
+  }
+
+  BOOST_CHECK(pOtherArena.expired());
+  BOOST_CHECK(!pArena.expired());
+  BOOST_CHECK_EQUAL(pStation->m_id, "station_000");
+  pStation.reset();
+  BOOST_CHECK(pArena.expired());
+
+  // So do they in an arena the caller supplies, once no builder sharing it
+  // is loading a network any more.
+  {
+    const auto pSharedArena{std::make_shared<NetworkArena>()};
+    std::optional<TransportNetworkBuilder> pending{std::in_place, pSharedArena};
+    BOOST_REQUIRE(pending->AddStation(Station{"station_pending", "Pending"}));
+
+    TransportNetworkBuilder builder{pSharedArena};
+    builder.AddLayout(layout);
+    auto tn{builder.Build()};
+    const auto churn{[&tn]() {
+      for (std::size_t i{0}; i < 1000; ++i) {
+        BOOST_REQUIRE(tn.AddStation(Station{"station_tmp", "Temporary"}));
+        BOOST_REQUIRE(tn.RemoveStation("station_tmp"));
+      }
+    }};
+
+    auto loaded{pSharedArena->GetAllocatedBytes()};
+    churn();
+    BOOST_CHECK_GT(pSharedArena->GetAllocatedBytes(), loaded);
+
+    // Dropped before building, the other builder ends its load all the same.
+    pending.reset();
+    churn();
+    loaded = pSharedArena->GetAllocatedBytes();
+    churn();
+    BOOST_CHECK_EQUAL(pSharedArena->GetAllocatedBytes(), loaded);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(ForkNetwork)
+{
+  auto origin{MakeShortcutNetwork()};
+  origin.BuildGraph();
+  BOOST_REQUIRE(origin.RecordPassengerEvent({"s2", PassengerEvent::Type::kIn}));
+  BOOST_REQUIRE(origin.RecordPassengerEvent({"s2", PassengerEvent::Type::kIn}));
+
+  auto fork{origin.Fork()};
+  BOOST_CHECK(fork.FindStation("s2") == origin.FindStation("s2"));
+  BOOST_CHECK(fork.GetGraph() == origin.GetGraph());
+  BOOST_CHECK(fork.GetMemoryResource() != origin.GetMemoryResource());
+
+  // The fork's counts are those of the origin when forked, and neither
+  // network's events reach the other.
+  BOOST_REQUIRE(origin.RecordPassengerEvent({"s2", PassengerEvent::Type::kIn}));
+  BOOST_CHECK_EQUAL(fork.GetPassengerCount("s2"), 2);
+  BOOST_CHECK(fork.RecordPassengerEvent({"s2", PassengerEvent::Type::kIn}));
+  BOOST_REQUIRE(origin.RecordPassengerEvent({"s2", PassengerEvent::Type::kIn}));
+  BOOST_CHECK_EQUAL(fork.GetPassengerCount("s2"), 3);
+  BOOST_CHECK_EQUAL(origin.GetPassengerCount("s2"), 4);
+
+  // A station handed out by the fork is the fork's own, cloned once, and
+  // events recorded into it count for the fork alone.
+  const auto pForked{fork.GetStation("s2")};
+  BOOST_REQUIRE(pForked);
+  BOOST_CHECK(pForked.get() != origin.FindStation("s2"));
+  BOOST_CHECK(fork.GetStation("s2") == pForked);
+  BOOST_CHECK_EQUAL(pForked->GetPassengerCount(), 3);
+  BOOST_REQUIRE(pForked->RecordPassengerEvent(PassengerEvent::Type::kIn));
+  BOOST_CHECK_EQUAL(origin.GetPassengerCount("s2"), 4);
+  BOOST_CHECK_EQUAL(origin.GetStation("s2")->GetPassengerCount(), 4);
+  BOOST_CHECK_EQUAL(fork.GetPassengerCount("s2"), 4);
+  BOOST_CHECK(fork.RecordPassengerEvent({"s2", PassengerEvent::Type::kOut}));
+  BOOST_CHECK(fork.RecordPassengerEvent({"s2", PassengerEvent::Type::kOut}));
+  BOOST_CHECK_EQUAL(fork.GetPassengerCount("s2"), 2);
+  BOOST_CHECK_EQUAL(pForked->GetPassengerCount(), 2);
+
+  // Events recorded into stations the origin handed out before forking do
+  // not reach the fork either.
+  const auto pHeld{origin.GetStation("s4")};
+  const auto held{origin.Fork()};
+  BOOST_REQUIRE(pHeld->RecordPassengerEvent(PassengerEvent::Type::kIn));
+  BOOST_CHECK_EQUAL(origin.GetPassengerCount("s4"), 1);
+  BOOST_CHECK_EQUAL(fork.GetPassengerCount("s4"), 0);
+  BOOST_CHECK_EQUAL(held.GetPassengerCount("s4"), 0);
+  BOOST_CHECK_GT(fork.GetMemoryUsage().forkedPassengerCounts, 0);
+  BOOST_CHECK_EQUAL(origin.GetMemoryUsage().forkedPassengerCounts, 0);
+  BOOST_CHECK(!fork.RecordPassengerEvent({"s3", PassengerEvent::Type::kOut}));
+
+  const PassengerTimestamp timestamp{std::chrono::seconds{1704067200}};
+  const auto rates{
+    origin.GetPassengerRates("s1", std::chrono::minutes{1}, timestamp)};
+  const std::vector<PassengerEvent> events{
+    {"s1", PassengerEvent::Type::kIn, timestamp},
+    {"s1", PassengerEvent::Type::kIn, timestamp},
+    {"s1", PassengerEvent::Type::kOut, timestamp},
+    {"s3", PassengerEvent::Type::kOut, timestamp}};
+  const auto rejections{fork.RecordPassengerEvents(events)};
+  BOOST_CHECK_EQUAL(rejections.count(), 1);
+  BOOST_CHECK(rejections.test(3));
+  BOOST_CHECK_EQUAL(fork.GetPassengerCount("s1"), 1);
+  BOOST_CHECK_EQUAL(origin.GetPassengerCount("s1"), 0);
+  BOOST_CHECK_EQUAL(
+    origin.GetPassengerRates("s1", std::chrono::minutes{1}, timestamp).in,
+    rates.in);
+
+  // Segment loads of the fork start from zero and stay its own.
+  const auto routeA{origin.GetRouteIndex("route_a")};
+  const std::chrono::minutes window{1};
+  BOOST_CHECK_GT(fork.GetSegmentLoad(routeA, 0, window, timestamp), 0.0);
+  BOOST_CHECK_EQUAL(origin.GetSegmentLoad(routeA, 0, window, timestamp), 0.0);
+
+  // Closing the shortcut in the fork leaves the origin as it was.
+  BOOST_REQUIRE(fork.RemoveLine("line_b"));
+  BOOST_REQUIRE(fork.RemoveStation("s5"));
+  BOOST_CHECK(origin.FindLine("line_b") != nullptr);
+  BOOST_CHECK(origin.FindStation("s5") != nullptr);
+  BOOST_CHECK_EQUAL(origin.GetRoutesServingStation("s2").size(), 2);
+  BOOST_CHECK_EQUAL(origin.GetTravelTime("s2", "s5"), 1);
+  BOOST_CHECK_EQUAL(fork.GetTravelTime("s2", "s5"), 0);
+  BOOST_CHECK_EQUAL(fork.GetPassengerCount("s2"), 2);
+
+  fork.BuildGraph();
+  const ItineraryOptions options{.lineChangePenalty = 1};
+  const auto detour{fork.GetFastestPath("s1", "s4", options)};
+  const auto shortcut{origin.GetFastestPath("s1", "s4", options)};
+  BOOST_REQUIRE(!detour.Empty());
+  BOOST_CHECK_EQUAL(detour.travelTime, 6);
+  BOOST_CHECK_EQUAL(shortcut.travelTime, 4);
+
+  // A station added back to the fork comes with a count of its own.
+  BOOST_REQUIRE(origin.RecordPassengerEvent({"s5", PassengerEvent::Type::kIn}));
+  BOOST_REQUIRE(fork.AddStation(Station{"s5", "Station s5", 7}));
+  BOOST_CHECK_EQUAL(fork.GetPassengerCount("s5"), 7);
+  BOOST_CHECK_EQUAL(origin.GetPassengerCount("s5"), 1);
+
+  // Forks of forks start from the counts of the fork they were made from,
+  // including those of its clones.
+  const auto nested{fork.Fork()};
+  BOOST_CHECK_EQUAL(nested.GetPassengerCount("s2"), 2);
+  BOOST_CHECK_EQUAL(nested.GetPassengerCount("s5"), 7);
+  BOOST_REQUIRE(fork.RecordPassengerEvent({"s2", PassengerEvent::Type::kIn}));
+  BOOST_REQUIRE(pForked->RecordPassengerEvent(PassengerEvent::Type::kIn));
+  BOOST_REQUIRE(fork.RecordPassengerEvent({"s5", PassengerEvent::Type::kIn}));
+  BOOST_CHECK_EQUAL(fork.GetPassengerCount("s2"), 4);
+  BOOST_CHECK_EQUAL(nested.GetPassengerCount("s2"), 2);
+  BOOST_CHECK_EQUAL(nested.GetPassengerCount("s5"), 7);
+  BOOST_CHECK(nested.FindLine("line_b") == nullptr);
+  const auto pNested{nested.GetStation("s2")};
+  BOOST_REQUIRE(pNested->RecordPassengerEvent(PassengerEvent::Type::kOut));
+  BOOST_CHECK_EQUAL(nested.GetPassengerCount("s2"), 1);
+  BOOST_CHECK_EQUAL(fork.GetPassengerCount("s2"), 4);
+  BOOST_CHECK_EQUAL(origin.GetPassengerCount("s2"), 4);
+
+  // Concurrent what-if simulations on one origin.
+  const auto before{origin.GetPassengerCount("s2")};
+  std::atomic<std::size_t> detours{0};
+  std::atomic<std::size_t> failures{0};
+  std::vector<std::thread> threads;
+  for (std::size_t i{0}; i < 8; ++i) {
+    threads.emplace_back([&, i]() {
+      auto simulation{origin.Fork()};
+      if (!simulation.RemoveLine(i % 2 == 0 ? "line_b" : "line_a")) {
+        failures++;
+      }
+
+      for (std::size_t j{0}; j < 100; ++j) {
+        simulation.RecordPassengerEvent({"s2", PassengerEvent::Type::kIn});
+      }
+
+      simulation.BuildGraph();
+      if (simulation.GetFastestPath("s1", "s4", options).travelTime == 6) {
+        detours++;
+      }
+
+      if (simulation.GetPassengerCount("s2") != before + 100) {
+        failures++;
+      }
+    });
+  }
+
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  BOOST_CHECK_EQUAL(detours.load(), 4);
+  BOOST_CHECK_EQUAL(failures.load(), 0);
+  BOOST_CHECK_EQUAL(origin.GetPassengerCount("s2"), before);
+  BOOST_CHECK(origin.FindLine("line_a") != nullptr);
+  BOOST_CHECK(origin.FindLine("line_b") != nullptr);
+
+  // Forks keep their counts while the origin's change under them.
+  std::vector<TransportNetwork> simulations;
+  for (std::size_t i{0}; i < 4; ++i) {
+    simulations.push_back(origin.Fork());
+  }
+
+  threads.clear();
+  threads.emplace_back([&origin]() {
+    for (std::size_t j{0}; j < 1000; ++j) {
+      origin.RecordPassengerEvent({"s2", PassengerEvent::Type::kIn});
+    }
+  });
+  for (auto &simulation : simulations) {
+    threads.emplace_back([&simulation, &failures, before]() {
+      for (std::size_t j{0}; j < 1000; ++j) {
+        if (simulation.GetPassengerCount("s2") != before + j) {
+          failures++;
+        }
+
+        simulation.RecordPassengerEvent({"s2", PassengerEvent::Type::kIn});
+      }
+    });
+  }
+
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  BOOST_CHECK_EQUAL(failures.load(), 0);
+  BOOST_CHECK_EQUAL(origin.GetPassengerCount("s2"), before + 1000);
+}
+
+BOOST_AUTO_TEST_CASE(ReplayPassengerEvents)
+{
+  const auto layout{LayoutGenerator::Generate(
+    {.stationCount = 200, .lineCount = 8, .routeLength = 30, .seed = 3})};
+  TransportNetworkBuilder builder{};
+  builder.AddLayout(layout);
+  auto tn{builder.Build()};
+  tn.BuildGraph();
+
+  // An out at an empty station and an unknown station are both rejected.
+  auto events{LayoutGenerator::GeneratePassengerEvents(
+    layout,
+    {.eventCount = 5000, .seed = 7})};
+  events.insert(
+    events.begin(),
+    PassengerEvent{
+      "station_000",
+      PassengerEvent::Type::kOut,
+      events.front().m_timestamp});
+  events.push_back(PassengerEvent{
+    "unknown",
+    PassengerEvent::Type::kIn,
+    events.back().m_timestamp});
+
+  // Recording the events one by one in order is the reference.
+  const auto reference{tn.Fork()};
+  std::size_t accepted{0};
+  for (const auto &event : events) {
+    accepted += reference.RecordPassengerEvent(event) ? 1 : 0;
+  }
+
+  const PassengerEventReplay replay{tn, events};
+  BOOST_CHECK_EQUAL(replay.GetEventCount(), events.size());
+  const auto checksum{PassengerEventReplay::Checksum(reference)};
+  const auto routeCount{tn.GetGraph()->GetRouteCount()};
+  for (const auto threadCount : {std::size_t{1}, std::size_t{3}}) {
+    const auto fork{tn.Fork()};
+    const auto report{replay.Run(fork, {.threadCount = threadCount})};
+    BOOST_CHECK_EQUAL(report.accepted, accepted);
+    BOOST_CHECK_EQUAL(report.rejected, 2);
+    BOOST_CHECK_EQUAL(report.checksum, checksum);
+    BOOST_CHECK_EQUAL(PassengerEventReplay::Checksum(fork), checksum);
+    BOOST_CHECK_GT(report.EventsPerSecond(), 0.0);
+    for (RouteIndex route{0}; route < routeCount; ++route) {
+      const auto end{events.back().m_timestamp};
+      BOOST_CHECK_CLOSE(
+        fork.GetSegmentLoad(route, 0, SegmentLoadEstimator::kWindow, end),
+        reference.GetSegmentLoad(route, 0, SegmentLoadEstimator::kWindow, end),
+        1e-9);
+    }
+  }
+
+  // The forks replayed into leave the network itself as it was.
+  BOOST_CHECK_NE(PassengerEventReplay::Checksum(tn), checksum);
+
+  // Paced to the timestamps of the first 100 events, sped up twentyfold.
+  const std::span<const PassengerEvent> head{events.data(), 100};
+  const auto span{head.back().m_timestamp - head.front().m_timestamp};
+  const PassengerEventReplay paced{tn, head};
+  const auto report{paced.Run(tn.Fork(), {.speed = 20.0})};
+  BOOST_CHECK_EQUAL(report.accepted + report.rejected, head.size());
+  BOOST_CHECK_GE(report.elapsed, span / 20);
+
+  BOOST_CHECK_THROW(
+    static_cast<void>(replay.Run(TransportNetwork{})),
+    std::logic_error);
+}
+
+BOOST_AUTO_TEST_CASE(JournalAndRecoverPassengerEvents)
+{
+  const auto layout{LayoutGenerator::Generate(
+    {.stationCount = 200, .lineCount = 8, .routeLength = 30, .seed = 5})};
+  const auto build{[&layout]() {
+    TransportNetworkBuilder builder{};
+    builder.AddLayout(layout);
+    return builder.Build();
+  }};
+  const auto events{LayoutGenerator::GeneratePassengerEvents(
+    layout,
+    {.eventCount = 20000, .seed = 11})};
+  const std::span<const PassengerEvent> all{events};
+  const auto first{all.first(5000)};
+  const auto second{all.subspan(5000, 10000)};
+  const auto third{all.subspan(15000)};
+
+  const TemporaryDirectory temporary{"transport-network-journal-"};
+  const auto &directory{temporary.Path()};
+
+  // Nothing journaled yet.
+  BOOST_CHECK(
+    !PassengerEventJournal::Recover(directory, build()).hasCheckpoint);
+
+  const auto tn{build()};
+  std::size_t afterCheckpoint{0};
+  {
+    PassengerEventJournal journal{tn, directory};
+    {
+      auto writer{journal.CreateWriter()};
+      writer.Record(first);
+    }
+
+    journal.Checkpoint();
+
+    // Two writers on stations of their own, so that the accepted events do
+    // not depend on the interleaving.
+    std::atomic<std::size_t> accepted{0};
+    const auto record{[&journal, &accepted, &tn, second](const bool even) {
+      auto writer{journal.CreateWriter()};
+      for (const auto &event : second) {
+        if ((tn.GetStationIndex(event.m_stationId) % 2 == 0) == even &&
+            writer.Record(event)) {
+          accepted++;
+        }
+      }
+    }};
+    {
+      const std::jthread thread{record, true};
+      record(false);
+    }
+
+    journal.Sync();
+    afterCheckpoint = accepted;
+  }
+
+  const auto checksum{PassengerEventReplay::Checksum(tn)};
+  const auto recovered{build()};
+  const auto recovery{PassengerEventJournal::Recover(directory, recovered)};
+  BOOST_CHECK(recovery.hasCheckpoint);
+  BOOST_CHECK_EQUAL(recovery.segmentCount, 1);
+  BOOST_CHECK_EQUAL(recovery.recordCount, afterCheckpoint);
+  BOOST_CHECK_EQUAL(recovery.discardedBytes, 0);
+  BOOST_CHECK_EQUAL(PassengerEventReplay::Checksum(recovered), checksum);
+  for (StationIndex station{0}; station < tn.GetStationCount(); ++station) {
+    BOOST_CHECK_EQUAL(
+      recovered.GetPassengerCount(station),
+      tn.GetPassengerCount(station));
+  }
+
+  // Statistics only cover the events replayed since the checkpoint.
+  const auto now{events.back().m_timestamp};
+  double recoveredRate{0.0};
+  double rate{0.0};
+  for (StationIndex station{0}; station < tn.GetStationCount(); ++station) {
+    recoveredRate +=
+      recovered.GetPassengerRates(station, std::chrono::hours{1}, now).in;
+    rate += tn.GetPassengerRates(station, std::chrono::hours{1}, now).in;
+  }
+
+  BOOST_CHECK_GT(recoveredRate, 0.0);
+  BOOST_CHECK_LT(recoveredRate, rate);
+
+  // A commit torn by a crash is discarded.
+  std::filesystem::path last{};
+  for (const auto &entry : std::filesystem::directory_iterator{directory}) {
+    if (entry.path().filename().string().starts_with("journal-")) {
+      last = std::max(last, entry.path());
+    }
+  }
+
+  {
+    std::ofstream output{last, std::ios::binary | std::ios::app};
+    output << "torn commit";
+  }
+
+  const auto torn{build()};
+  const auto tornRecovery{PassengerEventJournal::Recover(directory, torn)};
+  BOOST_CHECK_EQUAL(tornRecovery.recordCount, afterCheckpoint);
+  BOOST_CHECK_EQUAL(tornRecovery.discardedBytes, 11);
+  BOOST_CHECK_EQUAL(PassengerEventReplay::Checksum(torn), checksum);
+
+  // Carrying on from the recovered counts, checkpointing as segments fill.
+  {
+    PassengerEventJournal journal{
+      torn,
+      directory,
+      {.commitInterval = std::chrono::milliseconds{1},
+       .checkpointBytes = 4096}};
+    auto writer{journal.CreateWriter()};
+    for (std::size_t i{0}; i < third.size(); i += 500) {
+      writer.Record(
+        third.subspan(i, std::min<std::size_t>(500, third.size() - i)));
+      writer.Flush();
+      journal.Sync();
+    }
+  }
+
+  const auto again{build()};
+  const auto againRecovery{PassengerEventJournal::Recover(directory, again)};
+  BOOST_CHECK_EQUAL(againRecovery.discardedBytes, 0);
+  BOOST_CHECK_LT(againRecovery.recordCount, third.size());
+  BOOST_CHECK_NE(PassengerEventReplay::Checksum(again), checksum);
+  BOOST_CHECK_EQUAL(
+    PassengerEventReplay::Checksum(again),
+    PassengerEventReplay::Checksum(torn));
+
+  // A corrupt checkpoint is not recovered from.
+  {
+    std::fstream output{
+      directory / "checkpoint.bin",
+      std::ios::binary | std::ios::in | std::ios::out};
+    output.seekp(64);
+    output << "corrupt";
+  }
+
+  BOOST_CHECK_THROW(
+    PassengerEventJournal::Recover(directory, build()),
+    std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(RecoverWritersFlushedOutOfOrder)
+{
+  const TemporaryDirectory directory{"transport-network-journal-"};
+  const TemporaryDirectory crashed{"transport-network-crashed-"};
+
+  const auto tn{MakeShortcutNetwork()};
+  const auto s2{tn.GetStationIndex("s2")};
+  {
+    PassengerEventJournal journal{tn, directory.Path()};
+    auto first{journal.CreateWriter()};
+    auto second{journal.CreateWriter()};
+    BOOST_REQUIRE(first.Record(s2, PassengerEvent::Type::kIn));
+    BOOST_REQUIRE(second.Record(s2, PassengerEvent::Type::kOut));
+
+    // Crashing here loses the In, still batched in the first writer, but
+    // not the Out, which the checkpoint has counted too.
+    second.Flush();
+    journal.Checkpoint();
+    std::filesystem::copy(directory.Path(), crashed.Path());
+    first.Flush();
+  }
+
+  const auto lost{MakeShortcutNetwork()};
+  const auto lostRecovery{
+    PassengerEventJournal::Recover(crashed.Path(), lost)};
+  BOOST_CHECK(lostRecovery.hasCheckpoint);
+  BOOST_CHECK_EQUAL(lostRecovery.recordCount, 0);
+  BOOST_CHECK_EQUAL(lost.GetPassengerCount(s2), 0);
+
+  const auto recovered{MakeShortcutNetwork()};
+  const auto recovery{
+    PassengerEventJournal::Recover(directory.Path(), recovered)};
+  BOOST_CHECK_EQUAL(recovery.recordCount, 1);
+  BOOST_CHECK_EQUAL(recovered.GetPassengerCount(s2), tn.GetPassengerCount(s2));
+  BOOST_CHECK_EQUAL(recovered.GetPassengerCount(s2), 0);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
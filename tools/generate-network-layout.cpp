@@ -0,0 +1,111 @@
+#include <Structures/TransportNetwork/LayoutGenerator.h>
+#include <Structures/TransportNetwork/TransportNetworkWriter.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using namespace Structures::TransportNetwork;
+
+namespace {
+
+struct GeneratorOptions {
+  LayoutGeneratorOptions layout{};
+  PassengerEventOptions events{.eventCount = 0};
+  std::string layoutPath{"network-layout.json"};
+  std::string eventsPath{"passenger-events.jsonl"};
+};
+
+auto ParseOptions(const int argc, char **argv) -> GeneratorOptions
+{
+  GeneratorOptions options{};
+  for (int i{1}; i < argc; ++i) {
+    const std::string argument{argv[i]};
+    if (i + 1 == argc) {
+      throw std::invalid_argument("Missing value for " + argument);
+    }
+
+    const std::string value{argv[++i]};
+    if (argument == "--stations") {
+      options.layout.stationCount = std::stoul(value);
+    }
+    else if (argument == "--lines") {
+      options.layout.lineCount = std::stoul(value);
+    }
+    else if (argument == "--route-length") {
+      options.layout.routeLength = std::stoul(value);
+    }
+    else if (argument == "--interchange-density") {
+      options.layout.interchangeDensity = std::stod(value);
+    }
+    else if (argument == "--min-travel-time") {
+      options.layout.minTravelTime = std::stoul(value);
+    }
+    else if (argument == "--max-travel-time") {
+      options.layout.maxTravelTime = std::stoul(value);
+    }
+    else if (argument == "--seed") {
+      options.layout.seed = std::stoull(value);
+      options.events.seed = options.layout.seed;
+    }
+    else if (argument == "--events") {
+      options.events.eventCount = std::stoul(value);
+    }
+    else if (argument == "--event-interval-us") {
+      options.events.meanInterval =
+        std::chrono::microseconds{std::stoll(value)};
+    }
+    else if (argument == "--out-share") {
+      options.events.outShare = std::stod(value);
+    }
+    else if (argument == "--layout-output") {
+      options.layoutPath = value;
+    }
+    else if (argument == "--events-output") {
+      options.eventsPath = value;
+    }
+    else {
+      throw std::invalid_argument("Unknown option " + argument);
+    }
+  }
+
+  return options;
+}
+
+} // namespace
+
+// Writes a layout in the network-layout.json schema and, given --events, a
+// stream of passenger events at its stations. The same options always write
+// the same files.
+auto main(const int argc, char **argv) -> int
+{
+  try {
+    const auto options{ParseOptions(argc, argv)};
+    const auto layout{LayoutGenerator::Generate(options.layout)};
+    TransportNetworkWriter::WriteFile(layout, options.layoutPath);
+    std::cout << "Wrote " << layout.stations.size() << " stations, "
+              << layout.lines.size() << " lines and "
+              << layout.travelTimes.size() << " travel times to "
+              << options.layoutPath << '\n';
+
+    if (options.events.eventCount > 0) {
+      const auto events{
+        LayoutGenerator::GeneratePassengerEvents(layout, options.events)};
+      TransportNetworkWriter::WritePassengerEventsFile(
+        events,
+        options.eventsPath);
+      std::cout << "Wrote " << events.size() << " passenger events to "
+                << options.eventsPath << '\n';
+    }
+  }
+  catch (const std::exception &error) {
+    std::cerr << error.what() << '\n';
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,133 @@
+#include <Structures/TransportNetwork/PassengerEventReplay.h>
+#include <Structures/TransportNetwork/TransportNetworkBuilder.h>
+#include <Structures/TransportNetwork/TransportNetworkParser.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+using namespace Structures::TransportNetwork;
+
+namespace {
+
+struct ReplayToolOptions {
+  std::string layoutPath{"network-layout.json"};
+  std::string eventsPath{"passenger-events.jsonl"};
+  ReplayOptions replay{};
+  std::size_t runs{1};
+  bool graph{false};
+  bool fork{false};
+};
+
+auto ParseOptions(const int argc, char **argv) -> ReplayToolOptions
+{
+  ReplayToolOptions options{};
+  for (int i{1}; i < argc; ++i) {
+    const std::string argument{argv[i]};
+    if (argument == "--graph") {
+      options.graph = true;
+      continue;
+    }
+
+    if (argument == "--fork") {
+      options.fork = true;
+      continue;
+    }
+
+    if (i + 1 == argc) {
+      throw std::invalid_argument("Missing value for " + argument);
+    }
+
+    const std::string value{argv[++i]};
+    if (argument == "--layout") {
+      options.layoutPath = value;
+    }
+    else if (argument == "--events") {
+      options.eventsPath = value;
+    }
+    else if (argument == "--speed") {
+      options.replay.speed = std::stod(value);
+    }
+    else if (argument == "--threads") {
+      options.replay.threadCount = std::stoul(value);
+    }
+    else if (argument == "--runs") {
+      options.runs = std::stoul(value);
+    }
+    else {
+      throw std::invalid_argument("Unknown option " + argument);
+    }
+  }
+
+  return options;
+}
+
+auto Seconds(const std::chrono::steady_clock::duration duration) -> double
+{
+  return std::chrono::duration<double>(duration).count();
+}
+
+auto BuildNetwork(NetworkLayout layout, const bool graph) -> TransportNetwork
+{
+  TransportNetworkBuilder builder{};
+  builder.AddLayout(std::move(layout));
+  auto network{builder.Build()};
+  if (graph) {
+    network.BuildGraph();
+  }
+
+  return network;
+}
+
+} // namespace
+
+// Replays a log of passenger events, as written by generate-network-layout,
+// into the network of a layout. Every run replays into a network freshly
+// built from the layout, outside the timing, so runs start from the same
+// counts, end with the same checksum, and pay for the passenger statistics
+// a live network keeps. With --fork, runs replay into forks of one network
+// instead, which skip the statistics.
+auto main(const int argc, char **argv) -> int
+{
+  try {
+    const auto options{ParseOptions(argc, argv)};
+
+    const auto loadStart{std::chrono::steady_clock::now()};
+    const auto layout{TransportNetworkParser::ParseFile(options.layoutPath)};
+    const auto network{BuildNetwork(layout, options.graph)};
+
+    const PassengerEventReplay replay{
+      network,
+      TransportNetworkParser::ParsePassengerEventsFile(options.eventsPath)};
+    std::cout << "Loaded " << network.GetStationCount() << " stations and "
+              << replay.GetEventCount() << " events in "
+              << Seconds(std::chrono::steady_clock::now() - loadStart)
+              << " s\n";
+
+    for (std::size_t run{0}; run < options.runs; ++run) {
+      const auto report{
+        options.fork ? replay.Run(network.Fork(), options.replay)
+                     : replay.Run(
+                         BuildNetwork(layout, options.graph),
+                         options.replay)};
+      std::cout << "Run " << run + 1 << ": " << report.accepted
+                << " accepted, " << report.rejected << " rejected in "
+                << Seconds(report.elapsed) << " s, " << std::fixed
+                << std::setprecision(0) << report.EventsPerSecond()
+                << " events/s, checksum " << std::hex << report.checksum
+                << std::dec << std::defaultfloat << std::setprecision(6)
+                << '\n';
+    }
+  }
+  catch (const std::exception &error) {
+    std::cerr << error.what() << '\n';
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}